@@ -26,20 +26,53 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <stdint.h>
 #include <assert.h>
 
 class Counter {
 private:
   unsigned m_cpuid;
+  /** system-wide rather than per-core; dumped with cpuid 0 all the same */
+  bool m_global;
   uint64_t m_stat;
   std::string m_name;
+  /** s_AllStats, or the group this Counter was created in */
+  std::vector<Counter*>* m_list;
 
   /** List of all the stats that have been created. */
   static std::vector<Counter*> s_AllStats;
+  /** If non-NULL, new Counters go here instead of s_AllStats. */
+  static std::vector<Counter*>* s_OpenGroup;
 
 public:
 
+  /** Until closeGroup(), newly-constructed Counters are collected in the given
+   * group and are not dumped by dumpCounters(). Used for shadow copies of stats
+   * that get folded into the real ones later. */
+  static void openGroup(std::vector<Counter*>* group) {
+    assert( NULL == s_OpenGroup );
+    s_OpenGroup = group;
+  }
+  static void closeGroup() {
+    s_OpenGroup = NULL;
+  }
+
+  /** Find the dumped Counter with the given cpuid and name, or NULL. If
+   * several match (e.g., caches were rebuilt), the newest one wins. */
+  static Counter* find(unsigned cpuid, const std::string& name) {
+    std::vector<Counter*>::reverse_iterator it = s_AllStats.rbegin();
+    for ( ; it != s_AllStats.rend(); it++ ) {
+      if ( (*it)->m_cpuid == cpuid && (*it)->m_name == name ) return *it;
+    }
+    return NULL;
+  }
+
+  /** All the Counters that dumpCounters() dumps, in creation order. */
+  static const std::vector<Counter*>& allCounters() {
+    return s_AllStats;
+  }
+
   static void dumpCounters(std::ostream& os, const std::string& prefix, const std::string& suffix) {
     std::vector<Counter*>::iterator it = s_AllStats.begin();
     for ( ; it != s_AllStats.end(); it++ ) {
@@ -50,16 +83,46 @@ public:
     }
   }
 
-  Counter(unsigned cpuid, const char* name) {
-    s_AllStats.push_back( this );
+  Counter(unsigned cpuid, const char* name, bool global = false) {
+    m_list = s_OpenGroup ? s_OpenGroup : &s_AllStats;
+    m_list->push_back( this );
     m_cpuid = cpuid;
+    m_global = global;
     m_stat = 0;
     m_name = name;
   }
 
+  /** A copy goes in the same list as the original. */
+  Counter(const Counter& c) : m_cpuid( c.m_cpuid ), m_global( c.m_global ), m_stat( c.m_stat ),
+                              m_name( c.m_name ), m_list( c.m_list ) {
+    m_list->push_back( this );
+  }
+
+  /** Remove this Counter from its list, so find(), allCounters() and
+   * dumpCounters() never see a deleted one. A group must outlive its Counters. */
+  ~Counter() {
+    // Counters are usually destroyed newest first
+    std::vector<Counter*>::reverse_iterator it = std::find( m_list->rbegin(), m_list->rend(), this );
+    assert( it != m_list->rend() );
+    m_list->erase( --it.base() );
+  }
+
   uint64_t get() {
     return m_stat;
   }
+  unsigned cpuid() const {
+    return m_cpuid;
+  }
+  bool global() const {
+    return m_global;
+  }
+  const std::string& name() const {
+    return m_name;
+  }
+  /** Like +=, but without narrowing v to an int. */
+  void add(uint64_t v) {
+    m_stat += v;
+  }
   void set(uint64_t v) {
     m_stat = v;
   }
@@ -98,6 +161,10 @@ public:
     return os << c.m_stat;
   }
 
+private:
+  /** not implemented: a Counter keeps its own list */
+  Counter& operator=( const Counter& );
+
 };
 
 #endif /* COUNTER_HPP_ */
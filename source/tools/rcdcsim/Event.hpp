@@ -39,15 +39,29 @@ public:
   EventType m_type;
   uint16_t m_tid;
 
-  // MEMORY_READ, MEMORY_WRITE, MEMORY_ALLOCATION, MEMORY_FREE
-  uint64_t m_addr;
+  /* Every Event goes through the fifo, so fields that no event type uses
+   * together share space to keep events small. */
+
+  union {
+    uint64_t m_addr; // MEMORY_READ, MEMORY_WRITE, MEMORY_ALLOCATION, MEMORY_FREE
+    uint64_t m_bbAddr; // BASIC_BLOCK
+  };
+  // MEMORY_READ, MEMORY_WRITE
   uint8_t m_memOpSize;
   bool m_stackRef;
 
-  // HAPPENS_BEFORE_SOURCE, HAPPENS_BEFORE_SINK
-  uint64_t m_syncObject;
-  uint64_t m_logicalTime; /** filled in by the simulator */
-  bool m_isLifeLock;
+  union {
+    uint64_t m_syncObject; // HAPPENS_BEFORE_SOURCE, HAPPENS_BEFORE_SINK
+    /** MEMORY_READ, MEMORY_WRITE: the instruction making the access.
+     * MEMORY_ALLOCATION: the call site of the allocator. */
+    uint64_t m_pc;
+  };
+  union {
+    uint64_t m_logicalTime; /** HB events on lifelocks; filled in by the simulator */
+    uint64_t m_allocSize; // MEMORY_ALLOCATION; m_memOpSize is too narrow for this
+    uint32_t m_bbSize; /** BASIC_BLOCK, in bytes */
+  };
+  bool m_isLifeLock; // HAPPENS_BEFORE_SOURCE, HAPPENS_BEFORE_SINK
 
   /** The thread that was the source of this HB-sink event. INVALID_THREADID if
   there is no such thread, e.g. the very first time this lock is acquired. */
@@ -57,23 +71,26 @@ public:
 
 #ifdef SIMULATOR_FRONTEND
   static Event MemoryEvent( unsigned tid, EventType typ, uint64_t addr,
-                            unsigned memOpSize, bool stackRef ) {
+                            unsigned memOpSize, bool stackRef, uint64_t pc ) {
     assert( MEMORY_READ == typ || MEMORY_WRITE == typ );
     Event e = Event( tid, typ );
     e.m_addr = addr;
     e.m_memOpSize = memOpSize;
     e.m_stackRef = stackRef;
+    e.m_pc = pc;
     return e;
   }
 
-  static Event AllocationEvent( unsigned tid, EventType typ, uint64_t startAddr, uint64_t extent=0) {
+  static Event AllocationEvent( unsigned tid, EventType typ, uint64_t startAddr, uint64_t extent=0,
+                                uint64_t site=0 ) {
     assert( MEMORY_ALLOCATION == typ || MEMORY_FREE == typ );
     if ( 0 == extent ) {
       assert( MEMORY_FREE == typ );
     }
     Event e = Event( tid, typ );
     e.m_addr = startAddr;
-    e.m_memOpSize = extent;
+    e.m_allocSize = extent;
+    e.m_pc = site;
     return e;
   }
 
@@ -107,10 +124,13 @@ public:
     return e;
   }
 
-  static Event BasicBlockEvent( unsigned tid, EventType typ, unsigned insnCount ) {
+  static Event BasicBlockEvent( unsigned tid, EventType typ, unsigned insnCount,
+                               uint64_t bbAddr, unsigned bbSize ) {
     assert( BASIC_BLOCK == typ );
     Event e = Event( tid, typ );
     e.m_insnCount = insnCount;
+    e.m_bbAddr = bbAddr;
+    e.m_bbSize = bbSize;
     return e;
   }
 
@@ -182,7 +202,7 @@ public:
     case MEMORY_WRITE:
       name = "write";
       PrintMemEvent: ss << name << ", tid=" << m_tid << ", size=" << m_memOpSize
-          << ", stack=" << m_stackRef;
+          << ", stack=" << m_stackRef << ", pc=0x" << hex << m_pc << dec;
       break;
 
     case MEMORY_ALLOCATION:
@@ -190,11 +210,13 @@ public:
       goto PrintAllocEvent;
     case MEMORY_FREE:
       name = "free";
-      PrintAllocEvent: ss << name << ", tid=" << m_tid << ", addr=0x" << hex << m_addr << dec << ", size=" << m_memOpSize ;
+      PrintAllocEvent: ss << name << ", tid=" << m_tid << ", addr=0x" << hex << m_addr << dec << ", size=" << m_allocSize;
+      if ( MEMORY_ALLOCATION == m_type ) ss << ", site=0x" << hex << m_pc << dec;
       break;
 
     case BASIC_BLOCK:
-      ss << "basicblock" << ", tid=" << m_tid << ", insnCount=" << m_insnCount;
+      ss << "basicblock" << ", tid=" << m_tid << ", insnCount=" << m_insnCount
+         << ", addr=0x" << hex << m_bbAddr << dec << ", size=" << m_bbSize;
       break;
 
     case HAPPENS_BEFORE_SOURCE:
@@ -0,0 +1,184 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * A FIFO of Events with a bounded in-memory footprint. Events beyond the
+ * in-memory capacity are spilled to an anonymous temp file in fixed-size
+ * segments, and read back in order as the in-memory ring drains.
+ */
+
+#ifndef EVENTBUFFER_HPP_
+#define EVENTBUFFER_HPP_
+
+#include "rcdcsim.hpp"
+#include "Event.hpp"
+
+class EventBuffer {
+private:
+  /** circular buffer holding the oldest events; grows geometrically up to m_capacity */
+  vector<Event> m_ring;
+  uint64_t m_head;
+  uint64_t m_ringSize;
+  const uint64_t m_capacity;
+
+  /** Once anything has been spilled, newer events collect here, and full
+   * segments are appended to m_spillFile. Order is: ring, file, tail. */
+  vector<Event> m_tail;
+  FILE* m_spillFile;
+  /** events in m_spillFile that haven't been read back yet, starting at m_spillReadPos */
+  uint64_t m_spilledUnread;
+  uint64_t m_spillReadPos;
+  uint64_t m_spillWritePos;
+
+  uint64_t m_size;
+
+  /** fill events are read back in chunks of this many */
+  const uint64_t m_segment;
+
+  void growRing() {
+    uint64_t newCap = max( uint64_t(16), 2 * m_ring.size() );
+    newCap = min( newCap, m_capacity );
+    vector<Event> bigger( newCap );
+    for ( uint64_t i = 0; i < m_ringSize; i++ ) {
+      bigger[i] = m_ring[(m_head + i) % m_ring.size()];
+    }
+    m_ring.swap( bigger );
+    m_head = 0;
+  }
+
+  void ringPush( const Event& e ) {
+    if ( m_ringSize == m_ring.size() ) growRing();
+    assert( m_ringSize < m_ring.size() );
+    m_ring[(m_head + m_ringSize) % m_ring.size()] = e;
+    m_ringSize++;
+  }
+
+  bool spilling() const {
+    return m_spilledUnread > 0 || !m_tail.empty();
+  }
+
+  void spillTail() {
+    if ( NULL == m_spillFile ) {
+      m_spillFile = tmpfile();
+      if ( NULL == m_spillFile ) {
+        perror( "[rcdcsim] can't create event spill file" );
+        exit( 1 );
+      }
+    }
+    fseeko( m_spillFile, m_spillWritePos * sizeof(Event), SEEK_SET );
+    size_t written = fwrite( &m_tail[0], sizeof(Event), m_tail.size(), m_spillFile );
+    assert( written == m_tail.size() );
+    m_spillWritePos += m_tail.size();
+    m_spilledUnread += m_tail.size();
+    m_spilledEvents += m_tail.size();
+    m_tail.clear();
+  }
+
+  /** Move spilled events back into the ring, once it has drained to half full. */
+  void refill() {
+    if ( !spilling() || m_ringSize > m_capacity / 2 ) return;
+
+    if ( m_spilledUnread > 0 ) {
+      vector<Event> chunk( min(m_segment, min(m_spilledUnread, m_capacity - m_ringSize)) );
+      fseeko( m_spillFile, m_spillReadPos * sizeof(Event), SEEK_SET );
+      size_t got = fread( &chunk[0], sizeof(Event), chunk.size(), m_spillFile );
+      assert( got == chunk.size() );
+      for ( uint64_t i = 0; i < chunk.size(); i++ ) {
+        ringPush( chunk[i] );
+      }
+      m_spillReadPos += chunk.size();
+      m_spilledUnread -= chunk.size();
+      if ( 0 == m_spilledUnread ) {
+        // the file is drained, so start over at the beginning
+        m_spillReadPos = m_spillWritePos = 0;
+      }
+      return;
+    }
+
+    // nothing left in the file: the tail segment is next
+    uint64_t n = min( uint64_t(m_tail.size()), m_capacity - m_ringSize );
+    for ( uint64_t i = 0; i < n; i++ ) {
+      ringPush( m_tail[i] );
+    }
+    m_tail.erase( m_tail.begin(), m_tail.begin() + n );
+  }
+
+public:
+  /** total events ever written to the spill file */
+  uint64_t m_spilledEvents;
+  /** high-water mark of events held in memory */
+  uint64_t m_peakInMemory;
+
+  /** @param capacity max events held in the in-memory ring
+   * @param segment events per spill file write */
+  EventBuffer( uint64_t capacity, uint64_t segment ) :
+    m_head( 0 ), m_ringSize( 0 ), m_capacity( capacity ),
+    m_spillFile( NULL ), m_spilledUnread( 0 ), m_spillReadPos( 0 ), m_spillWritePos( 0 ),
+    m_size( 0 ), m_segment( segment ), m_spilledEvents( 0 ), m_peakInMemory( 0 )
+  {
+    assert( capacity > 0 && segment > 0 );
+  }
+
+  ~EventBuffer() {
+    if ( m_spillFile ) fclose( m_spillFile );
+  }
+
+  bool empty() const {
+    return 0 == m_size;
+  }
+
+  /** all buffered events, in memory or spilled */
+  uint64_t size() const {
+    return m_size;
+  }
+
+  uint64_t inMemory() const {
+    return m_ringSize + m_tail.size();
+  }
+
+  void push_back( const Event& e ) {
+    if ( !spilling() && m_ringSize < m_capacity ) {
+      ringPush( e );
+    } else {
+      m_tail.push_back( e );
+      if ( m_tail.size() >= m_segment ) spillTail();
+    }
+    m_size++;
+    m_peakInMemory = max( m_peakInMemory, inMemory() );
+  }
+
+  const Event& front() const {
+    assert( m_ringSize > 0 );
+    return m_ring[m_head];
+  }
+
+  void pop_front() {
+    assert( m_ringSize > 0 );
+    m_head = (m_head + 1) % m_ring.size();
+    m_ringSize--;
+    m_size--;
+    refill();
+  }
+
+};
+
+#endif /* EVENTBUFFER_HPP_ */
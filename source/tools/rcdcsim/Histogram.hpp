@@ -0,0 +1,76 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HISTOGRAM_HPP_
+#define HISTOGRAM_HPP_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/** A histogram with power-of-2 buckets: bucket 0 holds 0, and bucket b > 0
+ * holds values in [2^(b-1), 2^b). */
+class Histogram {
+private:
+  std::string m_name;
+  std::vector<uint64_t> m_buckets;
+
+public:
+  Histogram(const char* name) : m_name( name ) {}
+
+  static unsigned bucketOf(uint64_t v) {
+    unsigned b = 0;
+    while ( v > 0 ) {
+      v >>= 1;
+      b++;
+    }
+    return b;
+  }
+
+  void record(uint64_t v) {
+    const unsigned b = bucketOf( v );
+    if ( b >= m_buckets.size() ) {
+      m_buckets.resize( b + 1, 0 );
+    }
+    m_buckets[b]++;
+  }
+
+  uint64_t count(unsigned bucket) const {
+    return bucket < m_buckets.size() ? m_buckets[bucket] : 0;
+  }
+
+  /** Dumped as a dict from each non-empty bucket's lower bound to its count. */
+  void dump(std::ostream& os, const std::string& prefix, const std::string& suffix) const {
+    os << prefix << "'" << m_name << "': {";
+    bool first = true;
+    for ( unsigned b = 0; b < m_buckets.size(); b++ ) {
+      if ( 0 == m_buckets[b] ) continue;
+      os << (first ? "" : ", ") << ( b == 0 ? 0 : (uint64_t(1) << (b - 1)) ) << ": " << m_buckets[b];
+      first = false;
+    }
+    os << "}" << suffix;
+  }
+
+};
+
+#endif /* HISTOGRAM_HPP_ */
@@ -0,0 +1,272 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INTERVALSTATS_HPP_
+#define INTERVALSTATS_HPP_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdint.h>
+#include <assert.h>
+
+#include "Counter.hpp"
+
+/*
+ * Interval time series of every dumped Counter. A snapshot reads all the
+ * counters into one array and diffs it against the previous snapshot's array,
+ * then the two arrays are swapped, so snapshots cost one pass over the
+ * counters and no allocation. Deltas are buffered and written out a block of
+ * intervals at a time, column by column, as zigzag varints: most counters
+ * barely change between intervals, so most deltas take a single byte.
+ *
+ * File layout (all fixed-width integers little-endian):
+ *   magic "RCDCINTV", u32 version, u32 number of counters,
+ *   per counter: u32 cpuid, u32 name length, name bytes
+ *   blocks, until EOF: u32 rows, then one column of rows varints for
+ *   instructions, one for quantum rounds, and one per counter, all deltas
+ */
+
+namespace interval_format {
+
+static const char MAGIC[8] = { 'R', 'C', 'D', 'C', 'I', 'N', 'T', 'V' };
+static const uint32_t VERSION = 1;
+
+inline void putU32(std::ostream& os, uint32_t v) {
+  char b[4];
+  for ( unsigned i = 0; i < 4; i++ ) b[i] = char( (v >> (8 * i)) & 0xFF );
+  os.write( b, 4 );
+}
+
+inline bool getU32(std::istream& is, uint32_t& v) {
+  unsigned char b[4];
+  if ( !is.read( (char*) b, 4 ) ) return false;
+  v = b[0] | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+  return true;
+}
+
+/** Appends d as a zigzag-encoded LEB128 varint */
+inline void putVarint(std::vector<char>& out, int64_t d) {
+  uint64_t z = ( uint64_t(d) << 1 ) ^ uint64_t( d >> 63 );
+  while ( z >= 0x80 ) {
+    out.push_back( char( (z & 0x7F) | 0x80 ) );
+    z >>= 7;
+  }
+  out.push_back( char( z ) );
+}
+
+inline bool getVarint(std::istream& is, int64_t& d) {
+  uint64_t z = 0;
+  for ( unsigned shift = 0; shift < 64; shift += 7 ) {
+    const int c = is.get();
+    if ( c == EOF ) return false;
+    z |= uint64_t( c & 0x7F ) << shift;
+    if ( 0 == (c & 0x80) ) {
+      d = int64_t( z >> 1 ) ^ -int64_t( z & 1 );
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
+class IntervalStats {
+private:
+  std::ostream& m_out;
+  const std::vector<Counter*> m_counters;
+  /** snapshot every this many insns, or quantum rounds; 0 means never */
+  const uint64_t m_insnInterval;
+  const uint64_t m_roundInterval;
+  uint64_t m_nextInsns;
+  uint64_t m_nextRounds;
+
+  /** counter values at the previous and current snapshot; swapped after each snapshot */
+  std::vector<uint64_t> m_previous;
+  std::vector<uint64_t> m_current;
+  uint64_t m_previousInsns;
+  uint64_t m_previousRounds;
+
+  /** buffered deltas: [row][column], with insns and rounds as columns 0 and 1 */
+  std::vector<int64_t> m_rows;
+  unsigned m_numRows;
+
+  unsigned columns() const {
+    return 2 + m_counters.size();
+  }
+
+public:
+  /** intervals buffered before being written out */
+  static const unsigned BLOCK_ROWS = 256;
+
+  uint64_t m_intervals;
+
+  /** Writes the header for the given Counters, usually Counter::allCounters().
+   * Counters added to the vector later are ignored. */
+  IntervalStats(std::ostream& out, const std::vector<Counter*>& counters,
+                uint64_t insnInterval, uint64_t roundInterval) :
+    m_out( out ), m_counters( counters ),
+    m_insnInterval( insnInterval ), m_roundInterval( roundInterval ),
+    m_nextInsns( insnInterval ), m_nextRounds( roundInterval ),
+    m_previousInsns( 0 ), m_previousRounds( 0 ), m_numRows( 0 ), m_intervals( 0 ) {
+    assert( 0 != insnInterval || 0 != roundInterval );
+    using namespace interval_format;
+    m_out.write( MAGIC, sizeof(MAGIC) );
+    putU32( m_out, VERSION );
+    putU32( m_out, m_counters.size() );
+    m_previous.resize( m_counters.size() );
+    m_current.resize( m_counters.size() );
+    for ( unsigned c = 0; c < m_counters.size(); c++ ) {
+      putU32( m_out, m_counters[c]->cpuid() );
+      putU32( m_out, m_counters[c]->name().size() );
+      m_out.write( m_counters[c]->name().data(), m_counters[c]->name().size() );
+      m_previous[c] = m_counters[c]->get();
+    }
+    m_rows.resize( BLOCK_ROWS * columns() );
+  }
+
+  ~IntervalStats() {
+    flush();
+  }
+
+  /** Take a snapshot if an interval boundary has been reached. Cheap enough to call per event. */
+  void tick(uint64_t insns, uint64_t rounds) {
+    if ( (0 != m_insnInterval && insns >= m_nextInsns) ||
+         (0 != m_roundInterval && rounds >= m_nextRounds) ) {
+      snapshot( insns, rounds );
+    }
+  }
+
+  void snapshot(uint64_t insns, uint64_t rounds) {
+    int64_t* row = &m_rows[ m_numRows * columns() ];
+    row[0] = int64_t( insns - m_previousInsns );
+    row[1] = int64_t( rounds - m_previousRounds );
+    for ( unsigned c = 0; c < m_counters.size(); c++ ) {
+      m_current[c] = m_counters[c]->get();
+      row[2 + c] = int64_t( m_current[c] - m_previous[c] );
+    }
+    m_previous.swap( m_current );
+    m_previousInsns = insns;
+    m_previousRounds = rounds;
+    m_intervals++;
+
+    while ( 0 != m_insnInterval && m_nextInsns <= insns ) m_nextInsns += m_insnInterval;
+    while ( 0 != m_roundInterval && m_nextRounds <= rounds ) m_nextRounds += m_roundInterval;
+
+    if ( ++m_numRows == BLOCK_ROWS ) flush();
+  }
+
+  /** Write out the buffered intervals, column by column. */
+  void flush() {
+    if ( 0 == m_numRows ) return;
+    std::vector<char> block;
+    block.reserve( m_numRows * columns() );
+    for ( unsigned c = 0; c < columns(); c++ ) {
+      for ( unsigned r = 0; r < m_numRows; r++ ) {
+        interval_format::putVarint( block, m_rows[ r * columns() + c ] );
+      }
+    }
+    interval_format::putU32( m_out, m_numRows );
+    m_out.write( &block[0], block.size() );
+    m_out.flush();
+    m_numRows = 0;
+  }
+
+};
+
+/** Reads back the files IntervalStats writes. */
+class IntervalReader {
+private:
+  std::istream& m_in;
+  std::vector<int64_t> m_block;
+  unsigned m_blockRows;
+  unsigned m_nextRow;
+
+public:
+  std::vector<unsigned> m_cpuids;
+  std::vector<std::string> m_names;
+  bool m_valid;
+
+  IntervalReader(std::istream& in) : m_in( in ), m_blockRows( 0 ), m_nextRow( 0 ), m_valid( false ) {
+    using namespace interval_format;
+    char magic[sizeof(MAGIC)];
+    uint32_t version, n;
+    if ( !m_in.read( magic, sizeof(magic) ) || 0 != memcmp( magic, MAGIC, sizeof(MAGIC) ) ||
+         !getU32( m_in, version ) || VERSION != version || !getU32( m_in, n ) ) {
+      return;
+    }
+    for ( unsigned c = 0; c < n; c++ ) {
+      uint32_t cpuid, len;
+      if ( !getU32( m_in, cpuid ) || !getU32( m_in, len ) ) return;
+      std::string name( len, ' ' );
+      if ( len > 0 && !m_in.read( &name[0], len ) ) return;
+      m_cpuids.push_back( cpuid );
+      m_names.push_back( name );
+    }
+    m_valid = true;
+  }
+
+  /** Reads the next interval: deltas of insns, quantum rounds, then each counter.
+   * @return false at the end of the file, or if it is truncated */
+  bool next(std::vector<int64_t>& row) {
+    const unsigned cols = 2 + m_names.size();
+    if ( m_nextRow == m_blockRows ) {
+      uint32_t rows;
+      if ( !m_valid || !interval_format::getU32( m_in, rows ) ) return false;
+      m_block.resize( rows * cols );
+      for ( unsigned c = 0; c < cols; c++ ) {
+        for ( unsigned r = 0; r < rows; r++ ) {
+          if ( !interval_format::getVarint( m_in, m_block[ r * cols + c ] ) ) return false;
+        }
+      }
+      m_blockRows = rows;
+      m_nextRow = 0;
+    }
+    row.assign( m_block.begin() + m_nextRow * cols, m_block.begin() + (m_nextRow + 1) * cols );
+    m_nextRow++;
+    return true;
+  }
+
+  /** Writes a CSV with one row per interval and a column per counter, named cpuN.Name.
+   * @param cumulative write running totals instead of per-interval deltas */
+  void toCSV(std::ostream& os, bool cumulative) {
+    os << "insns,quantumRounds";
+    for ( unsigned c = 0; c < m_names.size(); c++ ) {
+      os << ",cpu" << m_cpuids[c] << "." << m_names[c];
+    }
+    os << "\n";
+    std::vector<int64_t> row, total( 2 + m_names.size(), 0 );
+    while ( next( row ) ) {
+      for ( unsigned c = 0; c < row.size(); c++ ) {
+        total[c] += row[c];
+        // insns and rounds are always running totals, so intervals can be placed in time
+        const int64_t v = ( cumulative || c < 2 ) ? total[c] : row[c];
+        os << ( c ? "," : "" ) << v;
+      }
+      os << "\n";
+    }
+  }
+
+};
+
+#endif /* INTERVALSTATS_HPP_ */
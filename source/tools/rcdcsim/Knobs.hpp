@@ -30,7 +30,14 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 #define KNOBS_HPP_
 
 #define KnobStatsFile "statsfile"
+#define KnobStatsFormat "stats-format"
+#define KnobRunId "run-id"
 #define KnobToSimulatorFifo "tosim-fifo"
+#define KnobIntervalFile "interval-file"
+#define KnobIntervalInsns "interval-insns"
+#define KnobIntervalRounds "interval-rounds"
+#define KnobTelemetrySocket "telemetry-socket"
+#define KnobTelemetryInterval "telemetry-interval"
 
 #define KnobScheme "scheme"
 #define KnobWorkload "workload"
@@ -41,6 +48,14 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 
 #define KnobIgnoreStackRefs "ignore-stack"
 
+// thread scheduling
+#define KnobSchedPolicy "sched-policy"
+#define KnobAffinity "affinity"
+#define KnobTimeSlice "time-slice"
+#define KnobContextSwitchCycles "ctx-switch-cycles"
+#define KnobEventBufferSize "event-buffer-size"
+#define KnobSpillSegment "spill-segment"
+
 // caches
 #define KnobBlockSize "blocksize"
 #define KnobL1Size "l1-size"
@@ -48,15 +63,54 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 #define KnobUseL2 "use-l2"
 #define KnobL2Size "l2-size"
 #define KnobL2Assoc "l2-assoc"
+#define KnobUseL1I "use-l1i"
+#define KnobL1ISize "l1i-size"
+#define KnobL1IAssoc "l1i-assoc"
 #define KnobUseL3 "use-l3"
 #define KnobL3Size "l3-size"
 #define KnobL3Assoc "l3-assoc"
 
+// TLBs
+#define KnobUseTLB "use-tlb"
+#define KnobL1DTLBEntries "l1-dtlb-entries"
+#define KnobL1DTLBAssoc "l1-dtlb-assoc"
+#define KnobL1DTLBHugeEntries "l1-dtlb-2m-entries"
+#define KnobL2DTLBEntries "l2-dtlb-entries"
+#define KnobL2DTLBHugeEntries "l2-dtlb-2m-entries"
+#define KnobL2DTLBAssoc "l2-dtlb-assoc"
+#define KnobPageWalkCacheEntries "pwc-entries"
+#define KnobHugePages "huge-pages"
+
+// miss-ratio curves
+#define KnobMissRatioCurves "mrc"
+#define KnobMRCSampleRate "mrc-sample-rate"
+#define KnobMRCAssoc "mrc-assoc"
+#define KnobMRCMaxSize "mrc-max-size"
+#define KnobSharingReport "sharing-report"
+#define KnobPCReport "pc-report"
+#define KnobPCSymbols "pc-symbols"
+#define KnobAllocReport "alloc-report"
+#define KnobCoherenceMatrix "coherence-matrix"
+
 // RCDC stuff
 #define KnobTSO "det-tso"
 #define KnobHB "det-hb"
 #define KnobNondet "nondet"
+#define KnobDMPO "dmp-o"
+#define KnobKendo "kendo"
+#define KnobPreciseHB "precise-hb"
+#define KnobRaceReport "race-report"
 #define KnobQuantumSize "quantum-size"
 #define KnobSmartQuantumBuilding "smart-qb"
+#define KnobBlockCostPredictor "qb-predictor"
+#define KnobAdaptiveQuantum "adaptive-quantum"
+#define KnobMinQuantumSize "min-quantum-size"
+#define KnobMaxQuantumSize "max-quantum-size"
+#define KnobModelCommit "model-commit"
+#define KnobOverlapCommit "overlap-commit"
+#define KnobCommitLatency "commit-latency"
+#define KnobCommitLineCycles "commit-line-cycles"
+#define KnobCommitBandwidth "commit-bandwidth"
+#define KnobNondetShards "nondet-shards"
 
 #endif /* KNOBS_HPP_ */
@@ -0,0 +1,239 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Events that the back-end has read from the front-end but can't process
+ * yet, along with the ready queue that decides which of them to process next.
+ */
+
+#ifndef PENDINGEVENTS_HPP_
+#define PENDINGEVENTS_HPP_
+
+#include "rcdcsim.hpp"
+#include "Event.hpp"
+#include "EventBuffer.hpp"
+
+/** What a thread with buffered events is waiting for. */
+enum WaitReason {
+  NOT_WAITING = 0, /** no buffered events, or in the ready queue */
+  WAIT_QUANTUM_ROUND, /** its core is stalled at a quantum boundary */
+  WAIT_CORE, /** another thread holds its core */
+  WAIT_CAUSALITY /** an earlier event on a life lock hasn't executed yet */
+};
+
+/** Per-thread buffers of deferred events. Each thread with buffered events is
+ * either in the ready queue or waiting on exactly one condition; the
+ * simulator reports when conditions may have changed, and the affected
+ * threads are moved back into the ready queue. Nobody polls. */
+class PendingEvents {
+private:
+  vector<EventBuffer*> m_buffers;
+  /** what each thread is waiting for or, if it is in the ready queue, what
+   * it was last woken up from */
+  vector<WaitReason> m_waitReason;
+  /** whether each thread is in m_ready */
+  vector<bool> m_isReady;
+  deque<unsigned> m_ready;
+
+  vector<unsigned> m_roundWaiters;
+  vector<unsigned> m_coreWaiters;
+  /** sync object => threads waiting for their turn on it */
+  map< uint64_t, vector<unsigned> > m_causalityWaiters;
+
+  uint64_t m_numBuffered;
+
+  /** in-memory events per thread before spilling, and spill segment size */
+  const uint64_t m_bufferCapacity;
+  const uint64_t m_spillSegment;
+
+  void grow( unsigned tid ) {
+    while ( tid >= m_buffers.size() ) {
+      m_buffers.push_back( new EventBuffer(m_bufferCapacity, m_spillSegment) );
+    }
+    if ( tid >= m_waitReason.size() ) {
+      m_waitReason.resize( tid + 1, NOT_WAITING );
+      m_isReady.resize( tid + 1, false );
+    }
+  }
+
+  void makeReady( unsigned tid ) {
+    assert( !m_buffers[tid]->empty() );
+    if ( !m_isReady[tid] ) {
+      m_isReady[tid] = true;
+      m_ready.push_back( tid );
+    }
+  }
+
+  void wakeAll( vector<unsigned>& waiters ) {
+    for ( unsigned i = 0; i < waiters.size(); i++ ) {
+      makeReady( waiters[i] );
+      m_wakeups++;
+    }
+    waiters.clear();
+  }
+
+  void wait( unsigned tid, WaitReason why ) {
+    assert( tid < m_buffers.size() && !m_buffers[tid]->empty() );
+    assert( !m_isReady[tid] );
+    m_waitReason[tid] = why;
+  }
+
+public:
+  /** how many times a waiting thread was moved back into the ready queue */
+  uint64_t m_wakeups;
+  /** high-water mark of numBuffered() */
+  uint64_t m_peakBuffered;
+
+  PendingEvents( uint64_t bufferCapacity, uint64_t spillSegment ) :
+    m_numBuffered( 0 ), m_bufferCapacity( bufferCapacity ), m_spillSegment( spillSegment ),
+    m_wakeups( 0 ), m_peakBuffered( 0 ) {}
+
+  ~PendingEvents() {
+    for ( unsigned i = 0; i < m_buffers.size(); i++ ) {
+      delete m_buffers[i];
+    }
+  }
+
+  /** the most events any one thread has had in memory at once */
+  uint64_t peakInMemoryPerThread() const {
+    uint64_t peak = 0;
+    for ( unsigned i = 0; i < m_buffers.size(); i++ ) {
+      peak = max( peak, m_buffers[i]->m_peakInMemory );
+    }
+    return peak;
+  }
+
+  uint64_t spilledEvents() const {
+    uint64_t n = 0;
+    for ( unsigned i = 0; i < m_buffers.size(); i++ ) {
+      n += m_buffers[i]->m_spilledEvents;
+    }
+    return n;
+  }
+
+  bool empty( unsigned tid ) const {
+    return tid >= m_buffers.size() || m_buffers[tid]->empty();
+  }
+
+  uint64_t numBuffered() const {
+    return m_numBuffered;
+  }
+
+  uint64_t numBuffered( unsigned tid ) const {
+    return tid < m_buffers.size() ? m_buffers[tid]->size() : 0;
+  }
+
+  /** Number of thread buffers, including empty ones. */
+  unsigned numThreads() const {
+    return m_buffers.size();
+  }
+
+  WaitReason waitReasonOf( unsigned tid ) const {
+    if ( tid >= m_waitReason.size() || m_isReady[tid] ) return NOT_WAITING;
+    return m_waitReason[tid];
+  }
+
+  /** For a thread returned by nextReady(), what it was waiting for before it
+   * was woken up, if anything. */
+  WaitReason wokenFrom( unsigned tid ) const {
+    return m_waitReason.at( tid );
+  }
+
+  /** Buffer an event at the end of its thread's queue. A thread that wasn't
+   * waiting on anything becomes ready. */
+  void push( const Event& e ) {
+    grow( e.m_tid );
+    m_buffers[e.m_tid]->push_back( e );
+    m_numBuffered++;
+    m_peakBuffered = max( m_peakBuffered, m_numBuffered );
+    if ( NOT_WAITING == waitReasonOf( e.m_tid ) && !m_isReady[e.m_tid] ) {
+      makeReady( e.m_tid );
+    }
+  }
+
+  bool hasReady() const {
+    return !m_ready.empty();
+  }
+
+  /** Remove the next thread from the ready queue. The caller must either
+   * pop() its first event or make it wait on something. */
+  unsigned nextReady() {
+    unsigned tid = m_ready.front();
+    m_ready.pop_front();
+    m_isReady[tid] = false;
+    return tid;
+  }
+
+  const Event& front( unsigned tid ) const {
+    return m_buffers.at( tid )->front();
+  }
+
+  /** Take the first event of a thread returned by nextReady(). If the thread
+   * has more events it goes to the back of the ready queue, so that threads
+   * take turns. */
+  Event pop( unsigned tid ) {
+    Event e = m_buffers.at( tid )->front();
+    m_buffers[tid]->pop_front();
+    m_numBuffered--;
+    m_waitReason[tid] = NOT_WAITING;
+    if ( !m_buffers[tid]->empty() ) {
+      makeReady( tid );
+    }
+    return e;
+  }
+
+  void waitForQuantumRound( unsigned tid ) {
+    wait( tid, WAIT_QUANTUM_ROUND );
+    m_roundWaiters.push_back( tid );
+  }
+  void waitForCore( unsigned tid ) {
+    wait( tid, WAIT_CORE );
+    m_coreWaiters.push_back( tid );
+  }
+  void waitForCausality( unsigned tid, uint64_t syncObject ) {
+    wait( tid, WAIT_CAUSALITY );
+    m_causalityWaiters[syncObject].push_back( tid );
+  }
+
+  /** A quantum round committed: stalled cores can run again, and migration
+   * targets may have freed up. */
+  void quantumRoundCommitted() {
+    wakeAll( m_roundWaiters );
+    wakeAll( m_coreWaiters );
+  }
+
+  /** The thread scheduler changed which threads can run where. */
+  void coreAvailabilityChanged() {
+    wakeAll( m_coreWaiters );
+  }
+
+  /** Another event on the given sync object executed. */
+  void causalityAdvanced( uint64_t syncObject ) {
+    map< uint64_t, vector<unsigned> >::iterator it = m_causalityWaiters.find( syncObject );
+    if ( it == m_causalityWaiters.end() ) return;
+    wakeAll( it->second );
+    m_causalityWaiters.erase( it );
+  }
+
+};
+
+#endif /* PENDINGEVENTS_HPP_ */
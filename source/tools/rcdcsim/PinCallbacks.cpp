@@ -26,6 +26,9 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
  */
 
 #include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <iostream>
 
 #include "frontend.hpp"
@@ -44,6 +47,7 @@ static boost::lockfree::ringbuffer<Event, 0> s_EventQueue( 100000/*max event que
 /** path to the fifos */
 extern KNOB<string> KnobToSimulatorFifo;
 extern KNOB<unsigned> KnobCores;
+extern KNOB<BOOL> KnobFutexSync;
 
 
 /* What are "life locks"?
@@ -79,6 +83,7 @@ static const char* CREATE_OP = "create";
 static const char* JOIN_OP = "join";
 static const char* LOCK_OP = "lock";
 static const char* TRYLOCK_OP = "trylock";
+static const char* BARRIER_OP = "barrier";
 
 /** Indicates whether this thread hasn't yet registered its id information.
  * Logical inversion used because the default key value is NULL. */
@@ -86,6 +91,11 @@ static TLS_KEY t_ThreadInfoUnregistered;
 
 /** The size of a malloc request, so we know both size and location when malloc() returns. */
 static TLS_KEY t_MallocSize;
+/** The return address of the current malloc call, identifying the allocation site. */
+static TLS_KEY t_MallocSite;
+
+/** The futex word this thread is waiting on in a FUTEX_WAIT syscall, if any. */
+static TLS_KEY t_FutexWaitAddr;
 
 map<ADDRINT, THREADID> Event::s_WhoLastAccessed;
 PinLock Event::sl_LastAccessed;
@@ -97,6 +107,8 @@ void initCallbackStuff() {
   t_PreviousSyncOperation = PIN_CreateThreadDataKey( NULL );
   t_ThreadInfoUnregistered = PIN_CreateThreadDataKey( NULL );
   t_MallocSize = PIN_CreateThreadDataKey( NULL );
+  t_MallocSite = PIN_CreateThreadDataKey( NULL );
+  t_FutexWaitAddr = PIN_CreateThreadDataKey( NULL );
 }
 
 // macro-ified to get "backtrace"
@@ -219,7 +231,7 @@ void setEndReached( THREADID tid ) {
   addEvent( Event::ThreadEvent( tid, ROI_FINISH ) );
 }
 
-void beforeMalloc( THREADID tid, ADDRINT size ) {
+void beforeMalloc( THREADID tid, ADDRINT size, ADDRINT site ) {
   ADDRINT sz = (ADDRINT) PIN_GetThreadData( t_MallocSize, tid );
   if ( sz != 0 ) {
     // we're already inside an allocation
@@ -228,11 +240,14 @@ void beforeMalloc( THREADID tid, ADDRINT size ) {
 
   BOOL ok = PIN_SetThreadData( t_MallocSize, (VOID*) size, tid );
   assert( ok );
+  ok = PIN_SetThreadData( t_MallocSite, (VOID*) site, tid );
+  assert( ok );
 }
 void afterMalloc( THREADID tid, ADDRINT pointer ) {
   ADDRINT size = (ADDRINT) PIN_GetThreadData( t_MallocSize, tid );
   if ( 0 != pointer && 0 != size ) { // ignore malloc() failures
-    addEvent( Event::AllocationEvent( tid, MEMORY_ALLOCATION, pointer, size ) );
+    ADDRINT site = (ADDRINT) PIN_GetThreadData( t_MallocSite, tid );
+    addEvent( Event::AllocationEvent( tid, MEMORY_ALLOCATION, pointer, size, site ) );
   }
 
   // clear out t_MallocSize so we handle re-entrancy
@@ -291,11 +306,11 @@ void startFunctionCall( THREADID tid, CONTEXT* ctxt ) {
   }
 }
 
-void startBasicBlock( THREADID tid, CONTEXT* ctxt, UINT32 insnCount ) {
-  addEvent( Event::BasicBlockEvent( tid, BASIC_BLOCK, insnCount ) );
+void startBasicBlock( THREADID tid, CONTEXT* ctxt, UINT32 insnCount, ADDRINT bbAddr, UINT32 bbSize ) {
+  addEvent( Event::BasicBlockEvent( tid, BASIC_BLOCK, insnCount, bbAddr, bbSize ) );
 }
 void memOp( THREADID tid, UINT32 pos, ADDRINT addr, UINT32 size, BOOL isRead,
-            BOOL isStackRef ) {
+            BOOL isStackRef, ADDRINT pc ) {
 		  //ADDRINT read;
 		  //ADDRINT write;
 		  //if(isRead){
@@ -306,7 +321,7 @@ void memOp( THREADID tid, UINT32 pos, ADDRINT addr, UINT32 size, BOOL isRead,
 		  //PIN_SafeCopy(&write,&addr,sizeof(ADDRINT));
 		  //std::cout << "store value:	" << write << "	address:	" << addr << endl; 
 		  //}	
-		  addEvent( Event::MemoryEvent( tid, isRead ? MEMORY_READ : MEMORY_WRITE, addr, size, isStackRef ) );
+		  addEvent( Event::MemoryEvent( tid, isRead ? MEMORY_READ : MEMORY_WRITE, addr, size, isStackRef, pc ) );
 
 }
 
@@ -400,6 +415,21 @@ void beforeLockRelease( THREADID tid, ADDRINT lockAddr ) {
   addEvent( Event::SyncSourceEvent( tid, HAPPENS_BEFORE_SOURCE, lockAddr, false ) );
 }
 
+void afterTimedAcquire( THREADID tid, ADDRINT outcome ) {
+  addEvent( Event::ThreadEvent(tid, THREAD_UNBLOCKED) );
+
+  ADDRINT lockAddr = (ADDRINT) getTlsSyncObj( tid );
+  VERBOSE_SYNC( stderr, "afterTimedAcquire: t:%u lock:%8lx result:%lu\n", tid, lockAddr,
+      outcome );
+
+  if ( 0 != outcome ) {
+    // timed out or interrupted: we didn't get the lock
+    return;
+  }
+
+  addEvent( Event::SyncSinkEvent( tid, HAPPENS_BEFORE_SINK, lockAddr, false ) );
+}
+
 void beforeTrylock( THREADID tid, ADDRINT lockAddr ) {
   VERBOSE_SYNC( stderr, "beforeTrylock: t:%u lock:%8lx\n", tid, lockAddr );
 
@@ -423,15 +453,139 @@ void afterTrylock( THREADID tid, ADDRINT outcome ) {
   addEvent( Event::SyncSinkEvent( tid, HAPPENS_BEFORE_SINK, lockAddr, false ) );
 }
 
-// Currently unused systemcall hooks.  Used to detect when threads are blocked, which isn't
-// really necessary with the single-queue model.
+/* A barrier is one N-way edge per generation: every arriving thread releases
+ the barrier and every leaving thread acquires it, so each thread's leaving
+ happens-after all threads' arrivals. That takes 2N events instead of an edge
+ per pair of threads.
+
+ Barriers get reused, though, and a thread that leaves one generation can arrive
+ at the next before slower threads have left. If every generation used the
+ barrier's address, those slow threads would acquire the fast thread's next
+ release too. So each generation is its own sync object: the barrier's address
+ with the generation in the top 16 bits, which user addresses never use.
+ Generations are counted from arrivals, with the thread count passed to
+ pthread_barrier_init(). Nobody can arrive at generation g+1 until everyone has
+ arrived at generation g, and our hook runs before the real wait, so the count
+ is exact. */
+
+struct BarrierState {
+  /** threads per generation, or 0 if we missed pthread_barrier_init() */
+  ADDRINT count;
+  /** arrivals since pthread_barrier_init() */
+  uint64_t arrivals;
+  /** generation of the first arrival since pthread_barrier_init() */
+  uint64_t firstGeneration;
+
+  BarrierState() : count( 0 ), arrivals( 0 ), firstGeneration( 0 ) {}
+
+  /** generation of the next arrival */
+  uint64_t generation() const {
+    return firstGeneration + ( 0 == count ? 0 : arrivals / count );
+  }
+
+  /** first generation nobody has arrived at yet */
+  uint64_t unusedGeneration() const {
+    if ( 0 == count ) return firstGeneration + ( arrivals > 0 ? 1 : 0 );
+    return firstGeneration + ( arrivals + count - 1 ) / count;
+  }
+};
+
+/** Barrier address => its generations */
+static map<ADDRINT, BarrierState> s_Barriers;
+/** Lock for s_Barriers */
+static PinLock sl_Barriers;
+
+static const unsigned BARRIER_GENERATION_SHIFT = 48;
+
+void beforeBarrierInit( THREADID tid, ADDRINT barrierAddr, ADDRINT count ) {
+  VERBOSE_SYNC( stderr, "beforeBarrierInit: t:%u barrier:%8lx count:%lu\n", tid, barrierAddr, count );
+
+  sl_Barriers.lock();
+  BarrierState& b = s_Barriers[barrierAddr];
+  // a barrier re-initialized at the same address carries on after the old
+  // one's generations, whose last threads may not have left yet
+  b.firstGeneration = b.unusedGeneration();
+  b.count = count;
+  b.arrivals = 0;
+  sl_Barriers.unlock();
+}
+
+void beforeBarrierWait( THREADID tid, ADDRINT barrierAddr ) {
+  VERBOSE_SYNC( stderr, "beforeBarrierWait: t:%u barrier:%8lx\n", tid, barrierAddr );
+
+  assert( barrierAddr != 0 );
+  sl_Barriers.lock();
+  BarrierState& b = s_Barriers[barrierAddr];
+  const uint64_t generation = b.generation();
+  b.arrivals++;
+  sl_Barriers.unlock();
+
+  const ADDRINT syncObj = barrierAddr ^ ( (ADDRINT) (generation & 0xFFFF) << BARRIER_GENERATION_SHIFT );
+  setTlsSyncObj( (VOID*) syncObj, tid, BARRIER_OP );
+  addEvent( Event::SyncSourceEvent( tid, HAPPENS_BEFORE_SOURCE, syncObj, false ) );
+  addEvent( Event::ThreadEvent(tid, THREAD_BLOCKED) );
+}
+
+void afterBarrierWait( THREADID tid ) {
+  addEvent( Event::ThreadEvent(tid, THREAD_UNBLOCKED) );
+
+  // the generation this thread arrived at
+  ADDRINT syncObj = (ADDRINT) getTlsSyncObj( tid );
+  VERBOSE_SYNC( stderr, "afterBarrierWait: t:%u barrier:%8lx\n", tid, syncObj );
+
+  addEvent( Event::SyncSinkEvent( tid, HAPPENS_BEFORE_SINK, syncObj, false ) );
+}
 
 void beforeSignal( THREADID tid, CONTEXT_CHANGE_REASON reason, const CONTEXT *from,
                    CONTEXT *to, INT32 info, VOID *v ) {
 }
 
+/* With -futex-sync, futex syscalls become HB edges on the futex word: a wake
+ releases it and a wait that returns without timing out acquires it. This
+ catches sync that doesn't go through the pthread routines we instrument, e.g.
+ hand-rolled locks. Futex calls made inside those routines just add redundant
+ edges. We don't send THREAD_BLOCKED events here, as a waiter is usually
+ already inside a blocking pthread call. */
+
 void beforeSyscall( THREADID tid, CONTEXT* ctx, SYSCALL_STANDARD sys, VOID* unused ) {
+  if ( !KnobFutexSync.Value() || SYS_futex != PIN_GetSyscallNumber( ctx, sys ) ) {
+    return;
+  }
+  const ADDRINT futexAddr = PIN_GetSyscallArgument( ctx, sys, 0 );
+  const int op = PIN_GetSyscallArgument( ctx, sys, 1 ) & FUTEX_CMD_MASK;
+
+  switch ( op ) {
+  case FUTEX_WAKE:
+  case FUTEX_WAKE_BITSET:
+    VERBOSE_SYNC( stderr, "futexWake: t:%u futex:%8lx\n", tid, futexAddr );
+    addEvent( Event::SyncSourceEvent( tid, HAPPENS_BEFORE_SOURCE, futexAddr, false ) );
+    break;
+  case FUTEX_WAIT:
+  case FUTEX_WAIT_BITSET: {
+    BOOL ok = PIN_SetThreadData( t_FutexWaitAddr, (VOID*) futexAddr, tid );
+    assert( ok );
+    break;
+  }
+  default:
+    break;
+  }
 }
 
 void afterSyscall( THREADID tid, CONTEXT* ctx, SYSCALL_STANDARD sys, VOID* unused ) {
+  if ( !KnobFutexSync.Value() ) {
+    return;
+  }
+  ADDRINT futexAddr = (ADDRINT) PIN_GetThreadData( t_FutexWaitAddr, tid );
+  if ( 0 == futexAddr ) {
+    return;
+  }
+  BOOL ok = PIN_SetThreadData( t_FutexWaitAddr, NULL, tid );
+  assert( ok );
+
+  // EAGAIN means someone changed the futex word before we slept, which still orders us after them
+  if ( ETIMEDOUT == PIN_GetSyscallErrno( ctx, sys ) ) {
+    return;
+  }
+  VERBOSE_SYNC( stderr, "futexWait: t:%u futex:%8lx\n", tid, futexAddr );
+  addEvent( Event::SyncSinkEvent( tid, HAPPENS_BEFORE_SINK, futexAddr, false ) );
 }
@@ -30,15 +30,15 @@ void setStartReached( THREADID tid );
 void setEndReached( THREADID tid );
 
 void startFunctionCall( THREADID tid, CONTEXT* ctxt );
-void startBasicBlock( THREADID tid, CONTEXT* ctxt, UINT32 insnCount );
+void startBasicBlock( THREADID tid, CONTEXT* ctxt, UINT32 insnCount, ADDRINT bbAddr, UINT32 bbSize );
 void memOp( THREADID tid, UINT32 pos, ADDRINT addr, UINT32 size, BOOL isRead,
-            BOOL isStackRef );
+            BOOL isStackRef, ADDRINT pc );
 
 extern AFUNPTR realPthreadSelf;
 void threadBegin( THREADID tid, CONTEXT* ctxt, INT32 flags, VOID *v );
 void threadEnd( THREADID tid, const CONTEXT* ctx, INT32 code, VOID *v );
 
-void beforeMalloc( THREADID tid, ADDRINT size );
+void beforeMalloc( THREADID tid, ADDRINT size, ADDRINT site );
 void afterMalloc( THREADID tid, ADDRINT pointer );
 void beforeFree( THREADID tid, ADDRINT pointer );
 
@@ -48,8 +48,12 @@ void afterPthreadCreate( THREADID tid );
 void beforeLockAcquire( THREADID tid, ADDRINT lockAddr );
 void afterLockAcquire( THREADID tid );
 void beforeLockRelease( THREADID tid, ADDRINT lockAddr );
+void afterTimedAcquire( THREADID tid, ADDRINT outcome );
 void beforeTrylock( THREADID tid, ADDRINT lockAddr );
 void afterTrylock( THREADID tid, ADDRINT outcome );
+void beforeBarrierInit( THREADID tid, ADDRINT barrierAddr, ADDRINT count );
+void beforeBarrierWait( THREADID tid, ADDRINT barrierAddr );
+void afterBarrierWait( THREADID tid );
 
 void beforeJoin( THREADID tid, ADDRINT pthread_t );
 void afterJoin( THREADID tid );
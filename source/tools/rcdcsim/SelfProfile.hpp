@@ -0,0 +1,150 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Self-profiling of the simulator, to see where back-end time goes. Build with
+ * `make SELF_PROFILE=1` (which defines RCDCSIM_SELF_PROFILE); otherwise all of
+ * this compiles away to nothing.
+ *
+ * Per-event work is sampled: every SAMPLE_PERIOD-th iteration of the event
+ * loop is timed with rdtsc, in every phase it passes through, and the cycles
+ * are accumulated in plain per-phase arrays that are only read at the end.
+ * Rare, expensive phases like quantum round ends are timed every time. Phases
+ * nest (e.g. snoops happen inside cache accesses, which happen inside memory
+ * events), so the cycles of different phases overlap.
+ */
+
+#ifndef SELFPROFILE_HPP_
+#define SELFPROFILE_HPP_
+
+#ifdef RCDCSIM_SELF_PROFILE
+
+#include <iostream>
+#include <string>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include "Event.hpp"
+
+enum ProfilePhase {
+  PROF_FIFO_READ,
+  /** buffering events, and picking which thread's event goes next */
+  PROF_PENDING_EVENTS,
+  PROF_CACHE_ACCESS,
+  /** the coherence search of the other cores' caches */
+  PROF_SNOOP,
+  PROF_QUANTUM_ROUND,
+  PROF_STORE_BUFFER_COMMIT,
+  /** processing each type of event, indexed by EventType */
+  PROF_EVENT,
+  NUM_PROFILE_PHASES = PROF_EVENT + HAPPENS_BEFORE_SINK + 1
+};
+
+class SelfProfile {
+public:
+  static const unsigned SAMPLE_PERIOD = 64;
+
+  static uint64_t* cycles() {
+    static uint64_t c[NUM_PROFILE_PHASES];
+    return c;
+  }
+  static uint64_t* samples() {
+    static uint64_t s[NUM_PROFILE_PHASES];
+    return s;
+  }
+  /** Whether this iteration of the event loop is being timed. Thread-local, so
+   * that work done on helper threads (e.g. cache shards) is never timed. */
+  static bool& sampling() {
+    static __thread bool s = false;
+    return s;
+  }
+
+  /** Called at the top of every event loop iteration. */
+  static void nextIteration() {
+    static uint64_t iterations = 0;
+    sampling() = 0 == ( ++iterations & (SAMPLE_PERIOD - 1) );
+  }
+
+  static const char* nameOf( unsigned phase ) {
+    static const char* NAMES[] = { "fifoRead", "pendingEvents", "cacheAccess", "snoop",
+                                   "quantumRound", "storeBufferCommit" };
+    static const char* EVENTS[] = { "invalidEvent", "roiStartEvent", "roiFinishEvent",
+                                    "threadStartEvent", "threadFinishEvent", "threadBlockedEvent",
+                                    "threadUnblockedEvent", "memoryReadEvent", "memoryWriteEvent",
+                                    "memoryAllocationEvent", "memoryFreeEvent", "basicBlockEvent",
+                                    "hbSourceEvent", "hbSinkEvent" };
+    return phase < PROF_EVENT ? NAMES[phase] : EVENTS[phase - PROF_EVENT];
+  }
+
+  /** One line per phase that was timed. Sampled phases' cycles are scaled up by
+   * SAMPLE_PERIOD to estimate their total. */
+  static void dump( std::ostream& os, const std::string& prefix, const std::string& suffix ) {
+    os << prefix << "'ProfileSamplePeriod': " << SAMPLE_PERIOD << suffix;
+    for ( unsigned p = 0; p < NUM_PROFILE_PHASES; p++ ) {
+      if ( 0 == samples()[p] ) continue;
+      const bool sampled = PROF_QUANTUM_ROUND != p && PROF_STORE_BUFFER_COMMIT != p;
+      os << prefix << "'profilePhase': '" << nameOf( p ) << "', 'timedCycles': " << cycles()[p]
+         << ", 'timings': " << samples()[p]
+         << ", 'estimatedCycles': " << cycles()[p] * ( sampled ? SAMPLE_PERIOD : 1 ) << suffix;
+    }
+  }
+};
+
+/** Times the enclosing scope, if this iteration is being sampled or always is set. */
+class ProfileTimer {
+private:
+  const unsigned m_phase;
+  const bool m_active;
+  const uint64_t m_start;
+
+public:
+  ProfileTimer( unsigned phase, bool always ) :
+    m_phase( phase ), m_active( always || SelfProfile::sampling() ),
+    m_start( m_active ? __rdtsc() : 0 ) {}
+
+  ~ProfileTimer() {
+    if ( m_active ) {
+      SelfProfile::cycles()[m_phase] += __rdtsc() - m_start;
+      SelfProfile::samples()[m_phase]++;
+    }
+  }
+};
+
+#define PROFILE_CONCAT2(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_NEXT_ITERATION() SelfProfile::nextIteration()
+/** time the rest of the enclosing scope on sampled iterations */
+#define PROFILE_SCOPE(phase) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)( phase, false )
+/** time the rest of the enclosing scope every time; only for rare phases */
+#define PROFILE_SCOPE_ALWAYS(phase) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)( phase, true )
+#define PROFILE_DUMP(os, prefix, suffix) SelfProfile::dump( os, prefix, suffix )
+
+#else
+
+#define PROFILE_NEXT_ITERATION()
+#define PROFILE_SCOPE(phase)
+#define PROFILE_SCOPE_ALWAYS(phase)
+#define PROFILE_DUMP(os, prefix, suffix)
+
+#endif /* RCDCSIM_SELF_PROFILE */
+
+#endif /* SELFPROFILE_HPP_ */
@@ -33,9 +33,16 @@ namespace knob = boost::program_options;
 #include "Event.hpp"
 #include "Knobs.hpp"
 #include "MultiCacheSimulator.hpp"
+#include "PendingEvents.hpp"
+#include "FlatHashMap.hpp"
+#include "IntervalStats.hpp"
+#include "Telemetry.hpp"
+#include "SelfProfile.hpp"
+#include "StatsDocument.hpp"
 
 #include "Counter.hpp"
 vector<Counter*> Counter::s_AllStats;
+vector<Counter*>* Counter::s_OpenGroup = NULL;
 
 //for printing out interruption free printouts
 volatile int prt = 0;
@@ -43,11 +50,10 @@ volatile int prt = 0;
 /** program knobs */
 static knob::variables_map s_knobs;
 
-/** Map from a sync object => source's vector clock */
-map<uint64_t, vector<uint64_t> > g_vcOfSyncObject;
-
 /** Insns executed, cumulative across all threads. */
 static uint64_t s_insnsExecuted = 0;
+/** when non-NULL, takes periodic snapshots of all the Counters */
+static IntervalStats* s_intervals = NULL;
 static uint64_t s_stackAccesses = 0;
 
 
@@ -59,6 +65,8 @@ static string nameOfDetStrategy() {
 	if ( s_knobs.count(KnobTSO) ) return "tso";
 	else if ( s_knobs.count(KnobHB) ) return "hb";
 	else if ( s_knobs.count(KnobNondet) ) return "nondet";
+	else if ( s_knobs.count(KnobDMPO) ) return "dmp-o";
+	else if ( s_knobs.count(KnobKendo) ) return "kendo";
 	else {
 		// didn't specify any strategy!
 		assert(false);
@@ -66,6 +74,57 @@ static string nameOfDetStrategy() {
 	}
 }
 
+/** A knob's value as a Python literal. Switches are True or False; other
+ * knobs that weren't given and have no default are None. */
+static string pyOfKnob( const knob::option_description& opt ) {
+	const string& name = opt.long_name();
+	if ( opt.semantic()->max_tokens() == 0 ) return pyOfBool( s_knobs.count(name) );
+	if ( !s_knobs.count(name) ) return "None";
+	const boost::any& v = s_knobs[name].value();
+	stringstream ss;
+	if ( const string* x = boost::any_cast<string>( &v ) ) ss << StatsDocument::pyQuote( *x );
+	else if ( const unsigned* x = boost::any_cast<unsigned>( &v ) ) ss << *x;
+	else if ( const uint64_t* x = boost::any_cast<uint64_t>( &v ) ) ss << *x;
+	else if ( const int* x = boost::any_cast<int>( &v ) ) ss << *x;
+	else if ( const double* x = boost::any_cast<double>( &v ) ) ss << *x;
+	else if ( const bool* x = boost::any_cast<bool>( &v ) ) ss << pyOfBool( *x );
+	else ss << "None";
+	return ss.str();
+}
+
+/** Which run, configuration and workload produced the stats, as one stats line each. */
+static void dumpRunInfo( ostream& os, const string& prefix, const string& suffix,
+                         const knob::options_description& desc, int argc, char** argv,
+                         const string& runId ) {
+	char host[256] = "";
+	gethostname( host, sizeof(host) - 1 );
+	string commandLine;
+	for ( int i = 0; i < argc; i++ ) {
+		commandLine += ( i > 0 ? " " : "" ) + string( argv[i] );
+	}
+	os << prefix << "'RunMetadata': {'simulator': 'rcdcsim', 'statsFormatVersion': 1"
+	   << ", 'runId': " << StatsDocument::pyQuote( runId )
+	   << ", 'host': " << StatsDocument::pyQuote( host ) << ", 'pid': " << getpid()
+	   << ", 'commandLine': " << StatsDocument::pyQuote( commandLine ) << "}" << suffix;
+
+	os << prefix << "'RunConfig': {";
+	const vector< boost::shared_ptr<knob::option_description> >& opts = desc.options();
+	bool first = true;
+	for ( unsigned i = 0; i < opts.size(); i++ ) {
+		if ( "help" == opts[i]->long_name() ) continue;
+		os << ( first ? "" : ", " ) << StatsDocument::pyQuote( opts[i]->long_name() ) << ": " << pyOfKnob( *opts[i] );
+		first = false;
+	}
+	os << "}" << suffix;
+
+	os << prefix << "'RunWorkload': {'workload': " << StatsDocument::pyQuote( s_knobs[KnobWorkload].as<string>() )
+	   << ", 'input': " << StatsDocument::pyQuote( s_knobs[KnobInput].as<string>() )
+	   << ", 'threads': " << s_knobs[KnobThreads].as<unsigned>()
+	   << ", 'scheme': " << StatsDocument::pyQuote( s_knobs[KnobScheme].as<string>() )
+	   << ", 'determinismStrategy': '" << nameOfDetStrategy() << "'"
+	   << ", 'cores': " << s_knobs[KnobCores].as<unsigned>() << "}" << suffix;
+}
+
 /** c/o http://www.techbytes.ca/techbyte103.html */
 static bool fileExists( string strFilename ) {
 	struct stat stFileInfo;
@@ -108,37 +167,143 @@ static bool usesStoreBuffer( const Event& e ) {
 
 static uint64_t s_causalityDelays = 0;
 static uint64_t s_unprocessedEvents = 0;
-static uint64_t s_forcedCommits = 0;
+static uint64_t s_eventWakeups = 0;
+static uint64_t s_peakBufferedEvents = 0;
+static uint64_t s_peakInMemoryEventsPerThread = 0;
+static uint64_t s_spilledEvents = 0;
+
+/** when non-NULL, serves live progress reports */
+static TelemetryServer* s_telemetry = NULL;
+static InputLag* s_inputLag = NULL;
+static uint64_t s_telemetryIntervalMillis = 1000;
+/** events read from the front-end, and events processed by type */
+static uint64_t s_eventsRead = 0;
+static uint64_t s_eventsByType[HAPPENS_BEFORE_SINK + 1];
+
+static const char* s_eventTypeNames[HAPPENS_BEFORE_SINK + 1] = {
+	"invalid", "roiStart", "roiFinish", "threadStart", "threadFinish", "threadBlocked",
+	"threadUnblocked", "memoryRead", "memoryWrite", "memoryAllocation", "memoryFree",
+	"basicBlock", "hbSource", "hbSink"
+};
+
+static uint64_t millisNow() {
+	timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return uint64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
 
-bool syncEventCanProceed(const Event& e,
-		map<uint64_t,uint64_t>& activeEventOfSyncObject,
-		MultiCacheSimulator<RCDCLine, uint64_t>* sim,
-		vector< deque<Event> >& eventBuffers) {
-	if ( !e.m_isLifeLock ) {
-		return true;
+static double secondsNow() {
+	timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Publish a JSON progress report, if it's been long enough since the last one. */
+static void publishTelemetry( MultiCacheSimulator<RCDCLine, uint64_t>* sim,
+		const PendingEvents& pending, bool fifoOpen ) {
+	static uint64_t startMillis = millisNow();
+	static uint64_t lastMillis = startMillis;
+	static uint64_t lastInsns = 0;
+	static uint64_t lastEventsByType[HAPPENS_BEFORE_SINK + 1];
+
+	const uint64_t now = millisNow();
+	if ( now - lastMillis < s_telemetryIntervalMillis ) return;
+	const double seconds = (now - lastMillis) / 1000.0;
+
+	stringstream json;
+	json << "{\"pid\": " << getpid();
+	json << ", \"elapsedSeconds\": " << (now - startMillis) / 1000.0;
+	json << ", \"simulatedInsns\": " << s_insnsExecuted;
+	json << ", \"insnsPerSec\": " << uint64_t( (s_insnsExecuted - lastInsns) / seconds );
+	json << ", \"quantumRounds\": " << sim->numQuantumRounds();
+	json << ", \"causalityDelays\": " << s_causalityDelays;
+
+	json << ", \"events\": {";
+	for ( unsigned t = ROI_START; t <= HAPPENS_BEFORE_SINK; t++ ) {
+		json << ( t == ROI_START ? "" : ", " ) << "\"" << s_eventTypeNames[t] << "\": " << s_eventsByType[t];
 	}
+	json << "}, \"eventsPerSec\": {";
+	for ( unsigned t = ROI_START; t <= HAPPENS_BEFORE_SINK; t++ ) {
+		json << ( t == ROI_START ? "" : ", " ) << "\"" << s_eventTypeNames[t] << "\": "
+				<< uint64_t( (s_eventsByType[t] - lastEventsByType[t]) / seconds );
+		lastEventsByType[t] = s_eventsByType[t];
+	}
+	json << "}";
+
+	json << ", \"cores\": [";
+	for ( unsigned c = 0; c < sim->NUM_CORES; c++ ) {
+		const unsigned tid = sim->m_scheduler.currentThreadOf( c );
+		json << ( c ? ", " : "" ) << "{\"state\": \"" << sim->coreStatus( c ) << "\", \"thread\": ";
+		if ( ThreadScheduler::NO_THREAD == tid ) {
+			json << "null}";
+		} else {
+			json << tid << "}";
+		}
+	}
+	json << "]";
 
-	if ( 1 == e.m_logicalTime ) { // first sync event: ok to execute
-		activeEventOfSyncObject[ e.m_syncObject ] = 2;
-	} else {
-		map<uint64_t,uint64_t>::iterator mit = activeEventOfSyncObject.find( e.m_syncObject );
+	json << ", \"bufferedEvents\": " << pending.numBuffered();
+	json << ", \"bufferedEventsPerThread\": [";
+	for ( unsigned t = 0; t < pending.numThreads(); t++ ) {
+		json << ( t ? ", " : "" ) << pending.numBuffered( t );
+	}
+	json << "]";
+	json << ", \"spilledEvents\": " << pending.spilledEvents();
+	json << ", \"fifoOpen\": " << ( fifoOpen ? "true" : "false" );
+	json << ", \"fifoLagEvents\": " << s_inputLag->bytesWaiting( s_eventsRead * sizeof(Event) ) / sizeof(Event);
+	json << "}\n";
+
+	s_telemetry->publish( json.str() );
+	lastMillis = now;
+	lastInsns = s_insnsExecuted;
+}
 
-		if ( activeEventOfSyncObject.end() != mit && mit->second == e.m_logicalTime ) { // I'm the next event!
-			activeEventOfSyncObject[ e.m_syncObject ] = e.m_logicalTime + 1;
-		} else {
-			if ( activeEventOfSyncObject.end() != mit ) {
-				assert( e.m_logicalTime > mit->second );
-			}
-			// I have to wait
-			s_causalityDelays++;
-			sim->waitForCausality( e.m_tid );
-			eventBuffers.at( sim->cpuOfTid( e.m_tid ) ).push_front( e );
-			return false;
+static void recordPendingEventStats( const PendingEvents& pending ) {
+	s_unprocessedEvents = pending.numBuffered();
+	s_eventWakeups = pending.m_wakeups;
+	s_peakBufferedEvents = pending.m_peakBuffered;
+	s_peakInMemoryEventsPerThread = pending.peakInMemoryPerThread();
+	s_spilledEvents = pending.spilledEvents();
+}
+
+/** Let other threads take over cores whose running thread has no pending events. */
+static void preemptIdleThreads( MultiCacheSimulator<RCDCLine, uint64_t>* sim,
+		const PendingEvents& pending ) {
+	for ( unsigned c = 0; c < sim->NUM_CORES; c++ ) {
+		const unsigned current = sim->m_scheduler.currentThreadOf( c );
+		if ( ThreadScheduler::NO_THREAD == current || pending.empty( current ) ) {
+			sim->m_scheduler.preempt( c );
 		}
+	}
+}
 
+/** Whether it is e's turn to execute, given the total order on life lock
+ * events established when they were read from the fifo. */
+static bool syncEventCanProceed( const Event& e, FlatHashMap<uint64_t>& activeEventOfSyncObject ) {
+	if ( !e.m_isLifeLock ) {
+		return true;
+	}
+	if ( 1 == e.m_logicalTime ) { // first sync event: ok to execute
+		return true;
 	}
+	const uint64_t* active = activeEventOfSyncObject.find( e.m_syncObject );
+	if ( NULL != active ) {
+		assert( e.m_logicalTime >= *active );
+		return *active == e.m_logicalTime;
+	}
+	return false;
+}
+
+/** e is executing: let the next event on its sync object go. */
+static void syncEventProceeds( const Event& e, FlatHashMap<uint64_t>& activeEventOfSyncObject,
+		MultiCacheSimulator<RCDCLine, uint64_t>* sim, PendingEvents& pending ) {
+	if ( !e.m_isLifeLock ) {
+		return;
+	}
+	assert( syncEventCanProceed(e, activeEventOfSyncObject) );
+	activeEventOfSyncObject[ e.m_syncObject ] = e.m_logicalTime + 1;
+	pending.causalityAdvanced( e.m_syncObject );
 	sim->satisfiedCausality( e.m_tid );
-	return true;
 }
 
 static int s_maxLiveThreads = 0;
@@ -152,115 +317,153 @@ void processEvents(MultiCacheSimulator<RCDCLine, uint64_t>* sim, ifstream& event
 	  not necessarily executed yet) for each sync object. Used to enforce a total
 	  order on sink/source events to a given sync object, based on their order of
 	  appearance in the event fifo. */
-	map<uint64_t, uint64_t> receivedEventsOfSyncObject;
+	FlatHashMap<uint64_t> receivedEventsOfSyncObject;
 
 	/** the last source event that was executed for each sync object */
-	map<uint64_t, uint64_t> activeEventOfSyncObject;
+	FlatHashMap<uint64_t> activeEventOfSyncObject;
+
+	/** per-thread queues of events that couldn't be processed yet, either because
+	  the thread's core is stalled, another thread is running on it, or it is
+	  waiting for its turn on a life lock */
+	PendingEvents pending( s_knobs[KnobEventBufferSize].as<uint64_t>(),
+			s_knobs[KnobSpillSegment].as<uint64_t>() );
 
-	vector< deque<Event> > eventBuffers( sim->m_allCaches.size() );
+	// used to notice round commits and scheduler changes, which may wake up waiting threads
+	uint64_t lastQuantumRound = sim->numQuantumRounds();
+	uint64_t lastSchedulerGeneration = sim->m_scheduler.generation();
 
 	bool allDone = false;
 	bool fifoOpen = true;
-	/** the first event buffer to check: we rotate through them to avoid livelock */
-	uint64_t firstEventBuffer = 0;
-	unsigned iterationsWithoutProgress = 0;
+	uint64_t iterations = 0;
 	Event e;
 	while ( true ) {
+		PROFILE_NEXT_ITERATION();
 
-		if ( iterationsWithoutProgress > 100000 ) {
-			s_forcedCommits++;
-			iterationsWithoutProgress = 0;
-			sim->finishQuantumRound();
+		// reading the clock every iteration would be too slow
+		if ( s_telemetry && 0 == (++iterations & 0xFFF) ) {
+			publishTelemetry( sim, pending, fifoOpen );
 		}
 
-		// help avoid forced commits by ignoring threads that are finished
-		if ( !fifoOpen ) {
-			s_unprocessedEvents = 0;
-			for ( unsigned i = 0; i < eventBuffers.size(); i++ ) {
-				if ( eventBuffers.at(i).empty() ) {
-					sim->block( i );
-				} else {
-					s_unprocessedEvents += eventBuffers.at(i).size();
-				}
-			}
+		if ( sim->numQuantumRounds() != lastQuantumRound ) {
+			lastQuantumRound = sim->numQuantumRounds();
+			pending.quantumRoundCommitted();
+			if ( s_intervals ) s_intervals->tick( s_insnsExecuted, lastQuantumRound );
+		}
+		if ( sim->m_scheduler.generation() != lastSchedulerGeneration ) {
+			lastSchedulerGeneration = sim->m_scheduler.generation();
+			pending.coreAvailabilityChanged();
 		}
 
 		// prefer draining per-thread queues over reading from the front-end
-		bool tookEventFromLocalBuffer = false;
-
-		/* NB: this code means that we will process a bunch of events for each
-		   thread, instead of (more realistically) interleaving events from different
-		   threads. */
-		for ( unsigned i = 0; i < eventBuffers.size(); i++ ) {
-			const unsigned bufferIndex = (i + firstEventBuffer) % eventBuffers.size();
-			if ( !sim->stalledAtQuantumBoundary(bufferIndex) && !eventBuffers.at(bufferIndex).empty() ) {
-				e = eventBuffers.at(bufferIndex).front();
-				eventBuffers.at(bufferIndex).pop_front();
-				tookEventFromLocalBuffer = true;
-				break;
-			}
-		}
-		firstEventBuffer++;
+		if ( !pending.hasReady() ) {
 
-		if ( fifoOpen && !tookEventFromLocalBuffer ) {
-			// blocking read from fifo
-			assert( eventFifo.good() );
-			eventFifo.read( (char*) &e, sizeof(Event) );
+			if ( fifoOpen ) {
+				// blocking read from fifo
+				assert( eventFifo.good() );
+				{
+					PROFILE_SCOPE( PROF_FIFO_READ );
+					// a read that can't be served from the stream's buffer may block on
+					// the front-end indefinitely, so keep reporting while we wait
+					if ( s_telemetry && eventFifo.rdbuf()->in_avail() < (streamsize) sizeof(Event) ) {
+						while ( !s_inputLag->waitForInput( s_telemetryIntervalMillis ) ) {
+							publishTelemetry( sim, pending, fifoOpen );
+						}
+					}
+					eventFifo.read( (char*) &e, sizeof(Event) );
+				}
 
-			const unsigned bytesRead = eventFifo.gcount();
+				const unsigned bytesRead = eventFifo.gcount();
 
-			if ( 0 == bytesRead ) {
-				assert( eventFifo.eof() );
-				fifoOpen = false;
-				iterationsWithoutProgress++;
-				continue;
-			}
+				if ( 0 == bytesRead ) {
+					assert( eventFifo.eof() );
+					fifoOpen = false;
+					continue;
+				}
 
-			assert( sizeof(Event) == bytesRead );
-			int cpuid = sim->cpuOfTid( e.m_tid );
+				assert( sizeof(Event) == bytesRead );
+				s_eventsRead++;
+				PROFILE_SCOPE( PROF_PENDING_EVENTS );
 
-			// enforce a total order on sync events for a given sync object
-			if ( e.m_isLifeLock ) {
-				switch ( e.m_type ) {
-					case HAPPENS_BEFORE_SOURCE:
-					case HAPPENS_BEFORE_SINK: {
-									  map<uint64_t,uint64_t>::iterator mit = receivedEventsOfSyncObject.find( e.m_syncObject );
-									  if ( mit == receivedEventsOfSyncObject.end() ) {
+				// enforce a total order on sync events for a given sync object
+				if ( e.m_isLifeLock ) {
+					switch ( e.m_type ) {
+						case HAPPENS_BEFORE_SOURCE:
+						case HAPPENS_BEFORE_SINK: {
 										  // NB: logical times start at 1
-										  receivedEventsOfSyncObject[ e.m_syncObject ] = 1;
-										  e.m_logicalTime = 1;
-									  } else {
-										  uint64_t newval = mit->second + 1;
-										  receivedEventsOfSyncObject[ e.m_syncObject ] = newval;
-										  e.m_logicalTime = newval;
+										  e.m_logicalTime = ++receivedEventsOfSyncObject[ e.m_syncObject ];
 									  }
-								  }
-								  break;
-					default:
-								  break;
+									  break;
+						default:
+									  break;
+					}
 				}
-			}
 
-			// core is stalled, so buffer the event locally
-			if ( sim->stalledAtQuantumBoundary(e.m_tid) ) {
-				eventBuffers.at( cpuid ).push_back( e );
-				iterationsWithoutProgress++;
+				pending.push( e );
 				continue;
-			} else {
-				// if core is not stalled, we should have drained its buffer already
-				assert( eventBuffers.at(cpuid).empty() );
 			}
 
+			// The trace has run dry and nothing can run. Cores without any
+			// events left can't hold up the quantum round, and running threads
+			// with nothing left to do should let the others in.
+			s_unprocessedEvents = pending.numBuffered();
+			if ( 0 == s_unprocessedEvents ) {
+				recordPendingEventStats( pending );
+				return;
+			}
+			vector<bool> coreHasEvents( sim->NUM_CORES, false );
+			for ( unsigned i = 0; i < pending.numThreads(); i++ ) {
+				if ( !pending.empty(i) ) {
+					coreHasEvents.at( sim->cpuOfTid(i) ) = true;
+				}
+			}
+			for ( unsigned c = 0; c < sim->NUM_CORES; c++ ) {
+				if ( !coreHasEvents.at(c) ) {
+					sim->blockCore( c );
+				}
+			}
+			preemptIdleThreads( sim, pending );
+
+			// Blocking or preempting those always wakes someone up: every core
+			// left with events is now stalled at the quantum boundary or
+			// waiting for causality, so the round has finished. And causality
+			// can't deadlock, since life lock turns follow the fifo order, which
+			// respects each thread's program order.
+			if ( sim->numQuantumRounds() == lastQuantumRound &&
+					sim->m_scheduler.generation() == lastSchedulerGeneration ) {
+				cerr << "[rcdcsim] " << s_unprocessedEvents << " events can never run" << endl;
+				assert( false );
+				recordPendingEventStats( pending );
+				return;
+			}
+			continue;
 		}
 
-		if( sim->stalledAtQuantumBoundary(e.m_tid) ) {
-			iterationsWithoutProgress++;
-			continue;
+		{
+			PROFILE_SCOPE( PROF_PENDING_EVENTS );
+			const unsigned tid = pending.nextReady();
+			if ( sim->stalledAtQuantumBoundary(tid) ) {
+				pending.waitForQuantumRound( tid );
+				continue;
+			}
+			if ( !sim->tryDispatch(tid) ) {
+				pending.waitForCore( tid );
+				continue;
+			}
+			if ( !syncEventCanProceed(pending.front(tid), activeEventOfSyncObject) ) {
+				if ( WAIT_CAUSALITY != pending.wokenFrom(tid) ) {
+					s_causalityDelays++;
+				}
+				sim->waitForCausality( tid );
+				pending.waitForCausality( tid, pending.front(tid).m_syncObject );
+				continue;
+			}
+			e = pending.pop( tid );
 		}
 
-		bool madeProgress = true;
+		s_eventsByType[e.m_type]++;
 
 		// event dispatch
+		PROFILE_SCOPE( PROF_EVENT + e.m_type );
 		switch ( e.m_type ) {
 
 			case ROI_START:
@@ -270,6 +473,7 @@ void processEvents(MultiCacheSimulator<RCDCLine, uint64_t>* sim, ifstream& event
 
 			case THREAD_START:
 				currentLiveThreads++;
+				sim->threadStarted( e.m_tid );
 				sim->setLiveThreads( currentLiveThreads );
 				s_numSpawnedThreads++;
 				s_maxLiveThreads = max( s_maxLiveThreads, currentLiveThreads );
@@ -295,8 +499,8 @@ void processEvents(MultiCacheSimulator<RCDCLine, uint64_t>* sim, ifstream& event
 
 			case THREAD_FINISH:
 				currentLiveThreads--;
+				sim->threadFinished( e.m_tid );
 				sim->setLiveThreads( currentLiveThreads );
-				sim->block( e.m_tid );
 				//cerr << "Finish Thread " << e.m_tid << endl;
 				// when main thread exits, tear down simulation
 				if ( 0 == e.m_tid ) {
@@ -354,34 +558,30 @@ void processEvents(MultiCacheSimulator<RCDCLine, uint64_t>* sim, ifstream& event
 				}
 
 			case MEMORY_ALLOCATION:
-				// NOP for now
+				sim->memoryAllocated( e.m_addr, e.m_allocSize, e.m_pc );
 				break;
 			case MEMORY_FREE:
-				// NOP for now
+				sim->memoryFreed( e.m_addr );
 				break;
 
-			case HAPPENS_BEFORE_SOURCE: {
-							    if ( syncEventCanProceed(e, activeEventOfSyncObject, sim, eventBuffers) ) {
-								    sim->syncOp( e.m_tid, SYNC_SOURCE, false, INVALID_THREADID, e.m_syncObject );
-							    } else madeProgress = false;
-						    }
+			case HAPPENS_BEFORE_SOURCE:
+						    syncEventProceeds( e, activeEventOfSyncObject, sim, pending );
+						    sim->syncOp( e.m_tid, SYNC_SOURCE, false, INVALID_THREADID, e.m_syncObject );
 						    break;
-			case HAPPENS_BEFORE_SINK: {
-							  if ( syncEventCanProceed(e, activeEventOfSyncObject, sim, eventBuffers) ) {
-								  sim->syncOp( e.m_tid, SYNC_SINK, e.m_hbSourceThread != INVALID_THREADID,
-										  e.m_hbSourceThread, e.m_syncObject );
-							  } else madeProgress = false;
-						  }
+			case HAPPENS_BEFORE_SINK:
+						  syncEventProceeds( e, activeEventOfSyncObject, sim, pending );
+						  sim->syncOp( e.m_tid, SYNC_SINK, e.m_hbSourceThread != INVALID_THREADID,
+								  e.m_hbSourceThread, e.m_syncObject );
 						  break;
 
 			case MEMORY_READ:
-						  sim->cacheRead( e.m_tid, e.m_addr, e.m_memOpSize, usesStoreBuffer( e ) );
+						  sim->cacheRead( e.m_tid, e.m_addr, e.m_memOpSize, usesStoreBuffer( e ), e.m_pc );
 
 
 
 						  break;
 			case MEMORY_WRITE:
-						  sim->cacheWrite( e.m_tid, e.m_addr, e.m_memOpSize, usesStoreBuffer( e ) );
+						  sim->cacheWrite( e.m_tid, e.m_addr, e.m_memOpSize, usesStoreBuffer( e ), e.m_pc );
 
 						  break;
 
@@ -391,7 +591,8 @@ void processEvents(MultiCacheSimulator<RCDCLine, uint64_t>* sim, ifstream& event
 						  //if ( (s_insnsExecuted % 5000000) < e.m_insnCount ) {
 						  //cerr << "[debug] (nd/tso/hb):" << s_knobs.count(KnobNondet) << s_knobs.count(KnobTSO) << s_knobs.count(KnobHB) << " executed " << s_insnsExecuted << " insns" << endl;
 						  //}
-						  sim->basicBlock( e.m_tid, e.m_insnCount );
+						  sim->basicBlock( e.m_tid, e.m_insnCount, e.m_bbAddr, e.m_bbSize );
+						  if ( s_intervals ) s_intervals->tick( s_insnsExecuted, sim->numQuantumRounds() );
 						  break;
 
 			case INVALID_EVENT:
@@ -400,15 +601,10 @@ void processEvents(MultiCacheSimulator<RCDCLine, uint64_t>* sim, ifstream& event
 						  assert(false);
 		}
 
-		iterationsWithoutProgress = madeProgress ? 0 : iterationsWithoutProgress+1;
-
 		if ( allDone ) {
 
 			// there shouldn't be any queued-up events
-			s_unprocessedEvents = 0;
-			for ( unsigned i = 0; i < eventBuffers.size(); i++ ) {
-				s_unprocessedEvents += eventBuffers.at(i).size();
-			}
+			recordPendingEventStats( pending );
 
 			return;
 		}
@@ -425,8 +621,15 @@ int main(int argc, char** argv) {
 	desc.add_options()
 		("help", "produce help message")
 
-		(KnobStatsFile, knob::value<string>()->default_value("rcdcsim-stats.py"), "stats file to generate")
+		(KnobStatsFile, knob::value<string>(), "stats file to generate (default rcdcsim-stats.json, .csv or .py, after --stats-format); overwritten, except that csv runs are added as rows")
+		(KnobStatsFormat, knob::value<string>()->default_value("json"), "stats file format: json (one document per run), csv (one row per run, tagged with --run-id, and one column per stat, so a sweep can share one file) or py (one Python dict per line)")
+		(KnobRunId, knob::value<string>(), "name of this run in the stats (default host-pid-starttime)")
 		(KnobToSimulatorFifo, knob::value<string>(), "named fifo used to get events from the front-end")
+		(KnobIntervalFile, knob::value<string>()->default_value("rcdcsim-intervals.bin"), "binary file of per-interval stats deltas (see IntervalStats.hpp; intervalcsv converts it)")
+		(KnobIntervalInsns, knob::value<uint64_t>()->default_value(0), "snapshot all stats every this many simulated insns (0 disables)")
+		(KnobIntervalRounds, knob::value<uint64_t>()->default_value(0), "snapshot all stats every this many quantum rounds (0 disables)")
+		(KnobTelemetrySocket, knob::value<string>(), "UNIX-domain socket that serves live JSON progress reports (see rcdcsim-top)")
+		(KnobTelemetryInterval, knob::value<uint64_t>()->default_value(1000), "milliseconds between progress reports")
 
 		// these are used to tag the output file, but don't affect the simulation at all
 		(KnobScheme, knob::value<string>()->default_value("<none/>"), "text describing this simulation setup")
@@ -441,6 +644,14 @@ int main(int argc, char** argv) {
 
 		(KnobIgnoreStackRefs, "Ignore stack accesses." )
 
+		// thread scheduling
+		(KnobSchedPolicy, knob::value<string>()->default_value("affinity"), "How threads are mapped onto cores: affinity, round-robin or load-balance")
+		(KnobAffinity, knob::value<string>(), "Explicit thread pinning for the affinity policy, as tid:core,tid:core,...")
+		(KnobTimeSlice, knob::value<uint64_t>()->default_value(100000), "Insns a thread runs before another thread may take over its core")
+		(KnobContextSwitchCycles, knob::value<uint64_t>()->default_value(1000), "Cycles charged to a core for each context switch")
+		(KnobEventBufferSize, knob::value<uint64_t>()->default_value(1<<20), "Deferred events each thread may hold in memory before spilling to a temp file")
+		(KnobSpillSegment, knob::value<uint64_t>()->default_value(1<<14), "Events per write when spilling deferred events")
+
 		// cache parameters
 		(KnobBlockSize, knob::value<unsigned>()->default_value(64), "Block size for all caches")
 		(KnobL1Size, knob::value<unsigned>()->default_value(1<<15/*32KB*/), "Size (in bytes) of each private L1 cache")
@@ -449,17 +660,55 @@ int main(int argc, char** argv) {
 		(KnobUseL2, "Model a private L2 for each core")
 		(KnobL2Size, knob::value<unsigned>()->default_value(1<<18/*256KB*/), "Size (in bytes) of the private L2 cache")
 		(KnobL2Assoc, knob::value<unsigned>()->default_value(8), "Associativity of the private L2 cache")
+		(KnobUseL1I, "Model instruction fetch through a private L1 instruction cache")
+		(KnobL1ISize, knob::value<unsigned>()->default_value(1<<15/*32KB*/), "Size (in bytes) of each private L1 instruction cache")
+		(KnobL1IAssoc, knob::value<unsigned>()->default_value(8), "Associativity of each private L1 instruction cache")
 
 		(KnobUseL3, "Model an L3 cache shared amongst all cores")
 		(KnobL3Size, knob::value<unsigned>()->default_value(1<<23/*8MB*/), "Size (in bytes) of the shared L3 cache")
 		(KnobL3Assoc, knob::value<unsigned>()->default_value(16), "Associativity of the shared L3 cache")
 
+		// TLB parameters
+		(KnobUseTLB, "Model per-core data TLBs and page walks")
+		(KnobL1DTLBEntries, knob::value<unsigned>()->default_value(64), "Entries in each L1 data TLB for 4KB pages")
+		(KnobL1DTLBAssoc, knob::value<unsigned>()->default_value(4), "Associativity of the L1 data TLBs")
+		(KnobL1DTLBHugeEntries, knob::value<unsigned>()->default_value(32), "Entries in each L1 data TLB for 2MB pages")
+		(KnobL2DTLBEntries, knob::value<unsigned>()->default_value(1024), "Entries in each L2 TLB for 4KB pages")
+		(KnobL2DTLBHugeEntries, knob::value<unsigned>()->default_value(256), "Entries in each L2 TLB for 2MB pages")
+		(KnobL2DTLBAssoc, knob::value<unsigned>()->default_value(8), "Associativity of the L2 TLBs")
+		(KnobPageWalkCacheEntries, knob::value<unsigned>()->default_value(32), "Entries in each page-walk cache")
+		(KnobHugePages, knob::value<string>()->default_value("none"), "Memory backed by 2MB pages: none, all or large-allocs")
+
+		(KnobMissRatioCurves, "Compute per-core and global LRU miss-ratio curves for all cache sizes in one pass")
+		(KnobMRCSampleRate, knob::value<double>()->default_value(0.01), "Fraction of lines sampled for miss-ratio curves (1 is exact)")
+		(KnobMRCAssoc, knob::value<unsigned>()->default_value(8), "Associativity of the caches modeled by the miss-ratio curves (0 is fully-associative)")
+		(KnobMRCMaxSize, knob::value<uint64_t>()->default_value(1<<26/*64MB*/), "Largest cache size (in bytes) on the miss-ratio curves")
+		(KnobSharingReport, "Classify coherence misses as true or false sharing, and report the lines with the most false sharing")
+		(KnobPCReport, "Attribute misses and coherence events to instructions, and report the costliest ones")
+		(KnobPCSymbols, knob::value<string>(), "symbol file written by the front-end's -symbol-file, to name the PCs in --pc-report and the sites in --alloc-report")
+		(KnobAllocReport, "Attribute misses, coherence events and committed dirty lines to heap allocation sites, and report the costliest ones")
+		(KnobCoherenceMatrix, "Report core-to-core data transfers and invalidations, the invalidation fan-out of writes, and the communication in each quantum round")
+
 		// RCDC
 		(KnobTSO, "Enable simulation of Det-TSO.  Mutually exclusive with other Det-X schemes." )
 		(KnobHB, "Enable simulation of Det-HB.  Mutually exclusive with other Det-X schemes." )
 		(KnobNondet, "Enable simulation of Nondet.  Mutually exclusive with other Det-X schemes." )
-		(KnobQuantumSize, knob::value<unsigned>()->default_value(1000), "Quantum size (insns)")
+		(KnobDMPO, "Enable simulation of DMP-O (ownership-table serialization of communicating quanta).  Mutually exclusive with other Det-X schemes." )
+		(KnobKendo, "Enable simulation of Kendo (lock acquires ordered by deterministic logical clocks).  Mutually exclusive with other Det-X schemes." )
+		(KnobQuantumSize, knob::value<unsigned>()->default_value(1000), "Quantum size (insns, or predicted cycles with --" KnobBlockCostPredictor ")")
 		(KnobSmartQuantumBuilding, "Use store buffer hit/miss information to deterministically estimate runtime when possible." )
+		(KnobPreciseHB, "Det-HB stalls a sync sink only when vector clocks show it newly depends on a release from the current quantum round" )
+		(KnobRaceReport, "Track happens-before with vector clocks and report data races (FastTrack), at 8-byte granularity" )
+		(KnobBlockCostPredictor, "Measure quanta in cycles predicted from each thread's past deterministic cycles per insn for each basic block, instead of in insns. --" KnobQuantumSize " and the adaptive quantum bounds are then in cycles, so a quantum holds fewer insns than before" )
+		(KnobAdaptiveQuantum, "Grow and shrink the quantum size each round based on deterministic imbalance, sync and store buffer overflow rates" )
+		(KnobMinQuantumSize, knob::value<unsigned>()->default_value(100), "Smallest quantum size with adaptive quanta (insns, or predicted cycles with --" KnobBlockCostPredictor ")")
+		(KnobMaxQuantumSize, knob::value<unsigned>()->default_value(100000), "Largest quantum size with adaptive quanta (insns, or predicted cycles with --" KnobBlockCostPredictor ")")
+		(KnobModelCommit, "Charge each quantum round for writing back its dirty lines at commit" )
+		(KnobOverlapCommit, "Overlap each commit with the next quantum round's execution" )
+		(KnobCommitLatency, knob::value<uint64_t>()->default_value(20), "Fixed cycles per commit")
+		(KnobCommitLineCycles, knob::value<uint64_t>()->default_value(4), "Cycles for one core to write back one dirty line at commit")
+		(KnobCommitBandwidth, knob::value<uint64_t>()->default_value(2), "Dirty lines per cycle the shared level accepts from all cores at commit")
+		(KnobNondetShards, knob::value<unsigned>()->default_value(0), "Host threads that simulate the caches in parallel, each owning a power-of-2 slice of the sets (nondet only; 0 disables)")
 		;
 
 	knob::store( knob::parse_command_line(argc, argv, desc), s_knobs );
@@ -471,10 +720,31 @@ int main(int argc, char** argv) {
 	}
 
 	// can only simulate one execution strategy at a time
-	assert( s_knobs.count(KnobTSO) + s_knobs.count(KnobHB) + s_knobs.count(KnobNondet) == 1 );
+	assert( s_knobs.count(KnobTSO) + s_knobs.count(KnobHB) + s_knobs.count(KnobNondet) +
+			s_knobs.count(KnobDMPO) + s_knobs.count(KnobKendo) == 1 );
 
 	time_t startTime = time( NULL );
 
+	StatsDocument::Format statsFormat;
+	if ( !StatsDocument::formatOf( s_knobs[KnobStatsFormat].as<string>(), statsFormat ) ) {
+		cerr << "[rcdcsim] unknown --" << KnobStatsFormat << " " << s_knobs[KnobStatsFormat].as<string>() << endl;
+		return 1;
+	}
+	string statsFilename = "rcdcsim-stats." + s_knobs[KnobStatsFormat].as<string>();
+	if ( s_knobs.count(KnobStatsFile) ) {
+		statsFilename = s_knobs[KnobStatsFile].as<string>();
+	}
+	string runId;
+	if ( s_knobs.count(KnobRunId) ) {
+		runId = s_knobs[KnobRunId].as<string>();
+	} else {
+		char host[256] = "";
+		gethostname( host, sizeof(host) - 1 );
+		stringstream ss;
+		ss << host << "-" << getpid() << "-" << startTime;
+		runId = ss.str();
+	}
+
 	MultiCacheSimulator<RCDCLine, uint64_t>* sim;
 	CacheConfiguration<RCDCLine> l1config, l2config, l3config;
 	l1config.blockSize = l2config.blockSize = l3config.blockSize = s_knobs[KnobBlockSize].as<unsigned>();
@@ -499,12 +769,175 @@ int main(int argc, char** argv) {
 	SMPCache<RCDCLine, uint64_t>::cache_iter_t it;
 	sim->m_simulateHB = s_knobs.count(KnobHB);
 	sim->m_simulateTSO = s_knobs.count(KnobTSO);
+	sim->m_simulateDMPO = s_knobs.count(KnobDMPO);
+	sim->m_simulateKendo = s_knobs.count(KnobKendo);
   	//sim->core_id = s_knobs.count(KnobCoreId);	//**************************************Mandy: for security check
 	sim->m_quantumSize = s_knobs[KnobQuantumSize].as<unsigned>();
 	sim->m_smartQuantumBuilding = s_knobs.count(KnobSmartQuantumBuilding);
+	if ( s_knobs.count(KnobBlockCostPredictor) ) {
+		sim->useBlockCostPredictor();
+	}
+	if ( s_knobs.count(KnobPreciseHB) && !s_knobs.count(KnobHB) ) {
+		cerr << "[rcdcsim] --" << KnobPreciseHB << " needs --" << KnobHB << endl;
+		return 1;
+	}
+	if ( s_knobs.count(KnobPreciseHB) || s_knobs.count(KnobRaceReport) ) {
+		sim->useHappensBefore( s_knobs.count(KnobPreciseHB), s_knobs.count(KnobRaceReport) );
+	}
+	if ( s_knobs.count(KnobAdaptiveQuantum) ) {
+		const unsigned minSize = s_knobs[KnobMinQuantumSize].as<unsigned>();
+		const unsigned maxSize = s_knobs[KnobMaxQuantumSize].as<unsigned>();
+		if ( 0 == minSize || minSize > maxSize ) {
+			cerr << "[rcdcsim] bad adaptive quantum bounds " << minSize << ".." << maxSize << endl;
+			return 1;
+		}
+		sim->useAdaptiveQuantum( minSize, maxSize );
+	}
+	sim->m_modelCommit = s_knobs.count(KnobModelCommit);
+	sim->m_commit.m_overlap = s_knobs.count(KnobOverlapCommit);
+	sim->m_commit.m_latency = s_knobs[KnobCommitLatency].as<uint64_t>();
+	sim->m_commit.m_lineCycles = s_knobs[KnobCommitLineCycles].as<uint64_t>();
+	sim->m_commit.m_bandwidth = s_knobs[KnobCommitBandwidth].as<uint64_t>();
+	if ( sim->m_commit.m_overlap && !sim->m_modelCommit ) {
+		cerr << "[rcdcsim] --" << KnobOverlapCommit << " needs --" << KnobModelCommit << endl;
+		return 1;
+	}
+	if ( 0 == sim->m_commit.m_bandwidth ) {
+		cerr << "[rcdcsim] --" << KnobCommitBandwidth << " must be positive" << endl;
+		return 1;
+	}
+	if ( s_knobs.count(KnobMissRatioCurves) ) {
+		const double rate = s_knobs[KnobMRCSampleRate].as<double>();
+		if ( !(rate > 0 && rate <= 1) ) {
+			cerr << "[rcdcsim] --" << KnobMRCSampleRate << " must be in (0, 1]" << endl;
+			return 1;
+		}
+		sim->useMissRatioCurves( rate, s_knobs[KnobMRCAssoc].as<unsigned>(), s_knobs[KnobMRCMaxSize].as<uint64_t>() );
+	}
+
+	if ( !ThreadScheduler::policyOfName( s_knobs[KnobSchedPolicy].as<string>(), sim->m_scheduler.m_policy ) ) {
+		cerr << "[rcdcsim] unknown scheduling policy " << s_knobs[KnobSchedPolicy].as<string>() << endl;
+		return 1;
+	}
+	sim->m_scheduler.m_timeSlice = s_knobs[KnobTimeSlice].as<uint64_t>();
+	sim->m_scheduler.m_contextSwitchCycles = s_knobs[KnobContextSwitchCycles].as<uint64_t>();
+	if ( s_knobs.count(KnobAffinity) ) {
+		// parse "tid:core,tid:core,..."
+		stringstream pins( s_knobs[KnobAffinity].as<string>() );
+		string pin;
+		while ( getline( pins, pin, ',' ) ) {
+			unsigned tid, core;
+			if ( 2 != sscanf( pin.c_str(), "%u:%u", &tid, &core ) || core >= sim->NUM_CORES ) {
+				cerr << "[rcdcsim] bad affinity specification " << pin << endl;
+				return 1;
+			}
+			sim->m_scheduler.setAffinity( tid, core );
+		}
+	}
+	sim->m_useTLBs = s_knobs.count(KnobUseTLB);
+	const string hugePages = s_knobs[KnobHugePages].as<string>();
+	if ( "none" == hugePages ) sim->m_hugePages = HUGE_PAGES_NONE;
+	else if ( "all" == hugePages ) sim->m_hugePages = HUGE_PAGES_ALL;
+	else if ( "large-allocs" == hugePages ) sim->m_hugePages = HUGE_PAGES_LARGE_ALLOCS;
+	else {
+		cerr << "[rcdcsim] unknown huge page policy " << hugePages << endl;
+		return 1;
+	}
+
+	TLBConfiguration tlbconfig;
+	tlbconfig.l1Entries = s_knobs[KnobL1DTLBEntries].as<unsigned>();
+	tlbconfig.l1Assoc = s_knobs[KnobL1DTLBAssoc].as<unsigned>();
+	tlbconfig.l1HugeEntries = s_knobs[KnobL1DTLBHugeEntries].as<unsigned>();
+	tlbconfig.l1HugeAssoc = s_knobs[KnobL1DTLBAssoc].as<unsigned>();
+	tlbconfig.l2Entries = s_knobs[KnobL2DTLBEntries].as<unsigned>();
+	tlbconfig.l2HugeEntries = s_knobs[KnobL2DTLBHugeEntries].as<unsigned>();
+	tlbconfig.l2Assoc = s_knobs[KnobL2DTLBAssoc].as<unsigned>();
+	tlbconfig.pwcEntries = s_knobs[KnobPageWalkCacheEntries].as<unsigned>();
+
+	CacheConfiguration<RCDCLine> l1iconfig;
+	l1iconfig.blockSize = s_knobs[KnobBlockSize].as<unsigned>();
+	l1iconfig.assoc = s_knobs[KnobL1IAssoc].as<unsigned>();
+	l1iconfig.cacheSize = s_knobs[KnobL1ISize].as<unsigned>();
+
 	for ( it = sim->m_allCaches.begin(); it != sim->m_allCaches.end(); it++ ) {
 		// per-cache initialization goes here
 		(*it)->useDetStoreBuffers = (sim->m_simulateHB || sim->m_simulateTSO);
+		if ( s_knobs.count(KnobUseL1I) ) {
+			(*it)->enableICache( l1iconfig );
+		}
+		if ( sim->m_useTLBs ) {
+			(*it)->enableTLBs( tlbconfig );
+		}
+	}
+
+	const unsigned shards = s_knobs[KnobNondetShards].as<unsigned>();
+	if ( s_knobs.count(KnobSharingReport) ) {
+		if ( sim->NUM_CORES > 64 || shards > 0 ) {
+			cerr << "[rcdcsim] --" << KnobSharingReport << " supports at most 64 cores, and no --" << KnobNondetShards << endl;
+			return 1;
+		}
+		sim->useSharingTracker();
+	}
+	if ( s_knobs.count(KnobPCReport) ) {
+		if ( shards > 0 ) {
+			cerr << "[rcdcsim] --" << KnobPCReport << " doesn't work with --" << KnobNondetShards << endl;
+			return 1;
+		}
+		const string symbols = s_knobs.count(KnobPCSymbols) ? s_knobs[KnobPCSymbols].as<string>() : "";
+		if ( !sim->usePCProfile( symbols ) ) {
+			cerr << "[rcdcsim] can't read " << symbols << endl;
+			return 1;
+		}
+	}
+	if ( s_knobs.count(KnobCoherenceMatrix) ) {
+		if ( shards > 0 ) {
+			cerr << "[rcdcsim] --" << KnobCoherenceMatrix << " doesn't work with --" << KnobNondetShards << endl;
+			return 1;
+		}
+		sim->useCoherenceTraffic();
+	}
+	if ( s_knobs.count(KnobAllocReport) ) {
+		if ( shards > 0 ) {
+			cerr << "[rcdcsim] --" << KnobAllocReport << " doesn't work with --" << KnobNondetShards << endl;
+			return 1;
+		}
+		const string symbols = s_knobs.count(KnobPCSymbols) ? s_knobs[KnobPCSymbols].as<string>() : "";
+		if ( !sim->useAllocationMap( symbols ) ) {
+			cerr << "[rcdcsim] can't read " << symbols << endl;
+			return 1;
+		}
+	}
+	if ( shards > 0 ) {
+		if ( !s_knobs.count(KnobNondet) || sim->m_useTLBs || 0 != (shards & (shards - 1)) ) {
+			cerr << "[rcdcsim] " << KnobNondetShards << " needs a power of 2, --" << KnobNondet << " and no --" << KnobUseTLB << endl;
+			return 1;
+		}
+		sim->useShards( shards, l1config,
+				s_knobs.count(KnobUseL2), l2config,
+				s_knobs.count(KnobUseL3), l3config,
+				s_knobs.count(KnobUseL1I), l1iconfig );
+	}
+
+	ofstream intervalFile;
+	const uint64_t intervalInsns = s_knobs[KnobIntervalInsns].as<uint64_t>();
+	const uint64_t intervalRounds = s_knobs[KnobIntervalRounds].as<uint64_t>();
+	if ( 0 != intervalInsns || 0 != intervalRounds ) {
+		intervalFile.open( s_knobs[KnobIntervalFile].as<string>().c_str(), ios::binary | ios::trunc );
+		if ( !intervalFile.good() ) {
+			cerr << "[rcdcsim] can't open " << s_knobs[KnobIntervalFile].as<string>() << endl;
+			return 1;
+		}
+		s_intervals = new IntervalStats( intervalFile, Counter::allCounters(), intervalInsns, intervalRounds );
+	}
+
+	if ( s_knobs.count(KnobTelemetrySocket) ) {
+		s_telemetry = new TelemetryServer();
+		if ( !s_telemetry->start( s_knobs[KnobTelemetrySocket].as<string>() ) ) {
+			cerr << "[rcdcsim] can't listen on " << s_knobs[KnobTelemetrySocket].as<string>() << endl;
+			return 1;
+		}
+		s_telemetryIntervalMillis = s_knobs[KnobTelemetryInterval].as<uint64_t>();
+		s_inputLag = new InputLag( s_knobs[KnobToSimulatorFifo].as<string>() );
 	}
 
 	ifstream eventFifo;
@@ -513,7 +946,9 @@ int main(int argc, char** argv) {
 
 
 	// main event loop
+	const double eventLoopStart = secondsNow();
 	processEvents( sim, eventFifo );
+	const double eventLoopSeconds = secondsNow() - eventLoopStart;
 
 
 
@@ -521,65 +956,79 @@ int main(int argc, char** argv) {
 
 	eventFifo.close();
 
-	// each stat is dumped as a Python dictionary object
-	stringstream prefix;
-	/*  prefix << "{'RCDCStat':True, ";
-
-	    prefix << "'determinismStrategy': '" << nameOfDetStrategy() << "', ";
-	    prefix << "'quantumSize': '" << (s_knobs[KnobQuantumSize].as<unsigned>()/1000) << "k', ";
-	    prefix << "'smartQuantumBuilding': " << pyOfBool( s_knobs.count(KnobSmartQuantumBuilding) ) << ", ";
-
-	    prefix << "'threads': " << s_knobs[KnobThreads].as<unsigned>() << ", ";
-	    prefix << "'workload': '" << s_knobs[KnobWorkload].as<string>() << "', ";
-	    prefix << "'input': '" << s_knobs[KnobInput].as<string>() << "', ";
-	    prefix << "'scheme': '" << s_knobs[KnobScheme].as<string>() << "', ";
-
-	    prefix << "'cores': '" << s_knobs[KnobCores].as<unsigned>() << "p', ";
-
-	    prefix << "'ignoreStackRefs': " << pyOfBool( s_knobs.count(KnobIgnoreStackRefs) ) << ", ";
-
-	    prefix << "'BlockSize': " << s_knobs[KnobBlockSize].as<unsigned>() << ", ";
-	    prefix << "'l1Assoc': " << s_knobs[KnobL1Assoc].as<unsigned>() << ", ";
-	    prefix << "'l1Size': " << s_knobs[KnobL1Size].as<unsigned>() << ", ";
-
-	    prefix << "'useL2': " << pyOfBool( s_knobs.count(KnobUseL2) ) << ", ";
-	    prefix << "'l2Assoc': " << s_knobs[KnobL2Assoc].as<unsigned>() << ", ";
-	    prefix << "'l2Size': " << s_knobs[KnobL2Size].as<unsigned>() << ", ";
-
-	    prefix << "'useL3': " << pyOfBool( s_knobs.count(KnobUseL3) ) << ", ";
-	    prefix << "'l3Assoc': " << s_knobs[KnobL3Assoc].as<unsigned>() << ", ";
-	    prefix << "'l3Size': " << s_knobs[KnobL3Size].as<unsigned>() << ", ";*/
-
-	// actual stat value goes here
-	string suffix = "}\n";
-
-	// check for filename collisions and rename around them
-	string statsFilename = s_knobs["statsfile"].as<string>();
-	while ( fileExists( statsFilename ) ) {
-		statsFilename += ".1";
-	}
-	ofstream statsFile( statsFilename.c_str(), ios_base::trunc );
+	// each stat is dumped as a Python dictionary object, one per line; the
+	// structured formats are built from these lines
+	const string prefix = "{";
+	const string suffix = "}\n";
+	stringstream stats;
+	dumpRunInfo( stats, prefix, suffix, desc, argc, argv, runId );
 
 	// dump stats from the caches
-	sim->dumpStats( statsFile, prefix.str(), suffix );
+	sim->dumpStats( stats, prefix, suffix );
+	PROFILE_DUMP( stats, prefix, suffix );
 
 	// dump "global" stats
 
-	double minutes = difftime( time( NULL ), startTime ) / 60.0;
-	statsFile << prefix.str() << "'SimulationRunningTimeMinutes': " << minutes << suffix;
-
-	statsFile << prefix.str() << "'maxLiveThreads': " << s_maxLiveThreads << suffix;
-	statsFile << prefix.str() << "'numSpawnedThreads': " << s_numSpawnedThreads << suffix;
-	statsFile << prefix.str() << "'numStackAccesses': " << s_stackAccesses << suffix;
-	statsFile << prefix.str() << "'numTotalInstructions': " << s_insnsExecuted << suffix;
-	statsFile << prefix.str() << "'causalityInducedEventDelays': " << s_causalityDelays << suffix;
-	statsFile << prefix.str() << "'unprocessedEvents': " << s_unprocessedEvents << suffix;
-	statsFile << prefix.str() << "'forcedCommits': " << s_forcedCommits << suffix;
-
+	const time_t endTime = time( NULL );
+	double minutes = difftime( endTime, startTime ) / 60.0;
+	stats << prefix << "'SimulationRunningTimeMinutes': " << minutes << suffix;
+
+	stats << prefix << "'maxLiveThreads': " << s_maxLiveThreads << suffix;
+	stats << prefix << "'numSpawnedThreads': " << s_numSpawnedThreads << suffix;
+	stats << prefix << "'numStackAccesses': " << s_stackAccesses << suffix;
+	stats << prefix << "'numTotalInstructions': " << s_insnsExecuted << suffix;
+	stats << prefix << "'causalityInducedEventDelays': " << s_causalityDelays << suffix;
+	stats << prefix << "'unprocessedEvents': " << s_unprocessedEvents << suffix;
+	stats << prefix << "'eventWakeups': " << s_eventWakeups << suffix;
+	stats << prefix << "'peakBufferedEvents': " << s_peakBufferedEvents << suffix;
+	stats << prefix << "'peakInMemoryEventsPerThread': " << s_peakInMemoryEventsPerThread << suffix;
+	stats << prefix << "'spilledEvents': " << s_spilledEvents << suffix;
+
+	stats << prefix << "'RunTiming': {'startTime': " << startTime << ", 'endTime': " << endTime
+	      << ", 'wallSeconds': " << difftime( endTime, startTime )
+	      << ", 'cpuSeconds': " << double( clock() ) / CLOCKS_PER_SEC
+	      << ", 'eventLoopSeconds': " << eventLoopSeconds << "}" << suffix;
+
+	// every run of a sweep adds its row to one csv file
+	stringstream out;
+	bool append = false;
+	if ( StatsDocument::PYTHON == statsFormat ) {
+		out << stats.str();
+	} else {
+		StatsDocument doc;
+		const vector<Counter*>& counters = Counter::allCounters();
+		for ( unsigned i = 0; i < counters.size(); i++ ) {
+			if ( counters[i]->global() ) doc.markGlobal( counters[i]->name() );
+		}
+		doc.addLines( stats.str() );
+		if ( StatsDocument::JSON == statsFormat ) {
+			doc.writeJson( out );
+		} else {
+			ifstream existing;
+			if ( fileExists( statsFilename ) ) existing.open( statsFilename.c_str() );
+			append = doc.writeCsv( out, runId, existing );
+		}
+	}
+	ofstream statsFile( statsFilename.c_str(), append ? ios_base::app : ios_base::trunc );
+	if ( !statsFile.good() ) {
+		cerr << "[rcdcsim] can't write " << statsFilename << endl;
+		return 1;
+	}
+	statsFile << out.str();
 	statsFile.close();
+
+	if ( s_intervals ) {
+		// the last, partial interval also picks up the end-of-run adjustments
+		// to the counters, so the deltas add up to the totals in the stats file
+		s_intervals->snapshot( s_insnsExecuted, sim->numQuantumRounds() );
+		delete s_intervals;
+		intervalFile.close();
+	}
 	cerr << "[rcdcsim] finished generating stats for " << nameOfDetStrategy() << endl;
 
 	delete sim;
+	delete s_telemetry;
+	delete s_inputLag;
 
 	cerr << "[rcdcsim] simulation process exiting" << endl;
 
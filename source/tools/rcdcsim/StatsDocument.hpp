@@ -0,0 +1,501 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATSDOCUMENT_HPP_
+#define STATSDOCUMENT_HPP_
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+/*
+ * Structured stats output. Every module dumps its stats as one Python dict
+ * literal per line (see the dumpStats() methods); a StatsDocument parses those
+ * lines and regroups them into one JSON document per run, or into one row of a
+ * wide CSV (a column per stat) that all the runs of a sweep can share:
+ *   {'RunMetadata': {...}}, {'RunConfig': {...}}, {'RunWorkload': {...}} and
+ *     {'RunTiming': {...}} become the metadata, config, workload and timing
+ *   {'cpuid': c, 'name': v} becomes cores[c].name, unless a system-wide
+ *     Counter called name was marked global (those are dumped with cpuid 0)
+ *   {'tid': t, 'name': v} becomes threads[t].name
+ *   any other line with a single entry becomes global.name
+ *   lines with several entries are rows of a table named after their first key
+ * Lines that don't parse are kept verbatim, in "unparsed".
+ */
+class StatsDocument {
+public:
+  enum Format { PYTHON, JSON, CSV };
+
+  /** Which --stats-format name selects, or false if none does. */
+  static bool formatOf( const std::string& name, Format& f ) {
+    if ( "py" == name ) f = PYTHON;
+    else if ( "json" == name ) f = JSON;
+    else if ( "csv" == name ) f = CSV;
+    else return false;
+    return true;
+  }
+
+  /** s as a single-quoted Python string literal */
+  static std::string pyQuote( const std::string& s ) {
+    std::string q = "'";
+    for ( unsigned i = 0; i < s.size(); i++ ) {
+      if ( '\'' == s[i] || '\\' == s[i] ) q += '\\';
+      q += s[i];
+    }
+    return q + "'";
+  }
+
+private:
+  typedef std::pair<std::string, std::string> Entry; // key, value as JSON
+
+  /** A JSON object that keeps its keys in the order they were first set. */
+  class Section {
+  public:
+    std::vector<Entry> entries;
+    std::map<std::string, unsigned> index;
+
+    void set( const std::string& key, const std::string& json ) {
+      std::map<std::string, unsigned>::iterator it = index.find( key );
+      if ( it != index.end() ) {
+        entries[it->second].second = json;
+      } else {
+        index[key] = entries.size();
+        entries.push_back( Entry( key, json ) );
+      }
+    }
+  };
+
+  /** Recursive-descent parser for the Python literals the dumpers write:
+   * dicts, lists, tuples, strings, numbers, True, False and None. Values come
+   * out as JSON text; dict keys that aren't strings are stringified. */
+  class PyParser {
+    const std::string& m_s;
+    size_t m_i;
+
+    void skipSpace() {
+      while ( m_i < m_s.size() && isspace( (unsigned char) m_s[m_i] ) ) m_i++;
+    }
+    bool eat( char c ) {
+      skipSpace();
+      if ( m_i < m_s.size() && m_s[m_i] == c ) {
+        m_i++;
+        return true;
+      }
+      return false;
+    }
+    bool peek( char c ) {
+      skipSpace();
+      return m_i < m_s.size() && m_s[m_i] == c;
+    }
+
+    bool sequence( char close, std::string& json ) {
+      json = "[";
+      while ( !eat( close ) ) {
+        std::string v;
+        if ( json.size() > 1 && !eat( ',' ) ) return false;
+        if ( peek( close ) ) continue; // trailing comma
+        if ( !value( v ) ) return false;
+        json += ( json.size() > 1 ? ", " : "" ) + v;
+      }
+      json += "]";
+      return true;
+    }
+
+  public:
+    PyParser( const std::string& s ) : m_s( s ), m_i( 0 ) {}
+
+    bool atEnd() {
+      skipSpace();
+      return m_i == m_s.size();
+    }
+
+    /** A quoted string, without its quotes and escapes. */
+    bool string( std::string& out ) {
+      skipSpace();
+      if ( m_i >= m_s.size() || ( '\'' != m_s[m_i] && '"' != m_s[m_i] ) ) return false;
+      const char quote = m_s[m_i++];
+      out.clear();
+      while ( m_i < m_s.size() && m_s[m_i] != quote ) {
+        if ( '\\' == m_s[m_i] && m_i + 1 < m_s.size() ) m_i++;
+        out += m_s[m_i++];
+      }
+      return eat( quote );
+    }
+
+    /** The key of a dict entry, and the colon after it. */
+    bool key( std::string& k ) {
+      if ( peek( '\'' ) || peek( '"' ) ) {
+        if ( !string( k ) ) return false;
+      } else {
+        std::string json;
+        if ( !value( json ) ) return false;
+        k = json;
+      }
+      return eat( ':' );
+    }
+
+    /** A dict, as its entries. */
+    bool dict( std::vector<Entry>& entries ) {
+      if ( !eat( '{' ) ) return false;
+      while ( !eat( '}' ) ) {
+        if ( !entries.empty() && !eat( ',' ) ) return false;
+        if ( peek( '}' ) ) continue; // trailing comma
+        Entry e;
+        if ( !key( e.first ) || !value( e.second ) ) return false;
+        entries.push_back( e );
+      }
+      return true;
+    }
+
+    bool value( std::string& json ) {
+      skipSpace();
+      if ( m_i >= m_s.size() ) return false;
+      const char c = m_s[m_i];
+      if ( '{' == c ) {
+        std::vector<Entry> entries;
+        if ( !dict( entries ) ) return false;
+        json = "{";
+        for ( unsigned i = 0; i < entries.size(); i++ ) {
+          json += ( i > 0 ? ", " : "" ) + jsonQuote( entries[i].first ) + ": " + entries[i].second;
+        }
+        json += "}";
+        return true;
+      }
+      if ( '[' == c ) return eat( '[' ) && sequence( ']', json );
+      if ( '(' == c ) return eat( '(' ) && sequence( ')', json );
+      if ( '\'' == c || '"' == c ) {
+        std::string s;
+        if ( !string( s ) ) return false;
+        json = jsonQuote( s );
+        return true;
+      }
+      // numbers and names
+      const size_t start = m_i;
+      while ( m_i < m_s.size() && ( isalnum( (unsigned char) m_s[m_i] ) ||
+                                    strchr( "+-._", m_s[m_i] ) ) ) {
+        m_i++;
+      }
+      const std::string word = m_s.substr( start, m_i - start );
+      if ( word.empty() ) return false;
+      // JSON's names too, so that values can be parsed again
+      if ( "True" == word || "true" == word ) json = "true";
+      else if ( "False" == word || "false" == word ) json = "false";
+      else if ( "None" == word || "null" == word ) json = "null";
+      else {
+        // C++ streams print non-finite doubles as inf and nan, which JSON lacks
+        char* end;
+        const double d = strtod( word.c_str(), &end );
+        if ( *end != '\0' ) return false;
+        json = d == d && d - d == 0 ? word : "null";
+      }
+      return true;
+    }
+  };
+
+  Section m_metadata;
+  Section m_config;
+  Section m_workload;
+  Section m_timing;
+  Section m_global;
+  std::vector<Section> m_cores;
+  std::vector<Section> m_threads;
+  /** table name -> rows */
+  std::map<std::string, std::vector<Section> > m_tables;
+  /** table names, in the order they first appeared */
+  std::vector<std::string> m_tableOrder;
+  std::vector<std::string> m_unparsed;
+  std::set<std::string> m_globalCounters;
+
+  static std::string jsonQuote( const std::string& s ) {
+    std::string q = "\"";
+    for ( unsigned i = 0; i < s.size(); i++ ) {
+      const unsigned char c = s[i];
+      if ( '"' == c || '\\' == c ) {
+        q += '\\';
+        q += c;
+      } else if ( c < 0x20 ) {
+        char buf[8];
+        snprintf( buf, sizeof(buf), "\\u%04x", c );
+        q += buf;
+      } else {
+        q += c;
+      }
+    }
+    return q + "\"";
+  }
+
+  /** s as one CSV field */
+  static std::string csvQuote( const std::string& s ) {
+    if ( s.find_first_of( ",\"\n" ) == std::string::npos ) return s;
+    std::string q = "\"";
+    for ( unsigned i = 0; i < s.size(); i++ ) {
+      if ( '"' == s[i] ) q += '"';
+      q += s[i];
+    }
+    return q + "\"";
+  }
+
+  static Section& slot( std::vector<Section>& v, const std::string& index ) {
+    const unsigned i = strtoul( index.c_str(), NULL, 10 );
+    if ( i >= v.size() ) v.resize( i + 1 );
+    return v[i];
+  }
+
+  static void writeSection( std::ostream& os, const Section& s, const char* indent ) {
+    os << "{";
+    for ( unsigned i = 0; i < s.entries.size(); i++ ) {
+      os << ( i > 0 ? "," : "" ) << "\n" << indent << "  "
+         << jsonQuote( s.entries[i].first ) << ": " << s.entries[i].second;
+    }
+    os << ( s.entries.empty() ? "" : "\n" ) << ( s.entries.empty() ? "" : indent ) << "}";
+  }
+
+  /** Each element on its own line, as a one-line object. */
+  static void writeRows( std::ostream& os, const std::vector<Section>& rows, const char* indent ) {
+    os << "[";
+    for ( unsigned r = 0; r < rows.size(); r++ ) {
+      os << ( r > 0 ? "," : "" ) << "\n" << indent << "  {";
+      for ( unsigned i = 0; i < rows[r].entries.size(); i++ ) {
+        os << ( i > 0 ? ", " : "" ) << jsonQuote( rows[r].entries[i].first ) << ": "
+           << rows[r].entries[i].second;
+      }
+      os << "}";
+    }
+    os << ( rows.empty() ? "" : "\n" ) << ( rows.empty() ? "" : indent ) << "]";
+  }
+
+  /** Add s's stats to a CSV row, each in a column named prefix.stat */
+  static void csvColumns( Section& row, const std::string& prefix, const Section& s ) {
+    for ( unsigned i = 0; i < s.entries.size(); i++ ) {
+      row.set( prefix + "." + s.entries[i].first, csvField( s.entries[i].second ) );
+    }
+  }
+
+  /** A JSON value as CSV text: strings lose their JSON quoting. */
+  static std::string csvField( const std::string& json ) {
+    PyParser p( json );
+    std::string s;
+    if ( p.string( s ) && p.atEnd() ) return s;
+    return json;
+  }
+
+  static void writeCsvLine( std::ostream& os, const std::vector<std::string>& fields ) {
+    for ( unsigned i = 0; i < fields.size(); i++ ) {
+      os << ( i > 0 ? "," : "" ) << csvQuote( fields[i] );
+    }
+    os << "\n";
+  }
+
+public:
+  /** The system-wide Counter with the given name is dumped with cpuid 0,
+   * but belongs in the global section. */
+  void markGlobal( const std::string& counterName ) {
+    m_globalCounters.insert( counterName );
+  }
+
+  /** Add one line of Python-dict stats. */
+  void addLine( const std::string& line ) {
+    PyParser p( line );
+    std::vector<Entry> entries;
+    if ( line.find_first_not_of( " \t\r\n" ) == std::string::npos ) return;
+    if ( !p.dict( entries ) || !p.atEnd() || entries.empty() ) {
+      m_unparsed.push_back( line );
+      return;
+    }
+
+    const std::string& first = entries[0].first;
+    if ( 1 == entries.size() ) {
+      Section* run = NULL;
+      if ( "RunMetadata" == first ) run = &m_metadata;
+      else if ( "RunConfig" == first ) run = &m_config;
+      else if ( "RunWorkload" == first ) run = &m_workload;
+      else if ( "RunTiming" == first ) run = &m_timing;
+      std::vector<Entry> fields;
+      PyParser value( entries[0].second );
+      if ( run && value.dict( fields ) && value.atEnd() ) {
+        for ( unsigned i = 0; i < fields.size(); i++ ) run->set( fields[i].first, fields[i].second );
+        return;
+      }
+      m_global.set( first, entries[0].second );
+      return;
+    }
+
+    if ( 2 == entries.size() && "cpuid" == first ) {
+      const std::string& name = entries[1].first;
+      if ( m_globalCounters.count( name ) ) {
+        m_global.set( name, entries[1].second );
+      } else {
+        slot( m_cores, entries[0].second ).set( name, entries[1].second );
+      }
+      return;
+    }
+    if ( 2 == entries.size() && "tid" == first ) {
+      slot( m_threads, entries[0].second ).set( entries[1].first, entries[1].second );
+      return;
+    }
+
+    if ( 0 == m_tables.count( first ) ) m_tableOrder.push_back( first );
+    Section row;
+    for ( unsigned i = 0; i < entries.size(); i++ ) row.set( entries[i].first, entries[i].second );
+    m_tables[first].push_back( row );
+  }
+
+  /** Add every line of the given text. */
+  void addLines( const std::string& text ) {
+    std::stringstream ss( text );
+    std::string line;
+    while ( std::getline( ss, line ) ) addLine( line );
+  }
+
+  void writeJson( std::ostream& os ) const {
+    os << "{\n  \"metadata\": ";
+    writeSection( os, m_metadata, "  " );
+    os << ",\n  \"config\": ";
+    writeSection( os, m_config, "  " );
+    os << ",\n  \"workload\": ";
+    writeSection( os, m_workload, "  " );
+    os << ",\n  \"timing\": ";
+    writeSection( os, m_timing, "  " );
+    os << ",\n  \"global\": ";
+    writeSection( os, m_global, "  " );
+    os << ",\n  \"cores\": ";
+    writeRows( os, m_cores, "  " );
+    os << ",\n  \"threads\": ";
+    writeRows( os, m_threads, "  " );
+    os << ",\n  \"tables\": {";
+    for ( unsigned t = 0; t < m_tableOrder.size(); t++ ) {
+      os << ( t > 0 ? "," : "" ) << "\n    " << jsonQuote( m_tableOrder[t] ) << ": ";
+      writeRows( os, m_tables.find( m_tableOrder[t] )->second, "    " );
+    }
+    os << ( m_tableOrder.empty() ? "}" : "\n  }" );
+    os << ",\n  \"unparsed\": [";
+    for ( unsigned i = 0; i < m_unparsed.size(); i++ ) {
+      os << ( i > 0 ? ", " : "" ) << jsonQuote( m_unparsed[i] );
+    }
+    os << "]\n}\n";
+  }
+
+  /** Read one CSV record, which may span lines inside quotes.
+   * @return false at the end of the input */
+  static bool readCsvLine( std::istream& is, std::vector<std::string>& fields ) {
+    fields.clear();
+    if ( EOF == is.peek() ) return false;
+    std::string field;
+    bool quoted = false;
+    char c;
+    while ( is.get( c ) ) {
+      if ( quoted ) {
+        if ( '"' != c ) {
+          field += c;
+        } else if ( '"' == is.peek() ) {
+          field += (char) is.get();
+        } else {
+          quoted = false;
+        }
+      } else if ( '"' == c ) {
+        quoted = true;
+      } else if ( ',' == c ) {
+        fields.push_back( field );
+        field.clear();
+      } else if ( '\n' == c ) {
+        break;
+      } else if ( '\r' != c ) {
+        field += c;
+      }
+    }
+    fields.push_back( field );
+    return true;
+  }
+
+  /** Add this run, as one row, to a wide CSV whose text so far is existing
+   * (empty for a new file). Columns are "run" and then one per stat, named
+   * after its section: config.cores, global.Runtime, core3.numReadHits,
+   * thread0.ThreadInsns, or pc.0.pcMisses for tables (numbered by row).
+   * Values that aren't scalars are written as JSON, and stats a run doesn't
+   * have are left empty.
+   * @return true if os got just the new row, to append to existing; false if
+   * the run added columns, so os got the whole file, rewritten with the union
+   * of the old and new columns */
+  bool writeCsv( std::ostream& os, const std::string& runId, std::istream& existing ) const {
+    Section row;
+    row.set( "run", runId );
+    csvColumns( row, "metadata", m_metadata );
+    csvColumns( row, "config", m_config );
+    csvColumns( row, "workload", m_workload );
+    csvColumns( row, "timing", m_timing );
+    csvColumns( row, "global", m_global );
+    for ( unsigned c = 0; c < m_cores.size(); c++ ) {
+      std::stringstream prefix;
+      prefix << "core" << c;
+      csvColumns( row, prefix.str(), m_cores[c] );
+    }
+    for ( unsigned t = 0; t < m_threads.size(); t++ ) {
+      std::stringstream prefix;
+      prefix << "thread" << t;
+      csvColumns( row, prefix.str(), m_threads[t] );
+    }
+    for ( unsigned t = 0; t < m_tableOrder.size(); t++ ) {
+      const std::vector<Section>& rows = m_tables.find( m_tableOrder[t] )->second;
+      for ( unsigned r = 0; r < rows.size(); r++ ) {
+        std::stringstream prefix;
+        prefix << m_tableOrder[t] << "." << r;
+        csvColumns( row, prefix.str(), rows[r] );
+      }
+    }
+
+    // new columns go after the existing ones, so old rows only need padding
+    std::vector<std::string> header;
+    readCsvLine( existing, header );
+    const unsigned oldColumns = header.size();
+    std::set<std::string> known( header.begin(), header.end() );
+    for ( unsigned i = 0; i < row.entries.size(); i++ ) {
+      if ( known.insert( row.entries[i].first ).second ) header.push_back( row.entries[i].first );
+    }
+    const bool append = header.size() == oldColumns;
+    if ( !append ) {
+      writeCsvLine( os, header );
+      std::vector<std::string> old;
+      while ( readCsvLine( existing, old ) ) {
+        old.resize( header.size() );
+        writeCsvLine( os, old );
+      }
+    }
+
+    std::vector<std::string> fields( header.size() );
+    for ( unsigned i = 0; i < header.size(); i++ ) {
+      std::map<std::string, unsigned>::const_iterator it = row.index.find( header[i] );
+      if ( it != row.index.end() ) fields[i] = row.entries[it->second].second;
+    }
+    writeCsvLine( os, fields );
+    return append;
+  }
+};
+
+#endif /* STATSDOCUMENT_HPP_ */
@@ -0,0 +1,188 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Live telemetry for a running simulation. The simulation thread periodically
+ * publishes a JSON snapshot of its progress; a helper thread serves the latest
+ * snapshot to anyone who connects to a UNIX-domain socket (see rcdcsim-top).
+ * The helper thread never looks at simulator state, so it can't perturb the
+ * simulation, and publishing costs one string copy per interval. While the
+ * front-end is idle, the simulation thread waits for input in InputLag so it
+ * can keep publishing instead of sitting in a blocking read.
+ */
+
+#ifndef TELEMETRY_HPP_
+#define TELEMETRY_HPP_
+
+#include <string>
+#include <cstring>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <assert.h>
+
+class TelemetryServer {
+private:
+  std::string m_path;
+  int m_listenFd;
+  pthread_t m_thread;
+  bool m_running;
+
+  pthread_mutex_t m_lock;
+  /** the latest snapshot; guarded by m_lock */
+  std::string m_snapshot;
+
+  static void* serve( void* arg ) {
+    TelemetryServer* self = (TelemetryServer*) arg;
+    while ( true ) {
+      const int fd = accept( self->m_listenFd, NULL, NULL );
+      if ( fd < 0 ) {
+        if ( EINTR == errno ) continue;
+        break; // shut down by the destructor
+      }
+      pthread_mutex_lock( &self->m_lock );
+      const std::string snapshot = self->m_snapshot;
+      pthread_mutex_unlock( &self->m_lock );
+      // best effort: a client that hangs up early just misses this snapshot
+      size_t sent = 0;
+      while ( sent < snapshot.size() ) {
+        const ssize_t n = send( fd, snapshot.data() + sent, snapshot.size() - sent, MSG_NOSIGNAL );
+        if ( n <= 0 ) break;
+        sent += n;
+      }
+      close( fd );
+    }
+    return NULL;
+  }
+
+public:
+  TelemetryServer() : m_listenFd( -1 ), m_running( false ) {
+    pthread_mutex_init( &m_lock, NULL );
+    m_snapshot = "{}\n";
+  }
+
+  /** Listen on the given socket path, replacing any stale socket there.
+   * @return whether the socket could be set up */
+  bool start( const std::string& path ) {
+    assert( !m_running );
+    sockaddr_un addr;
+    if ( path.size() >= sizeof(addr.sun_path) ) return false;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, path.c_str() );
+
+    m_listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( m_listenFd < 0 ) return false;
+    unlink( path.c_str() );
+    if ( 0 != bind( m_listenFd, (sockaddr*) &addr, sizeof(addr) ) ||
+         0 != listen( m_listenFd, 16 ) ) {
+      close( m_listenFd );
+      m_listenFd = -1;
+      return false;
+    }
+    m_path = path;
+    if ( 0 != pthread_create( &m_thread, NULL, serve, this ) ) {
+      close( m_listenFd );
+      unlink( m_path.c_str() );
+      m_listenFd = -1;
+      return false;
+    }
+    m_running = true;
+    return true;
+  }
+
+  ~TelemetryServer() {
+    if ( m_running ) {
+      // wakes the helper thread out of accept()
+      shutdown( m_listenFd, SHUT_RDWR );
+      pthread_join( m_thread, NULL );
+      close( m_listenFd );
+      unlink( m_path.c_str() );
+    }
+    pthread_mutex_destroy( &m_lock );
+  }
+
+  void publish( const std::string& json ) {
+    pthread_mutex_lock( &m_lock );
+    m_snapshot = json;
+    pthread_mutex_unlock( &m_lock );
+  }
+
+};
+
+/** How far the simulator is behind its input, in bytes. */
+class InputLag {
+private:
+  /** a second, non-blocking read end of the fifo, for FIONREAD; -1 if the input is a regular file */
+  int m_fifoFd;
+  /** size of the input if it is a regular file */
+  uint64_t m_fileSize;
+
+public:
+  InputLag( const std::string& path ) : m_fifoFd( -1 ), m_fileSize( 0 ) {
+    struct stat st;
+    if ( 0 != stat( path.c_str(), &st ) ) return;
+    if ( S_ISFIFO( st.st_mode ) ) {
+      m_fifoFd = open( path.c_str(), O_RDONLY | O_NONBLOCK );
+    } else {
+      m_fileSize = st.st_size;
+    }
+  }
+
+  ~InputLag() {
+    if ( m_fifoFd >= 0 ) close( m_fifoFd );
+  }
+
+  /** Bytes written by the front-end that haven't been consumed yet. For a fifo,
+   * this doesn't include what the ifstream has already buffered. */
+  uint64_t bytesWaiting( uint64_t bytesConsumed ) const {
+    if ( m_fifoFd >= 0 ) {
+      int n = 0;
+      return 0 == ioctl( m_fifoFd, FIONREAD, &n ) ? n : 0;
+    }
+    return m_fileSize > bytesConsumed ? m_fileSize - bytesConsumed : 0;
+  }
+
+  /** Wait until the front-end writes something or hangs up, for at most
+   * timeoutMillis. Never waits on a regular file, which can't block.
+   * @return false if the wait timed out */
+  bool waitForInput( uint64_t timeoutMillis ) const {
+    if ( m_fifoFd < 0 ) return true;
+    pollfd p;
+    p.fd = m_fifoFd;
+    p.events = POLLIN;
+    p.revents = 0;
+    const int timeout = timeoutMillis > 60000 ? 60000 : timeoutMillis;
+    // errors are treated like input, so the caller falls back to its blocking read
+    return 0 != poll( &p, 1, timeout );
+  }
+
+};
+
+#endif /* TELEMETRY_HPP_ */
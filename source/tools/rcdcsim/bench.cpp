@@ -0,0 +1,362 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Back-end microbenchmark suite, no Pin required. Synthesizes event streams
+ * for a handful of sharing patterns and measures, for each one and each core
+ * count:
+ *
+ *  - "cache": the memory events alone, replayed straight into the SMPCaches of
+ *    a MultiCacheSimulator (threads pinned round-robin to cores), in ns/access
+ *  - "sim": the whole stream, written to a trace file and run through the
+ *    rcdcsim binary, in events/s. The time is rcdcsim's own eventLoopSeconds
+ *    (processEvents() and everything below it), so process startup and stats
+ *    output aren't counted.
+ *
+ * Results go to stdout as one Python dict per line, like the stats files, so
+ * runs from different commits can be compared mechanically.
+ *
+ * usage: bench [-s RCDCSIM] [-m MODE_ARGS] [-c CORES,...] [-n STEPS] [SCENARIO...]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <stdint.h>
+
+#include "rcdcsim.hpp"
+#include "Event.hpp"
+#include "MultiCacheSimulator.hpp"
+
+#include "Counter.hpp"
+vector<Counter*> Counter::s_AllStats;
+vector<Counter*>* Counter::s_OpenGroup = NULL;
+
+using namespace std;
+
+static double seconds() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Builds a well-formed event stream: threads are spawned and joined through
+ * life-lock HB edges, the way the front-end reports pthread_create/join. */
+class TraceGenerator {
+public:
+  vector<Event> m_events;
+
+private:
+  uint64_t m_rng;
+  unsigned m_nextTid;
+
+  static const uint64_t PRIVATE_BASE = 0x10000000ULL;
+  static const uint64_t PRIVATE_REGION = 4 << 20;
+  static const uint64_t SHARED_BASE = 0x80000000ULL;
+  static const uint64_t SHARED_REGION = 64 << 20;
+  static const uint64_t LOCK = 0x42;
+  static const uint64_t LOCKED_COUNTER = 0x200000;
+  static const unsigned BUFFER_LINES = 256;
+
+  /** deterministic, so every run sees the same stream */
+  uint64_t random() {
+    m_rng = m_rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return m_rng >> 33;
+  }
+
+  void put( unsigned tid, EventType type ) {
+    Event e;
+    e.m_tid = tid;
+    e.m_type = type;
+    m_events.push_back( e );
+  }
+
+  void basicBlock( unsigned tid, unsigned step ) {
+    put( tid, BASIC_BLOCK );
+    m_events.back().m_insnCount = 10;
+    m_events.back().m_bbAddr = 0x400000 + (step % 512) * 64;
+    m_events.back().m_bbSize = 40;
+  }
+
+  void access( unsigned tid, bool write, uint64_t addr ) {
+    put( tid, write ? MEMORY_WRITE : MEMORY_READ );
+    m_events.back().m_addr = addr & ~7ULL;
+    m_events.back().m_memOpSize = 8;
+  }
+
+  void sync( unsigned tid, EventType type, uint64_t object, bool lifelock, unsigned source ) {
+    put( tid, type );
+    m_events.back().m_syncObject = object;
+    m_events.back().m_isLifeLock = lifelock;
+    m_events.back().m_hbSourceThread = source;
+  }
+
+  /** tid 0 creates child */
+  void spawn( unsigned child ) {
+    sync( 0, HAPPENS_BEFORE_SOURCE, 1000 + child, true, INVALID_THREADID );
+    put( child, THREAD_START );
+    sync( child, HAPPENS_BEFORE_SINK, 1000 + child, true, 0 );
+  }
+
+  /** tid 0 joins child */
+  void join( unsigned child ) {
+    sync( child, HAPPENS_BEFORE_SOURCE, 1000 + child, true, INVALID_THREADID );
+    put( child, THREAD_FINISH );
+    put( 0, THREAD_BLOCKED );
+    put( 0, THREAD_UNBLOCKED );
+    sync( 0, HAPPENS_BEFORE_SINK, 1000 + child, true, child );
+  }
+
+  /** one step of work by the given thread in the given scenario */
+  void step( const string& scenario, unsigned t, unsigned slot, unsigned threads, unsigned i ) {
+    basicBlock( t, i );
+    if ( "strided" == scenario ) {
+      // each thread sweeps its own array a line at a time
+      for ( unsigned k = 0; k < 4; k++ ) {
+        access( t, 3 == k, PRIVATE_BASE + slot * PRIVATE_REGION + ((i * 4 + k) * 64) % PRIVATE_REGION );
+      }
+    } else if ( "random" == scenario ) {
+      for ( unsigned k = 0; k < 4; k++ ) {
+        access( t, 0 == random() % 4, SHARED_BASE + random() % SHARED_REGION );
+      }
+    } else if ( "prodcons" == scenario ) {
+      // each thread fills its buffer and drains its left neighbor's
+      const unsigned left = (slot + threads - 1) % threads;
+      const uint64_t line = i % BUFFER_LINES;
+      access( t, true, SHARED_BASE + (slot * BUFFER_LINES + line) * 64 );
+      access( t, false, SHARED_BASE + (left * BUFFER_LINES + line) * 64 );
+      access( t, false, PRIVATE_BASE + slot * PRIVATE_REGION + (i % 512) * 8 );
+    } else if ( "pingpong" == scenario ) {
+      // all threads take turns with one lock; the previous holder is the HB source
+      sync( t, HAPPENS_BEFORE_SINK, LOCK, false, (0 == i && 0 == slot) ? INVALID_THREADID : m_lastHolder );
+      access( t, false, LOCKED_COUNTER );
+      access( t, true, LOCKED_COUNTER );
+      sync( t, HAPPENS_BEFORE_SOURCE, LOCK, false, INVALID_THREADID );
+      m_lastHolder = t;
+    } else {
+      assert( "churn" == scenario );
+      access( t, false, SHARED_BASE + (i % BUFFER_LINES) * 64 );
+      access( t, true, PRIVATE_BASE + slot * PRIVATE_REGION + (i % 512) * 64 );
+    }
+  }
+
+  unsigned m_lastHolder;
+
+public:
+  static bool isScenario( const string& s ) {
+    return "strided" == s || "random" == s || "prodcons" == s || "pingpong" == s || "churn" == s;
+  }
+
+  /** @param steps steps of work per thread (for churn: in total, per worker slot) */
+  TraceGenerator( const string& scenario, unsigned threads, unsigned steps ) :
+    m_rng( 42 ), m_nextTid( 1 ), m_lastHolder( 0 ) {
+    put( 0, THREAD_START );
+
+    // churn runs short-lived workers in waves, everyone else runs one long-lived wave
+    const unsigned waves = "churn" == scenario ? 32 : 1;
+    const unsigned stepsPerWave = max( 1u, steps / waves );
+    for ( unsigned w = 0; w < waves; w++ ) {
+      vector<unsigned> tids( 1, 0 );
+      for ( unsigned t = 1; t < threads; t++ ) {
+        tids.push_back( m_nextTid++ );
+        spawn( tids.back() );
+      }
+      for ( unsigned i = 0; i < stepsPerWave; i++ ) {
+        for ( unsigned slot = 0; slot < threads; slot++ ) {
+          step( scenario, tids[slot], slot, threads, w * stepsPerWave + i );
+        }
+      }
+      for ( unsigned t = 1; t < threads; t++ ) {
+        join( tids[t] );
+      }
+    }
+
+    put( 0, THREAD_FINISH );
+  }
+};
+
+/** @return ns per memory access, replayed directly into the caches */
+static double benchCaches( const vector<Event>& events, unsigned cores, uint64_t& accesses ) {
+  CacheConfiguration<RCDCLine> l1config, l2config;
+  l1config.blockSize = l2config.blockSize = 64;
+  l1config.callbacks = l2config.callbacks = NULL;
+  l1config.assoc = l2config.assoc = 8;
+  l1config.cacheSize = 1 << 15;
+  l2config.cacheSize = 1 << 18;
+  MultiCacheSimulator<RCDCLine, uint64_t> sim( cores, l1config, true, l2config, false, l2config );
+
+  accesses = 0;
+  const double start = seconds();
+  for ( unsigned i = 0; i < events.size(); i++ ) {
+    const Event& e = events[i];
+    if ( MEMORY_READ == e.m_type ) {
+      sim.m_allCaches[ e.m_tid % cores ]->read( DataAccess( READ_ACCESS, e.m_addr, e.m_memOpSize, 64 ) );
+    } else if ( MEMORY_WRITE == e.m_type ) {
+      sim.m_allCaches[ e.m_tid % cores ]->write( DataAccess( WRITE_ACCESS, e.m_addr, e.m_memOpSize, 64 ), false );
+    } else {
+      continue;
+    }
+    accesses++;
+  }
+  return (seconds() - start) * 1e9 / max( accesses, uint64_t(1) );
+}
+
+/** @return the eventLoopSeconds that the rcdcsim binary reports for
+ * consuming the trace, or a negative number if it failed */
+static double benchSimulator( const string& simulator, const vector<Event>& events,
+                              unsigned cores, const string& modeArgs ) {
+  char trace[] = "/tmp/rcdcsim-bench-trace.XXXXXX";
+  const int fd = mkstemp( trace );
+  if ( fd < 0 ) return -1;
+  close( fd );
+  {
+    ofstream out( trace, ios::binary | ios::trunc );
+    out.write( (const char*) &events[0], events.size() * sizeof(Event) );
+  }
+  const string stats = string( trace ) + ".py";
+
+  stringstream cmd;
+  cmd << simulator << " " << modeArgs << " --cores " << cores << " --tosim-fifo " << trace
+      << " --statsfile " << stats << " --stats-format py > /dev/null 2>&1";
+  const int status = system( cmd.str().c_str() );
+
+  double elapsed = -1;
+  if ( -1 != status && WIFEXITED(status) && 0 == WEXITSTATUS(status) ) {
+    static const string KEY = "'eventLoopSeconds': ";
+    ifstream in( stats.c_str() );
+    string line;
+    while ( getline( in, line ) ) {
+      const size_t at = line.find( KEY );
+      if ( string::npos != at ) {
+        elapsed = strtod( line.c_str() + at + KEY.size(), NULL );
+        break;
+      }
+    }
+  }
+
+  unlink( trace );
+  unlink( stats.c_str() );
+  return elapsed;
+}
+
+/** short hash of the checked-out commit, so results can be tracked over time */
+static string gitCommit() {
+  FILE* git = popen( "git rev-parse --short HEAD 2>/dev/null", "r" );
+  if ( NULL == git ) return "unknown";
+  char buf[64] = { 0 };
+  const bool ok = NULL != fgets( buf, sizeof(buf), git );
+  pclose( git );
+  string commit( buf );
+  while ( !commit.empty() && '\n' == commit[commit.size() - 1] ) commit.erase( commit.size() - 1 );
+  return ok && !commit.empty() ? commit : "unknown";
+}
+
+static void usage( const char* argv0 ) {
+  cerr << "usage: " << argv0 << " [-s RCDCSIM] [-m MODE_ARGS] [-c CORES,...] [-n STEPS] [SCENARIO...]" << endl;
+  cerr << "  scenarios: strided random prodcons pingpong churn (default: all)" << endl;
+  cerr << "  -s: simulator binary for the end-to-end runs, '' to skip them (default ./rcdcsim)" << endl;
+  cerr << "  -m: simulation mode arguments (default '--nondet --use-l2')" << endl;
+}
+
+int main( int argc, char** argv ) {
+  string simulator = "./rcdcsim";
+  string modeArgs = "--nondet --use-l2";
+  string coreList = "1,2,4,8";
+  unsigned steps = 20000;
+
+  int opt;
+  while ( -1 != (opt = getopt( argc, argv, "s:m:c:n:h" )) ) {
+    switch ( opt ) {
+    case 's': simulator = optarg; break;
+    case 'm': modeArgs = optarg; break;
+    case 'c': coreList = optarg; break;
+    case 'n': steps = strtoul( optarg, NULL, 0 ); break;
+    default: usage( argv[0] ); return 1;
+    }
+  }
+
+  vector<string> scenarios;
+  for ( int i = optind; i < argc; i++ ) {
+    if ( !TraceGenerator::isScenario( argv[i] ) ) {
+      cerr << "[bench] unknown scenario " << argv[i] << endl;
+      usage( argv[0] );
+      return 1;
+    }
+    scenarios.push_back( argv[i] );
+  }
+  if ( scenarios.empty() ) {
+    const char* all[] = { "strided", "random", "prodcons", "pingpong", "churn" };
+    scenarios.assign( all, all + 5 );
+  }
+
+  vector<unsigned> coreCounts;
+  stringstream cores( coreList );
+  string c;
+  while ( getline( cores, c, ',' ) ) {
+    const unsigned n = strtoul( c.c_str(), NULL, 0 );
+    if ( 0 == n ) {
+      cerr << "[bench] bad core count " << c << endl;
+      return 1;
+    }
+    coreCounts.push_back( n );
+  }
+  if ( 0 == steps || coreCounts.empty() ) {
+    usage( argv[0] );
+    return 1;
+  }
+
+  const string commit = gitCommit();
+  bool failed = false;
+  for ( unsigned s = 0; s < scenarios.size(); s++ ) {
+    for ( unsigned n = 0; n < coreCounts.size(); n++ ) {
+      const TraceGenerator gen( scenarios[s], coreCounts[n], steps );
+      const uint64_t events = gen.m_events.size();
+
+      uint64_t accesses;
+      const double nsPerAccess = benchCaches( gen.m_events, coreCounts[n], accesses );
+      cout << "{'commit': '" << commit << "', 'scenario': '" << scenarios[s]
+           << "', 'cores': " << coreCounts[n] << ", 'level': 'cache', 'accesses': " << accesses
+           << ", 'nsPerAccess': " << nsPerAccess << "}" << endl;
+
+      if ( simulator.empty() ) continue;
+      const double elapsed = benchSimulator( simulator, gen.m_events, coreCounts[n], modeArgs );
+      if ( elapsed < 0 ) {
+        cerr << "[bench] " << simulator << " failed on " << scenarios[s] << " with "
+             << coreCounts[n] << " cores" << endl;
+        failed = true;
+        continue;
+      }
+      cout << "{'commit': '" << commit << "', 'scenario': '" << scenarios[s]
+           << "', 'cores': " << coreCounts[n] << ", 'level': 'sim', 'mode': '" << modeArgs
+           << "', 'events': " << events << ", 'seconds': " << elapsed
+           << ", 'eventsPerSec': " << events / elapsed << "}" << endl;
+    }
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Adaptive quantum sizing for Det-TSO/Det-HB. At the end of each quantum
+ * round the quantum size is grown or shrunk based on how the round went. Only
+ * deterministic inputs are used (instruction counts, deterministic memory
+ * latency estimates and the reasons quanta ended), so a real deterministic
+ * system could make the same decisions and the schedule stays reproducible.
+ */
+
+#ifndef ADAPTIVEQUANTUM_HPP_
+#define ADAPTIVEQUANTUM_HPP_
+
+#include <vector>
+#include <ostream>
+#include <string>
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include <assert.h>
+
+#include "Histogram.hpp"
+#include "Counter.hpp"
+
+using namespace std;
+
+class AdaptiveQuantum {
+public:
+  /** All rates are kept in parts per thousand, so everything is integer math. */
+  static const uint64_t ONE = 1000;
+
+  /** Shrink when the smoothed imbalance or sync-boundary rate is above these */
+  static const uint64_t SHRINK_IMBALANCE = 300;
+  static const uint64_t SHRINK_SYNC_RATE = 500;
+  /** Shrink harder when this many quanta end in store buffer overflows */
+  static const uint64_t SHRINK_OVERFLOW_RATE = 250;
+  /** Grow only when the smoothed imbalance and sync rate are below these */
+  static const uint64_t GROW_IMBALANCE = 100;
+  static const uint64_t GROW_SYNC_RATE = 200;
+
+  unsigned m_minSize;
+  unsigned m_maxSize;
+
+private:
+  /** exponentially-weighted moving averages (weight 1/2 for the newest round) */
+  uint64_t m_imbalance;
+  uint64_t m_syncRate;
+  uint64_t m_overflowRate;
+
+  uint64_t m_rounds;
+  uint64_t m_sumOfSizes;
+  uint64_t m_grows;
+  uint64_t m_shrinks;
+  /** how many rounds ran with each quantum size */
+  Histogram m_sizes;
+  /** the size picked for the next round, or 0 before the first round ends.
+   * Interval stats (--interval-rounds) record it as a time series. */
+  Counter m_size;
+
+  static uint64_t ewma( uint64_t avg, uint64_t sample ) {
+    return ( avg + sample ) / 2;
+  }
+
+public:
+
+  AdaptiveQuantum( unsigned minSize, unsigned maxSize ) :
+    m_minSize( minSize ), m_maxSize( maxSize ),
+    m_imbalance( 0 ), m_syncRate( 0 ), m_overflowRate( 0 ),
+    m_rounds( 0 ), m_sumOfSizes( 0 ), m_grows( 0 ), m_shrinks( 0 ),
+    m_sizes( "QuantumSizeHistogram" ), m_size( 0, "QuantumSize", true ) {
+    assert( 0 < minSize && minSize <= maxSize );
+  }
+
+  /** Pick the quantum size for the next round.
+   * @param size the quantum size used in that round
+   * @param work deterministic work (insns plus estimated memory cycles) of each
+   * core this round; cores with no work are ignored
+   * @param insnBoundaries, syncBoundaries, overflowBoundaries how many quanta
+   * ended this round because they ran out of insns, hit a sync op, or
+   * overflowed the store buffer
+   * @return the new quantum size */
+  unsigned roundFinished( unsigned size, const vector<uint64_t>& work, uint64_t insnBoundaries, uint64_t syncBoundaries,
+                          uint64_t overflowBoundaries ) {
+    m_rounds++;
+    m_sumOfSizes += size;
+    m_sizes.record( size );
+
+    const uint64_t quanta = insnBoundaries + syncBoundaries + overflowBoundaries;
+    if ( 0 == quanta ) {
+      // e.g. a round that ended because every thread blocked: nothing to learn
+      m_size.set( size );
+      return size;
+    }
+
+    uint64_t most = 0, least = numeric_limits<uint64_t>::max();
+    unsigned workingCores = 0;
+    for ( unsigned i = 0; i < work.size(); i++ ) {
+      if ( 0 == work[i] ) continue;
+      workingCores++;
+      most = max( most, work[i] );
+      least = min( least, work[i] );
+    }
+    const uint64_t imbalance = workingCores < 2 ? 0 : (most - least) * ONE / most;
+
+    m_imbalance = ewma( m_imbalance, imbalance );
+    m_syncRate = ewma( m_syncRate, syncBoundaries * ONE / quanta );
+    m_overflowRate = ewma( m_overflowRate, overflowBoundaries * ONE / quanta );
+
+    unsigned newSize = size;
+    if ( m_overflowRate > SHRINK_OVERFLOW_RATE ) {
+      // quanta don't fit in the store buffer
+      newSize = size / 2;
+    } else if ( m_imbalance > SHRINK_IMBALANCE || m_syncRate > SHRINK_SYNC_RATE ) {
+      // cores spend too long waiting for each other at round boundaries
+      newSize = size - size / 4;
+    } else if ( m_imbalance < GROW_IMBALANCE && m_syncRate < GROW_SYNC_RATE ) {
+      // rounds are balanced, so amortize commits over more insns
+      newSize = size + max( 1U, size / 4 );
+    }
+    newSize = min( max( newSize, m_minSize ), m_maxSize );
+
+    if ( newSize > size ) m_grows++;
+    if ( newSize < size ) m_shrinks++;
+    m_size.set( newSize );
+    return newSize;
+  }
+
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    os << prefix << "'AverageQuantumSize': " << ( m_rounds ? m_sumOfSizes / m_rounds : 0 ) << suffix;
+    os << prefix << "'QuantumSizeIncreases': " << m_grows << suffix;
+    os << prefix << "'QuantumSizeDecreases': " << m_shrinks << suffix;
+    m_sizes.dump( os, prefix, suffix );
+  }
+
+};
+
+#endif /* ADAPTIVEQUANTUM_HPP_ */
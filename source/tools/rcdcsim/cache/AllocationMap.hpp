@@ -0,0 +1,207 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Attributes cache misses, coherence events and committed dirty lines to the
+ * heap allocations they touch, using the front-end's MEMORY_ALLOCATION and
+ * MEMORY_FREE events, and reports them per allocation site (the return
+ * address of the malloc or new call). Live allocations are kept in a map
+ * ordered by start address. Accesses mostly stay within one object or one gap
+ * between objects for a while, so the last range a lookup resolved is cached
+ * and a lookup is O(1) amortized; the map is only searched when an access
+ * leaves that range.
+ */
+
+#ifndef ALLOCATIONMAP_HPP_
+#define ALLOCATIONMAP_HPP_
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include <assert.h>
+
+#include "FlatHashMap.hpp"
+#include "SymbolTable.hpp"
+#include "StatsDocument.hpp"
+
+using namespace std;
+
+class AllocationMap {
+public:
+  struct SiteStats {
+    uint64_t site;
+    uint64_t allocations;
+    uint64_t bytesAllocated;
+    uint64_t misses;
+    uint64_t remoteHits;
+    uint64_t upgradeMisses;
+    /** dirty lines committed from the det store buffers */
+    uint64_t dirtyLines;
+
+    uint64_t cost() const {
+      return misses + remoteHits + upgradeMisses + dirtyLines;
+    }
+  };
+
+  /** m_sites index of the stats for accesses outside any live allocation
+   * (globals, stacks, and heap memory allocated before tracing started) */
+  static const uint32_t NOT_HEAP = 0;
+
+private:
+  struct Region {
+    uint64_t end;
+    uint32_t site;
+  };
+  /** live allocations, by start address */
+  map<uint64_t, Region> m_live;
+  vector<SiteStats> m_sites;
+  /** allocation site -> index into m_sites */
+  FlatHashMap<uint32_t> m_siteIndex;
+
+  /** the last range a lookup resolved, [m_lastStart, m_lastEnd), which is
+   * either a live allocation or a gap between them */
+  uint64_t m_lastStart;
+  uint64_t m_lastEnd;
+  uint32_t m_lastSite;
+
+  SymbolTable m_symbols;
+
+  static const unsigned TOP_SITES = 20;
+
+  static bool costlier( const SiteStats& a, const SiteStats& b ) {
+    return a.cost() > b.cost();
+  }
+
+  uint32_t indexOfSite( uint64_t site ) {
+    bool inserted;
+    uint32_t& slot = m_siteIndex.findOrInsert( site, inserted );
+    if ( inserted ) {
+      SiteStats s = SiteStats();
+      s.site = site;
+      slot = m_sites.size();
+      m_sites.push_back( s );
+    }
+    return slot;
+  }
+
+  void forgetLastHit() {
+    m_lastStart = m_lastEnd = 0;
+  }
+
+public:
+  AllocationMap() {
+    m_sites.push_back( SiteStats() ); // NOT_HEAP
+    forgetLastHit();
+  }
+
+  /** @param site the allocation's call site, or 0 if the front-end didn't say */
+  void allocated( uint64_t addr, uint64_t size, uint64_t site ) {
+    assert( size > 0 );
+    // free()s we didn't see (e.g. via realloc) can leave stale allocations
+    // that overlap this one
+    map<uint64_t, Region>::iterator it = m_live.lower_bound( addr );
+    if ( it != m_live.begin() ) {
+      map<uint64_t, Region>::iterator prev = it;
+      prev--;
+      if ( prev->second.end > addr ) it = prev;
+    }
+    while ( it != m_live.end() && it->first < addr + size ) {
+      m_live.erase( it++ );
+    }
+
+    Region r;
+    r.end = addr + size;
+    r.site = indexOfSite( site );
+    m_live[addr] = r;
+    m_sites[r.site].allocations++;
+    m_sites[r.site].bytesAllocated += size;
+    forgetLastHit();
+  }
+
+  void freed( uint64_t addr ) {
+    if ( m_live.erase( addr ) > 0 ) forgetLastHit();
+  }
+
+  /** The stats of the allocation site whose memory contains addr.
+   * References are invalidated by later calls to allocated(). */
+  SiteStats& of( uint64_t addr ) {
+    if ( addr - m_lastStart < m_lastEnd - m_lastStart ) return m_sites[ m_lastSite ];
+
+    map<uint64_t, Region>::const_iterator next = m_live.upper_bound( addr );
+    m_lastEnd = next == m_live.end() ? numeric_limits<uint64_t>::max() : next->first;
+    m_lastStart = 0;
+    m_lastSite = NOT_HEAP;
+    if ( next != m_live.begin() ) {
+      map<uint64_t, Region>::const_iterator prev = next;
+      prev--;
+      if ( addr < prev->second.end ) {
+        m_lastStart = prev->first;
+        m_lastEnd = prev->second.end;
+        m_lastSite = prev->second.site;
+      } else {
+        m_lastStart = prev->second.end;
+      }
+    }
+    return m_sites[ m_lastSite ];
+  }
+
+  uint64_t liveAllocations() const {
+    return m_live.size();
+  }
+
+  /** @return whether the symbol file could be read */
+  bool loadSymbols( const string& filename ) {
+    return m_symbols.load( filename );
+  }
+
+  /** Totals for memory outside the heap, then one line for each of the
+   * costliest allocation sites. */
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    const SiteStats& other = m_sites[NOT_HEAP];
+    os << prefix << "'AllocationSites': " << m_sites.size() - 1 << suffix;
+    os << prefix << "'LiveAllocationsAtExit': " << m_live.size() << suffix;
+    os << prefix << "'NonHeapMisses': " << other.misses << suffix;
+    os << prefix << "'NonHeapRemoteHits': " << other.remoteHits << suffix;
+    os << prefix << "'NonHeapUpgradeMisses': " << other.upgradeMisses << suffix;
+    os << prefix << "'NonHeapDirtyLines': " << other.dirtyLines << suffix;
+
+    vector<SiteStats> top( m_sites.begin() + 1, m_sites.end() );
+    const unsigned n = top.size() < TOP_SITES ? top.size() : TOP_SITES;
+    partial_sort( top.begin(), top.begin() + n, top.end(), costlier );
+    for ( unsigned i = 0; i < n && top[i].cost() > 0; i++ ) {
+      os << prefix << "'allocSite': " << top[i].site
+         << ", 'allocSiteSymbol': " << StatsDocument::pyQuote( m_symbols.symbolOf( top[i].site ) )
+         << ", 'allocSiteAllocations': " << top[i].allocations
+         << ", 'allocSiteBytes': " << top[i].bytesAllocated
+         << ", 'allocSiteMisses': " << top[i].misses
+         << ", 'allocSiteRemoteHits': " << top[i].remoteHits
+         << ", 'allocSiteUpgradeMisses': " << top[i].upgradeMisses
+         << ", 'allocSiteDirtyLines': " << top[i].dirtyLines << suffix;
+    }
+  }
+};
+
+#endif /* ALLOCATIONMAP_HPP_ */
@@ -0,0 +1,134 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BLOCKCOSTPREDICTOR_HPP_
+#define BLOCKCOSTPREDICTOR_HPP_
+
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+
+#include "FlatHashMap.hpp"
+
+using namespace std;
+
+/**
+ * Predicts how many cycles a basic block will take, for smart quantum
+ * building. Each thread keeps an exponentially-weighted moving average of the
+ * cycles per insn of each static basic block. The cycles observed must be
+ * deterministic (e.g., insns plus the deterministic memory-latency estimate),
+ * or quanta would end at different places from run to run. Observations made
+ * during a quantum are only folded in when the quantum round ends, so
+ * predictions within a quantum depend only on previous quanta.
+ */
+class BlockCostPredictor {
+public:
+  /** cycles per insn are kept in fixed point with this many fraction bits */
+  static const unsigned FRAC_BITS = 8;
+  /** each quantum's observation gets weight 1/EWMA_WEIGHT */
+  static const uint64_t EWMA_WEIGHT = 4;
+
+private:
+  struct Observation {
+    uint64_t bbAddr;
+    uint64_t cycles;
+    uint64_t insns;
+  };
+
+  /** per thread: basic block address => cycles per insn */
+  vector< FlatHashMap<uint64_t> > m_cpi;
+  /** per thread: cycles per insn over all blocks, or 0 if unknown */
+  vector<uint64_t> m_threadCpi;
+  /** per thread: the blocks run this quantum, in the order they were first run */
+  vector< vector<Observation> > m_observed;
+  /** per thread: basic block address => index into m_observed */
+  vector< FlatHashMap<unsigned> > m_observedIndex;
+
+  void ensureThread( unsigned tid ) {
+    if ( tid >= m_cpi.size() ) {
+      m_cpi.resize( tid + 1 );
+      m_threadCpi.resize( tid + 1, 0 );
+      m_observed.resize( tid + 1 );
+      m_observedIndex.resize( tid + 1 );
+    }
+  }
+
+public:
+
+  /** Predicted cycles for tid to run insns insns of the block at bbAddr.
+   * Blocks the thread hasn't run yet are assumed to run at the thread's
+   * average speed, or a cycle per insn if we know nothing about the thread. */
+  uint64_t predict( unsigned tid, uint64_t bbAddr, uint64_t insns ) const {
+    if ( tid < m_cpi.size() ) {
+      const uint64_t* cpi = m_cpi[tid].find( bbAddr );
+      if ( NULL != cpi ) {
+        return ( insns * *cpi ) >> FRAC_BITS;
+      }
+      if ( 0 != m_threadCpi[tid] ) {
+        return ( insns * m_threadCpi[tid] ) >> FRAC_BITS;
+      }
+    }
+    return insns;
+  }
+
+  /** Record that tid took the given number of cycles to run the block. */
+  void observe( unsigned tid, uint64_t bbAddr, uint64_t insns, uint64_t cycles ) {
+    if ( 0 == insns ) return;
+    ensureThread( tid );
+    bool inserted;
+    unsigned& i = m_observedIndex[tid].findOrInsert( bbAddr, inserted );
+    if ( inserted ) {
+      i = m_observed[tid].size();
+      Observation o = { bbAddr, 0, 0 };
+      m_observed[tid].push_back( o );
+    }
+    Observation& o = m_observed[tid][i];
+    o.cycles += cycles;
+    o.insns += insns;
+  }
+
+  /** Fold this quantum's observations into the predictions. */
+  void quantumRoundFinished() {
+    for ( unsigned tid = 0; tid < m_observed.size(); tid++ ) {
+      uint64_t cycles = 0, insns = 0;
+      for ( unsigned i = 0; i < m_observed[tid].size(); i++ ) {
+        const Observation& o = m_observed[tid][i];
+        cycles += o.cycles;
+        insns += o.insns;
+        const uint64_t cpi = ( o.cycles << FRAC_BITS ) / o.insns;
+        bool inserted;
+        uint64_t& known = m_cpi[tid].findOrInsert( o.bbAddr, inserted );
+        known = inserted ? cpi : ( known * (EWMA_WEIGHT - 1) + cpi ) / EWMA_WEIGHT;
+      }
+      if ( insns > 0 ) {
+        const uint64_t cpi = ( cycles << FRAC_BITS ) / insns;
+        m_threadCpi[tid] = 0 == m_threadCpi[tid] ? cpi
+            : ( m_threadCpi[tid] * (EWMA_WEIGHT - 1) + cpi ) / EWMA_WEIGHT;
+      }
+      m_observed[tid].clear();
+      m_observedIndex[tid].clear();
+    }
+  }
+
+};
+
+#endif /* BLOCKCOSTPREDICTOR_HPP_ */
@@ -0,0 +1,132 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Who talks to whom: NxN matrices of the lines one core's cache supplies to
+ * another's and of the copies one core's writes invalidate in another's, the
+ * number of copies each snooping write invalidates, and the communication
+ * (transfers plus invalidations) in each quantum round of the det schemes.
+ */
+
+#ifndef COHERENCETRAFFIC_HPP_
+#define COHERENCETRAFFIC_HPP_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <assert.h>
+
+#include "Histogram.hpp"
+
+using namespace std;
+
+class CoherenceTraffic {
+private:
+  const unsigned m_cores;
+  /** [from * m_cores + to] */
+  vector<uint64_t> m_transfers;
+  /** [writer * m_cores + victim] */
+  vector<uint64_t> m_invalidations;
+  /** [k]: snooping writes that invalidated k other copies */
+  vector<uint64_t> m_fanOut;
+  uint64_t m_roundVolume;
+  uint64_t m_rounds;
+  Histogram m_roundHistogram;
+
+  void dumpMatrix( ostream& os, const string& prefix, const string& suffix,
+                   const char* name, const vector<uint64_t>& m ) const {
+    os << prefix << "'" << name << "': [";
+    for ( unsigned i = 0; i < m_cores; i++ ) {
+      os << ( i == 0 ? "[" : ", [" );
+      for ( unsigned j = 0; j < m_cores; j++ ) {
+        os << ( j == 0 ? "" : ", " ) << m[i * m_cores + j];
+      }
+      os << "]";
+    }
+    os << "]" << suffix;
+  }
+
+public:
+  CoherenceTraffic( unsigned cores ) :
+    m_cores( cores ),
+    m_transfers( cores * cores, 0 ),
+    m_invalidations( cores * cores, 0 ),
+    m_fanOut( cores, 0 ),
+    m_roundVolume( 0 ),
+    m_rounds( 0 ),
+    m_roundHistogram( "CommunicationPerRoundHistogram" ) {}
+
+  /** Core from supplied a line to core to. */
+  void transfer( unsigned from, unsigned to ) {
+    assert( from < m_cores && to < m_cores && from != to );
+    m_transfers[from * m_cores + to]++;
+    m_roundVolume++;
+  }
+
+  /** A write by core writer invalidated core victim's copy. */
+  void invalidation( unsigned writer, unsigned victim ) {
+    assert( writer < m_cores && victim < m_cores && writer != victim );
+    m_invalidations[writer * m_cores + victim]++;
+    m_roundVolume++;
+  }
+
+  /** A write snooped the other caches and invalidated this many copies. */
+  void snoopingWrite( unsigned invalidatedCopies ) {
+    assert( invalidatedCopies < m_cores );
+    m_fanOut[invalidatedCopies]++;
+  }
+
+  void endRound() {
+    m_roundHistogram.record( m_roundVolume );
+    m_roundVolume = 0;
+    m_rounds++;
+  }
+
+  uint64_t transfers( unsigned from, unsigned to ) const {
+    return m_transfers[from * m_cores + to];
+  }
+  uint64_t invalidations( unsigned writer, unsigned victim ) const {
+    return m_invalidations[writer * m_cores + victim];
+  }
+  uint64_t fanOut( unsigned invalidatedCopies ) const {
+    return m_fanOut[invalidatedCopies];
+  }
+
+  /** Each matrix is one line, a list of rows; the fan-out is a dict from
+   * copies invalidated to writes. */
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    dumpMatrix( os, prefix, suffix, "CoherenceTransferMatrix", m_transfers );
+    dumpMatrix( os, prefix, suffix, "CoherenceInvalidationMatrix", m_invalidations );
+    os << prefix << "'InvalidationFanOut': {";
+    bool first = true;
+    for ( unsigned k = 0; k < m_cores; k++ ) {
+      if ( 0 == m_fanOut[k] ) continue;
+      os << ( first ? "" : ", " ) << k << ": " << m_fanOut[k];
+      first = false;
+    }
+    os << "}" << suffix;
+    if ( m_rounds > 0 ) m_roundHistogram.dump( os, prefix, suffix );
+  }
+};
+
+#endif /* COHERENCETRAFFIC_HPP_ */
@@ -0,0 +1,93 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMITMODEL_HPP_
+#define COMMITMODEL_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ * Cost of committing store buffers at the end of a quantum round. Each core
+ * writes back its own dirty lines in parallel with the others, but all of
+ * them share the bandwidth into the next level. A commit either stalls the
+ * round that produced it or, with overlap, runs during the next round and
+ * stalls only for the part that round doesn't cover.
+ */
+class CommitModel {
+public:
+  /** fixed cycles per commit, e.g. for arbitration */
+  uint64_t m_latency;
+  /** cycles for one core to write back one dirty line */
+  uint64_t m_lineCycles;
+  /** dirty lines per cycle the shared level can accept from all cores together */
+  uint64_t m_bandwidth;
+  /** Overlap each commit with the next round's execution */
+  bool m_overlap;
+
+private:
+  /** cycles of the last commit that have yet to be overlapped with execution */
+  uint64_t m_pending;
+
+public:
+  CommitModel() : m_latency( 0 ), m_lineCycles( 1 ), m_bandwidth( 1 ), m_overlap( false ), m_pending( 0 ) {}
+
+  /** Cycles to commit the given number of dirty lines from each core. */
+  uint64_t cycles( const vector<uint64_t>& linesPerCore ) const {
+    uint64_t most = 0, total = 0;
+    for ( unsigned i = 0; i < linesPerCore.size(); i++ ) {
+      most = max( most, linesPerCore[i] );
+      total += linesPerCore[i];
+    }
+    if ( 0 == total ) return 0;
+    return m_latency + max( most * m_lineCycles, (total + m_bandwidth - 1) / m_bandwidth );
+  }
+
+  /** A round that ran for roundRuntime cycles ended with a commit taking the
+   * given cycles. @return the commit cycles exposed in this round: whatever
+   * of the previous commit the round didn't cover, plus this commit unless
+   * it overlaps with the next round */
+  uint64_t roundFinished( uint64_t roundRuntime, uint64_t commit ) {
+    uint64_t exposed = m_pending > roundRuntime ? m_pending - roundRuntime : 0;
+    if ( m_overlap ) {
+      m_pending = commit;
+    } else {
+      m_pending = 0;
+      exposed += commit;
+    }
+    return exposed;
+  }
+
+  /** The simulation is over, so nothing can overlap the last commit.
+   * @return its exposed cycles */
+  uint64_t drain() {
+    const uint64_t exposed = m_pending;
+    m_pending = 0;
+    return exposed;
+  }
+
+};
+
+#endif /* COMMITMODEL_HPP_ */
@@ -0,0 +1,156 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Open-addressing hash map from 64-bit keys (sync object or line addresses)
+ * to small values, for bookkeeping that is touched on every sync event or
+ * memory access. Entries live
+ * in one flat array and are found by linear probing, so a lookup is usually a
+ * single cache miss and inserts don't allocate. There is no erase; instead
+ * clear() is O(1): every slot is stamped with the generation that filled it,
+ * and slots from older generations count as empty.
+ */
+
+#ifndef FLATHASHMAP_HPP_
+#define FLATHASHMAP_HPP_
+
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+
+using namespace std;
+
+template<class Value>
+class FlatHashMap {
+private:
+  struct Slot {
+    uint64_t key;
+    /** the slot is in use iff this is the map's current generation */
+    uint32_t generation;
+    Value value;
+    Slot() : key( 0 ), generation( 0 ), value() {}
+  };
+
+  vector<Slot> m_slots;
+  unsigned m_bits;
+  uint64_t m_size;
+  /** starts at 1, so that fresh slots are empty */
+  uint32_t m_generation;
+
+  /** Fibonacci hashing: sync objects are aligned addresses, so use the high bits of the product */
+  unsigned home( uint64_t key ) const {
+    return unsigned( (key * 0x9E3779B97F4A7C15ULL) >> (64 - m_bits) );
+  }
+
+  bool live( const Slot& s ) const {
+    return s.generation == m_generation;
+  }
+
+  /** Index of the slot holding key, or of the empty slot where it belongs */
+  unsigned probe( uint64_t key ) const {
+    const unsigned mask = m_slots.size() - 1;
+    for ( unsigned i = home( key ); ; i = (i + 1) & mask ) {
+      const Slot& s = m_slots[i];
+      if ( !live(s) || s.key == key ) return i;
+    }
+  }
+
+  void grow() {
+    vector<Slot> old;
+    old.swap( m_slots );
+    m_bits++;
+    m_slots.resize( 1U << m_bits );
+    const uint32_t oldGeneration = m_generation;
+    m_generation = 1;
+    for ( unsigned i = 0; i < old.size(); i++ ) {
+      if ( old[i].generation != oldGeneration ) continue;
+      Slot& s = m_slots[probe( old[i].key )];
+      s = old[i];
+      s.generation = m_generation;
+    }
+  }
+
+public:
+  static const unsigned INITIAL_BITS = 6;
+
+  FlatHashMap() : m_bits( INITIAL_BITS ), m_size( 0 ), m_generation( 1 ) {
+    m_slots.resize( 1U << m_bits );
+  }
+
+  uint64_t size() const {
+    return m_size;
+  }
+
+  bool empty() const {
+    return 0 == m_size;
+  }
+
+  /** @return the value for key, or NULL if there is none */
+  Value* find( uint64_t key ) {
+    Slot& s = m_slots[probe( key )];
+    return live(s) ? &s.value : NULL;
+  }
+
+  const Value* find( uint64_t key ) const {
+    const Slot& s = m_slots[probe( key )];
+    return live(s) ? &s.value : NULL;
+  }
+
+  /** @return the value for key, inserting a default-constructed one if needed.
+   * References are invalidated by later inserts. */
+  Value& operator[]( uint64_t key ) {
+    bool ignore;
+    return findOrInsert( key, ignore );
+  }
+
+  /** Like operator[], but also says whether key was inserted. Saves the
+   * find-then-insert double lookup. */
+  Value& findOrInsert( uint64_t key, bool& inserted ) {
+    // keep the load factor at most 1/2 so probe sequences stay short
+    if ( 2 * (m_size + 1) > m_slots.size() ) grow();
+    Slot& s = m_slots[probe( key )];
+    inserted = !live(s);
+    if ( inserted ) {
+      s.key = key;
+      s.generation = m_generation;
+      s.value = Value();
+      m_size++;
+    }
+    return s.value;
+  }
+
+  /** Forget every entry, in O(1) time (amortized). */
+  void clear() {
+    m_size = 0;
+    m_generation++;
+    if ( 0 == m_generation ) {
+      // wrapped around: old stamps could look current again
+      for ( unsigned i = 0; i < m_slots.size(); i++ ) {
+        m_slots[i].generation = 0;
+      }
+      m_generation = 1;
+    }
+  }
+
+};
+
+#endif /* FLATHASHMAP_HPP_ */
@@ -0,0 +1,361 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Vector-clock happens-before tracking, FastTrack style (Flanagan & Freund,
+ * PLDI 2009). A thread's clock is its own component plus an immutable, shared,
+ * sparse vector of what it knows about every other thread. Releasing a sync
+ * object just shares that vector (O(1)); acquiring is O(1) when the acquirer
+ * already knows about the release, and only otherwise merges the sparse
+ * vectors. Memory locations keep FastTrack's last-write epoch and last-read
+ * epoch (or a read vector once reads are concurrent) to find data races.
+ */
+
+#ifndef HAPPENSBEFORE_HPP_
+#define HAPPENSBEFORE_HPP_
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdint.h>
+#include <assert.h>
+#include <ostream>
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+#include "FlatHashMap.hpp"
+
+using namespace std;
+
+/** (tid, clock) pairs sorted by tid; absent threads have clock 0 */
+typedef vector< pair<unsigned,uint64_t> > SparseClock;
+typedef boost::shared_ptr<const SparseClock> SharedClock;
+
+/** Clock of tid in c */
+static inline uint64_t clockIn( const SparseClock* c, unsigned tid ) {
+  if ( NULL == c ) return 0;
+  SparseClock::const_iterator it = lower_bound( c->begin(), c->end(), make_pair( tid, uint64_t(0) ) );
+  return ( c->end() != it && it->first == tid ) ? it->second : 0;
+}
+
+/** Pointwise max of a and b, leaving out skip. */
+static inline SparseClock* joinClocks( const SparseClock* a, const SparseClock* b, unsigned skip ) {
+  static const SparseClock EMPTY;
+  if ( NULL == a ) a = &EMPTY;
+  if ( NULL == b ) b = &EMPTY;
+  SparseClock* j = new SparseClock();
+  j->reserve( a->size() + b->size() );
+  SparseClock::const_iterator i = a->begin(), k = b->begin();
+  while ( i != a->end() || k != b->end() ) {
+    pair<unsigned,uint64_t> next;
+    if ( k == b->end() || (i != a->end() && i->first < k->first) ) {
+      next = *i++;
+    } else if ( i == a->end() || k->first < i->first ) {
+      next = *k++;
+    } else {
+      next = make_pair( i->first, max( i->second, k->second ) );
+      i++; k++;
+    }
+    if ( next.first != skip ) j->push_back( next );
+  }
+  return j;
+}
+
+/** An epoch, c@t in FastTrack's notation */
+struct Epoch {
+  static const unsigned NONE = static_cast<unsigned>(-1);
+  unsigned tid;
+  uint64_t clock;
+  Epoch() : tid( NONE ), clock( 0 ) {}
+  Epoch( unsigned t, uint64_t c ) : tid( t ), clock( c ) {}
+  bool operator==( const Epoch& e ) const { return tid == e.tid && clock == e.clock; }
+};
+
+/** What a sync object's releases make known: the last releaser's epoch, plus
+ * everything it (or earlier, concurrent releasers) knew about other threads. */
+struct SyncClock {
+  Epoch last;
+  SharedClock others;
+  /** others holds releases that last's thread didn't know about */
+  bool joined;
+  SyncClock() : joined( false ) {}
+};
+
+class ThreadClock {
+public:
+  unsigned tid;
+  uint64_t own;
+  SharedClock others;
+
+  ThreadClock( unsigned t ) : tid( t ), own( 1 ) {}
+
+  uint64_t clockOf( unsigned u ) const {
+    return u == tid ? own : clockIn( others.get(), u );
+  }
+
+  /** Whether everything that happened before e is known to this thread */
+  bool knows( const Epoch& e ) const {
+    return Epoch::NONE == e.tid || e.clock <= clockOf( e.tid );
+  }
+
+  /** Whether every release of s is known to this thread */
+  bool knows( const SyncClock& s ) const {
+    if ( !knows( s.last ) ) return false;
+    if ( !s.joined || NULL == s.others.get() ) return true;
+    for ( unsigned i = 0; i < s.others->size(); i++ ) {
+      const pair<unsigned,uint64_t>& e = s.others->at( i );
+      if ( e.second > clockOf( e.first ) ) return false;
+    }
+    return true;
+  }
+};
+
+enum RaceKind { WRITE_WRITE_RACE = 1, READ_WRITE_RACE, WRITE_READ_RACE };
+
+struct Race {
+  uint64_t addr;
+  RaceKind kind;
+  /** the earlier access's thread, and the thread that found the race */
+  unsigned firstTid;
+  unsigned secondTid;
+};
+
+class HappensBefore {
+public:
+  /** races are tracked at this granularity (bytes) */
+  static const unsigned WORD_SIZE = 8;
+  /** only the first few distinct racy words are kept for the report */
+  static const unsigned MAX_REPORTED_RACES = 100;
+
+  /** acquires that learned nothing new, and so cost O(1) */
+  uint64_t m_fastAcquires;
+  /** acquires and releases that had to merge sparse vectors */
+  uint64_t m_slowJoins;
+  uint64_t m_races;
+  /** distinct words with at least one race */
+  uint64_t m_racyWords;
+  vector<Race> m_reported;
+
+private:
+  struct Shadow {
+    Epoch write;
+    Epoch read;
+    /** non-NULL once reads are concurrent: every reader's last read clock */
+    SparseClock* readers;
+    /** already reported */
+    bool racy;
+    Shadow() : readers( NULL ), racy( false ) {}
+  };
+
+  vector<ThreadClock*> m_threads;
+  FlatHashMap<SyncClock> m_syncClocks;
+  /** each thread's own clock when the current quantum round started */
+  vector<uint64_t> m_roundStart;
+  map<uint64_t, Shadow> m_shadow;
+  /** heap blocks, start address -> size, so frees know which words to forget.
+   * FlatHashMap can't erase, so a freed block's size is set to 0. */
+  FlatHashMap<uint64_t> m_allocationSizes;
+
+  void race( uint64_t word, Shadow& s, RaceKind kind, unsigned first, unsigned second ) {
+    m_races++;
+    if ( s.racy ) return;
+    s.racy = true;
+    m_racyWords++;
+    if ( m_reported.size() < MAX_REPORTED_RACES ) {
+      Race r = { word, kind, first, second };
+      m_reported.push_back( r );
+    }
+  }
+
+  /** Whether c has anything in the current round that t doesn't know about */
+  bool newInCurrentRound( const ThreadClock& t, const Epoch& e ) const {
+    return e.tid != t.tid && e.clock > t.clockOf( e.tid ) && e.clock >= roundStartOf( e.tid );
+  }
+
+  uint64_t roundStartOf( unsigned tid ) const {
+    return tid < m_roundStart.size() ? m_roundStart[tid] : 0;
+  }
+
+public:
+
+  HappensBefore() : m_fastAcquires( 0 ), m_slowJoins( 0 ), m_races( 0 ), m_racyWords( 0 ) {}
+
+  ~HappensBefore() {
+    for ( unsigned i = 0; i < m_threads.size(); i++ ) {
+      delete m_threads[i];
+    }
+    map<uint64_t, Shadow>::iterator it = m_shadow.begin();
+    for ( ; it != m_shadow.end(); it++ ) {
+      delete it->second.readers;
+    }
+  }
+
+  ThreadClock& thread( unsigned tid ) {
+    if ( tid >= m_threads.size() ) {
+      m_threads.resize( tid + 1, NULL );
+    }
+    if ( NULL == m_threads[tid] ) {
+      m_threads[tid] = new ThreadClock( tid );
+    }
+    return *m_threads[tid];
+  }
+
+  /** tid releases syncObject: later acquires of it happen after everything tid has done. */
+  void release( unsigned tid, uint64_t syncObject ) {
+    ThreadClock& t = thread( tid );
+    SyncClock& s = m_syncClocks[syncObject];
+    if ( t.knows( s ) ) {
+      // the common case, e.g. a lock: this release subsumes earlier ones
+      s.others = t.others;
+      s.joined = false;
+    } else {
+      // concurrent releases, e.g. of a semaphore or barrier: keep both
+      m_slowJoins++;
+      // the previous releaser's epoch becomes an ordinary entry
+      SparseClock last( 1, make_pair( s.last.tid, s.last.clock ) );
+      SparseClock* prev = joinClocks( s.others.get(), &last, tid );
+      s.others = SharedClock( joinClocks( prev, t.others.get(), tid ) );
+      delete prev;
+      s.joined = true;
+    }
+    s.last = Epoch( tid, t.own );
+    t.own++;
+  }
+
+  /** tid acquires syncObject: it now happens after every release of it.
+   * @return whether this makes tid depend on something from another thread
+   * in the current quantum round that it didn't already depend on */
+  bool acquire( unsigned tid, uint64_t syncObject ) {
+    ThreadClock& t = thread( tid );
+    const SyncClock* found = m_syncClocks.find( syncObject );
+    if ( NULL == found ) {
+      return false;
+    }
+    const SyncClock& s = *found;
+    if ( t.knows( s ) ) {
+      m_fastAcquires++;
+      return false;
+    }
+
+    m_slowJoins++;
+    bool uncommitted = newInCurrentRound( t, s.last );
+    if ( NULL != s.others.get() ) {
+      for ( unsigned i = 0; i < s.others->size() && !uncommitted; i++ ) {
+        const pair<unsigned,uint64_t>& e = s.others->at( i );
+        uncommitted = newInCurrentRound( t, Epoch(e.first, e.second) );
+      }
+    }
+    SparseClock last( 1, make_pair( s.last.tid, s.last.clock ) );
+    SparseClock* merged = joinClocks( t.others.get(), &last, tid );
+    SparseClock* all = joinClocks( merged, s.others.get(), tid );
+    delete merged;
+    t.others = SharedClock( all );
+    return uncommitted;
+  }
+
+  /** Check a memory access for races with FastTrack's rules. */
+  void access( unsigned tid, uint64_t addr, unsigned size, bool write ) {
+    ThreadClock& t = thread( tid );
+    const Epoch now( tid, t.own );
+    const uint64_t last = ( addr + max( size, 1U ) - 1 ) & ~uint64_t(WORD_SIZE - 1);
+    for ( uint64_t word = addr & ~uint64_t(WORD_SIZE - 1); word <= last; word += WORD_SIZE ) {
+      Shadow& s = m_shadow[word];
+      if ( write ) {
+        if ( s.write == now ) continue;
+        if ( !t.knows( s.write ) ) race( word, s, WRITE_WRITE_RACE, s.write.tid, tid );
+        if ( NULL == s.readers ) {
+          if ( s.read.tid != tid && !t.knows( s.read ) ) race( word, s, READ_WRITE_RACE, s.read.tid, tid );
+        } else {
+          for ( unsigned i = 0; i < s.readers->size(); i++ ) {
+            const pair<unsigned,uint64_t>& r = s.readers->at( i );
+            if ( r.first != tid && r.second > t.clockOf( r.first ) ) {
+              race( word, s, READ_WRITE_RACE, r.first, tid );
+            }
+          }
+          delete s.readers;
+          s.readers = NULL;
+          s.read = Epoch();
+        }
+        s.write = now;
+      } else {
+        if ( s.read == now ) continue;
+        if ( !t.knows( s.write ) ) race( word, s, WRITE_READ_RACE, s.write.tid, tid );
+        if ( NULL != s.readers ) {
+          SparseClock mine( 1, make_pair( tid, now.clock ) );
+          SparseClock* j = joinClocks( s.readers, &mine, Epoch::NONE );
+          delete s.readers;
+          s.readers = j;
+        } else if ( s.read.tid == tid || t.knows( s.read ) ) {
+          s.read = now; // still exclusive
+        } else {
+          // concurrent readers: switch to a read vector
+          SparseClock prev( 1, make_pair( s.read.tid, s.read.clock ) );
+          SparseClock mine( 1, make_pair( tid, now.clock ) );
+          s.readers = joinClocks( &prev, &mine, Epoch::NONE );
+        }
+      }
+    }
+  }
+
+  void allocated( uint64_t addr, uint64_t size ) {
+    m_allocationSizes[addr] = size;
+  }
+
+  /** Forget the history of a freed block's words, so that a later allocation
+   * reusing them doesn't race with accesses to the old block. */
+  void freed( uint64_t addr ) {
+    uint64_t* size = m_allocationSizes.find( addr );
+    if ( NULL == size || 0 == *size ) return;
+    const uint64_t first = addr & ~uint64_t(WORD_SIZE - 1);
+    const uint64_t end = addr + *size;
+    *size = 0;
+    map<uint64_t, Shadow>::iterator it = m_shadow.lower_bound( first );
+    while ( it != m_shadow.end() && it->first < end ) {
+      delete it->second.readers;
+      m_shadow.erase( it++ );
+    }
+  }
+
+  /** Remember where each thread's clock stood at the start of the new round. */
+  void quantumRoundFinished() {
+    m_roundStart.resize( m_threads.size(), 0 );
+    for ( unsigned i = 0; i < m_threads.size(); i++ ) {
+      if ( m_threads[i] ) m_roundStart[i] = m_threads[i]->own;
+    }
+  }
+
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    os << prefix << "'HBFastAcquires': " << m_fastAcquires << suffix;
+    os << prefix << "'HBSlowJoins': " << m_slowJoins << suffix;
+    os << prefix << "'DataRaces': " << m_races << suffix;
+    os << prefix << "'RacyWords': " << m_racyWords << suffix;
+    static const char* KINDS[] = { "", "write-write", "read-write", "write-read" };
+    for ( unsigned i = 0; i < m_reported.size(); i++ ) {
+      const Race& r = m_reported[i];
+      os << prefix << "'raceAddress': " << r.addr << ", 'raceKind': '" << KINDS[r.kind]
+         << "', 'firstTid': " << r.firstTid << ", 'secondTid': " << r.secondTid << suffix;
+    }
+  }
+
+};
+
+#endif /* HAPPENSBEFORE_HPP_ */
@@ -172,8 +172,17 @@ protected:
     return (address >> m_blockOffsetBits) & m_indexMask;
   }
 
+  /** Lines are tagged with their whole block number rather than just the bits
+   * above the index. All levels share a block size, so a line keeps a valid tag
+   * as it moves between levels with different numbers of sets, and its
+   * address can be recovered when it is evicted. */
   uint64_t tag(uint64_t address) const {
-    return address >> (m_blockOffsetBits + m_indexBits);
+    return address >> m_blockOffsetBits;
+  }
+
+  /** Address of the first byte of the given line */
+  uint64_t blockAddressOf(const Line* line) const {
+    return line->tag() << m_blockOffsetBits;
   }
 
   /** Put the incoming line into this cache.
@@ -195,8 +204,7 @@ protected:
     set.push_front( incoming );
 
     if ( m_nextCache ) {
-      uint64_t lruBlockAddress = (toEvict->tag() << m_indexBits) + index(blockAddress);
-      m_nextCache->evictedFromLowerCache( toEvict, lruBlockAddress );
+      m_nextCache->evictedFromLowerCache( toEvict, blockAddressOf(toEvict) );
     } else {
       delete toEvict;
     }
@@ -277,8 +285,7 @@ protected:
     set.push_front( l1Line );
 
     if ( m_nextCache ) {
-      uint64_t blockAddress = (toEvict->tag() << m_indexBits) + index(address);
-      m_nextCache->evictedFromLowerCache( toEvict, blockAddress );
+      m_nextCache->evictedFromLowerCache( toEvict, blockAddressOf(toEvict) );
     } else {
       delete toEvict;
     }
@@ -378,6 +385,16 @@ public:
 
   } // end search()
 
+  /** Like search(), but only looks in this cache, not the ones above it.
+   * @return the valid line containing address, or NULL */
+  Line* lineFor(const uint64_t address) const {
+    const list<Line*>& set = m_sets.at( index(address) );
+    for ( const_line_iter_t it = set.begin(); it != set.end(); it++ ) {
+      if ( (*it)->valid() && (*it)->tag() == tag(address) ) return *it;
+    }
+    return NULL;
+  }
+
   /** Calls the given function once on each line in this cache. Lines
    * are traversed in no particular order. */
   void visitAllLines(void (*fun)(Line*)) {
@@ -388,6 +405,16 @@ public:
     }
   }
 
+  /** Like visitAllLines(), but with a function object that can carry state. */
+  template<class Visitor>
+  void visitAllLines(Visitor& visitor) {
+    for ( set_iter_t s = m_sets.begin(); s != m_sets.end(); s++ ) {
+      for ( line_iter_t l = s->begin(); l != s->end(); l++ ) {
+        visitor( *l );
+      }
+    }
+  }
+
 
 };
 
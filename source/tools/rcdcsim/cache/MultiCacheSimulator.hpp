@@ -24,6 +24,19 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 #define _MULTICACHESIM_H_
 
 #include "SMPCache.hpp"
+#include "ThreadScheduler.hpp"
+#include "ShardedCaches.hpp"
+#include "AdaptiveQuantum.hpp"
+#include "CommitModel.hpp"
+#include "Histogram.hpp"
+#include "OwnershipTable.hpp"
+#include "BlockCostPredictor.hpp"
+#include "HappensBefore.hpp"
+#include "FlatHashMap.hpp"
+#include "StackDistance.hpp"
+#include "PCProfile.hpp"
+#include "AllocationMap.hpp"
+#include "SelfProfile.hpp"
 
 #include "cachesim.hpp"
 
@@ -40,8 +53,24 @@ public:
 
   bool m_simulateTSO;
   bool m_simulateHB;
+  /** DMP-O: quanta run in parallel until they communicate, then finish serially */
+  bool m_simulateDMPO;
+  /** Kendo: no quanta, but lock acquires wait for their turn in logical time */
+  bool m_simulateKendo;
+  /** how much work ends a quantum: insns, or predicted cycles with the block
+   * cost predictor (see CoreState::work) */
   unsigned m_quantumSize;
   bool m_smartQuantumBuilding;
+  /** Charge each round for writing back its dirty lines. Otherwise commit is free. */
+  bool m_modelCommit;
+  /** how long commits take, with m_modelCommit */
+  CommitModel m_commit;
+
+  /** decides which core each thread runs on */
+  ThreadScheduler m_scheduler;
+
+  bool m_useTLBs;
+  HugePagePolicy m_hugePages;
 
   
   int core_id;		//**********************************************Mandy: for security check
@@ -51,21 +80,130 @@ private:
 
   HierarchicalCache<Line>* m_l3cache;
 
-  /** HACK: so that we know how many cores to wait for at a quantum boundary */
   unsigned m_liveThreads;
-  vector<uint64_t> m_insnCounts;
-  vector<uint64_t> m_workCounts;
-  vector<bool> m_blocked;
-  vector<bool> m_stalledAtQuantumBoundary;
-  vector<bool> m_waitingForCausality;
+
+  /** Per-core state for the current quantum round. Everything the per-event
+   * paths touch for a core lives together, one struct per core. */
+  struct CoreState {
+    uint64_t insns;
+    /** measured against m_quantumSize: insns (plus deterministic memory cycles
+     * with smart quantum building), or predicted cycles with m_blockCosts */
+    uint64_t work;
+    /** cycles spent switching between threads */
+    uint64_t contextSwitchCycles;
+    /** deterministic estimate of memory cycles */
+    uint64_t detMemoryCycles;
+    /** cycles spent waiting for its turn to acquire a lock (Kendo) */
+    uint64_t syncWaitCycles;
+    /** runtime when the quantum left parallel mode (DMP-O) */
+    uint64_t parallelRuntime;
+    /** no threads assigned to this core can run */
+    bool blocked;
+    bool stalledAtQuantumBoundary;
+    bool waitingForCausality;
+    /** the rest of the quantum runs in serial mode (DMP-O) */
+    bool serialMode;
+    /** whether this core is in m_activeCores */
+    bool active;
+
+    CoreState() : insns( 0 ), work( 0 ), contextSwitchCycles( 0 ), detMemoryCycles( 0 ),
+                  syncWaitCycles( 0 ), parallelRuntime( 0 ),
+                  // no threads have been scheduled yet, so every core starts out idle
+                  blocked( true ), stalledAtQuantumBoundary( false ), waitingForCausality( false ),
+                  serialMode( false ), active( false ) {}
+
+    bool progressing() const {
+      return !( stalledAtQuantumBoundary || blocked || waitingForCausality );
+    }
+  };
+  vector<CoreState> m_cores;
+  /** cores that have done anything this round; the rest have nothing to account for */
+  vector<unsigned> m_activeCores;
+  /** cores that are stalled, blocked or waiting for causality */
+  unsigned m_numNonProgressingCores;
+
+  /** Lets the scheduler see which cores are stalled at the quantum boundary */
+  struct StalledCores {
+    const vector<CoreState>& cores;
+    StalledCores( const vector<CoreState>& c ) : cores( c ) {}
+    bool operator[]( unsigned i ) const {
+      return cores[i].stalledAtQuantumBoundary;
+    }
+  };
+
+  OwnershipTable m_ownership;
+
+  /** The basic block each core is running, for training the block cost predictor */
+  struct OpenBlock {
+    bool open;
+    unsigned tid;
+    uint64_t bbAddr;
+    uint64_t insns;
+    uint64_t predictedCycles;
+    /** deterministic memory cycles from earlier quantum rounds; the predictor is trained on these */
+    uint64_t detMemoryCycles;
+    /** the core's detMemoryCycles when the block (or this round) started */
+    uint64_t detStart;
+    /** measured memory cycles from earlier quantum rounds, only for reporting prediction error */
+    uint64_t memoryCycles;
+    /** the core's timeInMemoryHierarchy when the block (or this round) started */
+    uint64_t start;
+    OpenBlock() : open( false ), tid( 0 ), bbAddr( 0 ), insns( 0 ), predictedCycles( 0 ),
+                  detMemoryCycles( 0 ), detStart( 0 ), memoryCycles( 0 ), start( 0 ) {}
+  };
+  vector<OpenBlock> m_openBlocks;
+  /** when non-NULL, quantum work is measured in predicted cycles instead of insns */
+  BlockCostPredictor* m_blockCosts;
   /** used for computing average insns per quantum */
   uint64_t m_sumOfInsnsPerQuantum;
   /** used for computing average quantum latency (in cycles) */
   uint64_t m_sumOfCyclesPerQuantum;
   bool commitThisRound;
 
-  /** Tells the quantum round in which a sync source event occurred */
-  map<uint64_t,uint64_t> m_roundOfSyncSource;
+  /** caches whose store buffers need to be cleared at the end of this round */
+  vector<cache_t*> m_storeBuffersToClear;
+
+  /** when non-NULL, data and instruction accesses are simulated by these
+   * per-set-range workers instead of by m_allCaches (nondet only) */
+  ShardedCaches<Line>* m_shards;
+
+  /** dirty lines committed by each of m_storeBuffersToClear this round */
+  vector<uint64_t> m_committedLines;
+  /** with m_allocations, the tags of those lines */
+  vector< vector<uint64_t> > m_committedTags;
+  Histogram m_commitCyclesHistogram;
+  Histogram m_dirtyLinesHistogram;
+
+  /** when non-NULL, resizes m_quantumSize after every round */
+  AdaptiveQuantum* m_adaptiveQuantum;
+  /** values of the boundary counters at the start of this round */
+  uint64_t m_roundStartInsnBoundaries;
+  uint64_t m_roundStartSyncBoundaries;
+  uint64_t m_roundStartOverflows;
+
+  /** 2MB-backed regions, from start address to end address (exclusive). Only
+   * used with HUGE_PAGES_LARGE_ALLOCS. */
+  map<uint64_t,uint64_t> m_hugeRegions;
+
+  /** Sync objects that have had a source event in the current quantum round;
+   * cleared at the end of every round */
+  FlatHashMap<bool> m_releasedThisRound;
+  /** when non-NULL, vector clocks for every thread and sync object */
+  HappensBefore* m_hb;
+  /** Det-HB stalls a sink only if it newly depends on something from this round */
+  bool m_preciseHBStalls;
+  /** check every access for data races */
+  bool m_raceReport;
+  /** when non-NULL, stack distances of every access */
+  MissRatioCurves* m_mrc;
+  /** when non-NULL, classifies coherence misses as true or false sharing */
+  SharingTracker* m_sharing;
+  /** when non-NULL, misses and coherence events of each instruction */
+  PCProfile* m_pcProfile;
+  /** when non-NULL, misses, coherence events and dirty lines of each allocation site */
+  AllocationMap* m_allocations;
+  /** when non-NULL, core-to-core transfers and invalidations */
+  CoherenceTraffic* m_coherence;
   Counter Runtime;
   Counter TotalQuantumImbalance;
   Counter QuantumRounds;
@@ -76,6 +214,17 @@ private:
   Counter SyncInducedRoundBoundaries;
   Counter StoreBufferOverflows;
   Counter InsnCountInducedRoundBoundaries;
+  Counter CommitCycles;
+  Counter ExposedCommitCycles;
+  Counter DirtyLinesCommitted;
+  Counter CommunicatingAccesses;
+  Counter SerialModeQuanta;
+  Counter SerialCycles;
+  Counter LockTurnWaits;
+  Counter LockTurnWaitCycles;
+  Counter PredictedBlockCycles;
+  Counter ActualBlockCycles;
+  Counter BlockCyclePredictionAbsError;
 
 public:
   MultiCacheSimulator( int numCaches, CacheConfiguration<Line> l1config,
@@ -84,16 +233,39 @@ public:
                          NUM_CORES( numCaches ),
                          m_simulateTSO( false ),
                          m_simulateHB( false ),
+                         m_simulateDMPO( false ),
+                         m_simulateKendo( false ),
 			 //core_id(0),		//**********************************************Mandy: for security check
                          m_quantumSize( 0 ),
                          m_smartQuantumBuilding( false ),
+                         m_modelCommit( false ),
+                         m_scheduler( numCaches ),
+                         m_useTLBs( false ),
+                         m_hugePages( HUGE_PAGES_NONE ),
 
                          LINE_SIZE(l1config.blockSize),
+                         m_liveThreads( 0 ),
+                         m_blockCosts( NULL ),
                          m_sumOfInsnsPerQuantum( 0 ),
                          m_sumOfCyclesPerQuantum( 0 ),
                          commitThisRound( false ),
-
-#define COUNTER(name) name( Counter(0,#name) )
+                         m_shards( NULL ),
+                         m_commitCyclesHistogram( "CommitCyclesHistogram" ),
+                         m_dirtyLinesHistogram( "CommittedDirtyLinesHistogram" ),
+                         m_adaptiveQuantum( NULL ),
+                         m_roundStartInsnBoundaries( 0 ),
+                         m_roundStartSyncBoundaries( 0 ),
+                         m_roundStartOverflows( 0 ),
+                         m_hb( NULL ),
+                         m_preciseHBStalls( false ),
+                         m_raceReport( false ),
+                         m_mrc( NULL ),
+                         m_sharing( NULL ),
+                         m_pcProfile( NULL ),
+                         m_allocations( NULL ),
+                         m_coherence( NULL ),
+
+#define COUNTER(name) name( Counter(0,#name,true) )
                          COUNTER(Runtime),
                          COUNTER(TotalQuantumImbalance),
                          COUNTER(QuantumRounds),
@@ -103,15 +275,25 @@ public:
                          COUNTER(AverageCyclesPerQuantum),
                          COUNTER(SyncInducedRoundBoundaries),
                          COUNTER(StoreBufferOverflows),
-                         COUNTER(InsnCountInducedRoundBoundaries)
+                         COUNTER(InsnCountInducedRoundBoundaries),
+                         COUNTER(CommitCycles),
+                         COUNTER(ExposedCommitCycles),
+                         COUNTER(DirtyLinesCommitted),
+                         COUNTER(CommunicatingAccesses),
+                         COUNTER(SerialModeQuanta),
+                         COUNTER(SerialCycles),
+                         COUNTER(LockTurnWaits),
+                         COUNTER(LockTurnWaitCycles),
+                         COUNTER(PredictedBlockCycles),
+                         COUNTER(ActualBlockCycles),
+                         COUNTER(BlockCyclePredictionAbsError)
 #undef COUNTER
   {
 
-    m_insnCounts.assign( NUM_CORES, 0 );
-    m_workCounts.assign( NUM_CORES, 0 );
-    m_blocked.assign( NUM_CORES, false );
-    m_stalledAtQuantumBoundary.assign( NUM_CORES, false );
-    m_waitingForCausality.assign( NUM_CORES, false );
+    m_cores.resize( NUM_CORES );
+    m_numNonProgressingCores = NUM_CORES;
+    m_activeCores.reserve( NUM_CORES );
+    m_openBlocks.resize( NUM_CORES );
 
     l3config.callbacks = this;
 
@@ -133,6 +315,15 @@ public:
       delete ( *cacheIter );
     }
 
+    delete m_shards;
+    delete m_adaptiveQuantum;
+    delete m_blockCosts;
+    delete m_hb;
+    delete m_mrc;
+    delete m_sharing;
+    delete m_pcProfile;
+    delete m_allocations;
+    delete m_coherence;
     delete m_l3cache;
   }
 
@@ -143,8 +334,18 @@ public:
 
   /** map from thread id to cpu */
   unsigned cpuOfTid( unsigned tid ) {
-    // NB: we have a very simple mapping of threads onto caches
-    return tid % m_allCaches.size();
+    return m_scheduler.coreOf( tid );
+  }
+
+  /** Try to give tid a core to run on, switching out the core's current thread
+   * if the scheduling policy allows it. Returns false if tid's events must wait. */
+  bool tryDispatch( unsigned tid ) {
+    uint64_t switchCost = 0;
+    if ( !m_scheduler.tryDispatch( tid, StalledCores(m_cores), switchCost ) ) {
+      return false;
+    }
+    activeCore( cpuOfTid(tid) ).contextSwitchCycles += switchCost;
+    return true;
   }
 
   cache_t *getCache( unsigned tid ) {
@@ -154,11 +355,16 @@ public:
   }
 
   void dumpStats( ostream & os, const string & prefix, const string & suffix ) {
+    if ( m_shards ) m_shards->collect( m_allCaches );
     cache_iter_t cacheIter = m_allCaches.begin();
     for ( ; cacheIter != m_allCaches.end(); cacheIter++ ) {
       ( *cacheIter )->finalizeCounters();
     }
     finishQuantumRound();
+    // nothing left to overlap the last commit with
+    const uint64_t lastCommit = m_commit.drain();
+    Runtime.add( lastCommit );
+    ExposedCommitCycles.add( lastCommit );
 
     if ( TotalQuanta.get() != 0 ) {
       AverageInsnsPerQuantum.set( m_sumOfInsnsPerQuantum / TotalQuanta.get() );
@@ -167,29 +373,108 @@ public:
 
     // the Counter class keeps track of all its instances, so we only need to dump once
     Counter::dumpCounters( os, prefix, suffix );
+    m_scheduler.dumpStats( os, prefix, suffix );
+    if ( m_adaptiveQuantum ) m_adaptiveQuantum->dumpStats( os, prefix, suffix );
+    if ( m_hb ) m_hb->dumpStats( os, prefix, suffix );
+    if ( m_mrc ) m_mrc->dumpStats( os, prefix, suffix );
+    if ( m_sharing ) m_sharing->dumpStats( os, prefix, suffix );
+    if ( m_pcProfile ) m_pcProfile->dumpStats( os, prefix, suffix );
+    if ( m_allocations ) m_allocations->dumpStats( os, prefix, suffix );
+    if ( m_coherence ) m_coherence->dumpStats( os, prefix, suffix );
+    if ( m_modelCommit ) {
+      m_commitCyclesHistogram.dump( os, prefix, suffix );
+      m_dirtyLinesHistogram.dump( os, prefix, suffix );
+    }
   }
 
+  /** @param pc the instruction making the access, if known */
   void cacheRead( const int tid, const Addr_t addr, const unsigned size,
-                  bool doStoreBufferAccess = true ) {
-    cacheAccess( tid, false, addr, size, doStoreBufferAccess );
+                  bool doStoreBufferAccess = true, uint64_t pc = 0 ) {
+    cacheAccess( tid, false, addr, size, doStoreBufferAccess, pc );
+  }
+
+  void cacheWrite( int tid, Addr_t addr, unsigned size, bool doStoreBufferAccess = true,
+                   uint64_t pc = 0 ) {
+    cacheAccess( tid, true, addr, size, doStoreBufferAccess, pc );
+  }
+
+  /** Whether the given address is backed by a 2MB page. */
+  bool isHugePage( const Addr_t addr ) const {
+    switch ( m_hugePages ) {
+    case HUGE_PAGES_NONE:
+      return false;
+    case HUGE_PAGES_ALL:
+      return true;
+    case HUGE_PAGES_LARGE_ALLOCS: {
+      map<uint64_t,uint64_t>::const_iterator it = m_hugeRegions.upper_bound( addr );
+      if ( it == m_hugeRegions.begin() ) return false;
+      it--;
+      return addr < it->second;
+    }
+    default:
+      assert(false);
+      return false;
+    }
+  }
+
+  /** @param site the call site of the allocation, or 0 if unknown */
+  void memoryAllocated( const Addr_t addr, const uint64_t size, const uint64_t site ) {
+    if ( m_allocations ) m_allocations->allocated( addr, size, site );
+    if ( m_raceReport ) m_hb->allocated( addr, size );
+    if ( HUGE_PAGES_LARGE_ALLOCS != m_hugePages ) return;
+    const uint64_t HUGE_PAGE = 1ULL << DataTLB::HUGE_PAGE_BITS;
+    // only whole 2MB pages inside the allocation can be huge pages
+    uint64_t start = (addr + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+    uint64_t end = (addr + size) & ~(HUGE_PAGE - 1);
+    if ( start < end ) {
+      m_hugeRegions[start] = end;
+    }
   }
 
-  void cacheWrite( int tid, Addr_t addr, unsigned size, bool doStoreBufferAccess = true ) {
-    cacheAccess( tid, true, addr, size, doStoreBufferAccess );
+  void memoryFreed( const Addr_t addr ) {
+    if ( m_allocations ) m_allocations->freed( addr );
+    if ( m_raceReport ) m_hb->freed( addr );
+    if ( HUGE_PAGES_LARGE_ALLOCS != m_hugePages ) return;
+    const uint64_t HUGE_PAGE = 1ULL << DataTLB::HUGE_PAGE_BITS;
+    m_hugeRegions.erase( (addr + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1) );
   }
 
   void cacheAccess( const int tid, const bool write, const Addr_t addr,
-                    const unsigned size, bool doStoreBufferAccess ) {
+                    const unsigned size, bool doStoreBufferAccess, uint64_t pc ) {
+    PROFILE_SCOPE( PROF_CACHE_ACCESS );
     assert( !stalledAtQuantumBoundary(tid) );
     cache_t* c = getCache( tid );
+    activeCore( cpuOfTid(tid) );
+    if ( m_raceReport ) {
+      m_hb->access( tid, addr, size, write );
+    }
+    uint64_t misses = 0, remoteHits = 0, upgradeMisses = 0;
+    if ( m_pcProfile || m_allocations ) {
+      misses = c->numReadMisses.get() + c->numWriteMisses.get();
+      remoteHits = c->numReadRemoteHits.get() + c->numWriteRemoteHits.get();
+      upgradeMisses = c->numUpgradeMisses.get();
+    }
 
     for ( Addr_t a = addr, remainingSize = size; remainingSize > 0; ) {
       Addr_t data_bytesFromStartOfLine = a & ( LINE_SIZE - 1 );
       Addr_t data_maxSizeAccessWithinThisLine = LINE_SIZE - data_bytesFromStartOfLine;
 
+      if ( m_useTLBs ) {
+        c->translate( a, isHugePage( a ), LINE_SIZE );
+      }
+
+      if ( m_simulateDMPO && m_ownership.communicates( a & ~Addr_t(LINE_SIZE - 1), tid, write ) ) {
+        CommunicatingAccesses++;
+        enterSerialMode( cpuOfTid(tid) );
+      }
+
+      if ( m_mrc ) m_mrc->access( cpuOfTid(tid), a );
+
       // data access
       Addr_t accessSize = min( remainingSize, data_maxSizeAccessWithinThisLine );
-      if ( write ) {
+      if ( m_shards ) {
+        m_shards->access( cpuOfTid(tid), write, a, accessSize );
+      } else if ( write ) {
         c->write( DataAccess( WRITE_ACCESS, a, accessSize, LINE_SIZE ), doStoreBufferAccess );
       } else {
         c->read( DataAccess( READ_ACCESS, a, accessSize, LINE_SIZE ) );
@@ -199,18 +484,41 @@ public:
       remainingSize -= accessSize;
     }
 
+    if ( m_pcProfile || m_allocations ) {
+      // includes any page walk the access needed
+      misses = c->numReadMisses.get() + c->numWriteMisses.get() - misses;
+      remoteHits = c->numReadRemoteHits.get() + c->numWriteRemoteHits.get() - remoteHits;
+      upgradeMisses = c->numUpgradeMisses.get() - upgradeMisses;
+    }
+    if ( m_pcProfile ) {
+      PCProfile::PCStats& p = m_pcProfile->of( pc );
+      p.misses += misses;
+      p.remoteHits += remoteHits;
+      p.upgradeMisses += upgradeMisses;
+    }
+    if ( m_allocations && misses + remoteHits + upgradeMisses > 0 ) {
+      // an access straddling two objects is charged to the first one
+      AllocationMap::SiteStats& s = m_allocations->of( addr );
+      s.misses += misses;
+      s.remoteHits += remoteHits;
+      s.upgradeMisses += upgradeMisses;
+    }
+
     if ( m_simulateHB || m_simulateTSO ) {
       unsigned cpuid = cpuOfTid( tid );
-      if ( m_smartQuantumBuilding ) {
+      CoreState& core = activeCore( cpuid );
+      core.detMemoryCycles += c->deterministicTimeInMemoryHierarchy;
+      if ( m_smartQuantumBuilding && NULL == m_blockCosts ) {
         // NB: we increment work here based on the memory access that just happened, but
         // we only check for quantum ending at basic block boundaries
-        m_workCounts.at( cpuid ) += c->deterministicTimeInMemoryHierarchy;
-        c->deterministicTimeInMemoryHierarchy = 0; // reset for next access
+        core.work += c->deterministicTimeInMemoryHierarchy;
       }
+      c->deterministicTimeInMemoryHierarchy = 0; // reset for next access
 
       if ( c->storeBufferOverflowed ) {
-        m_stalledAtQuantumBoundary.at( cpuid ) = true;
+        setStalledAtQuantumBoundary( cpuid );
         StoreBufferOverflows++;
+        if ( m_pcProfile ) m_pcProfile->of( pc ).storeBufferOverflows++;
         TotalQuanta++;
         commitThisRound = true;
 
@@ -232,8 +540,28 @@ public:
     assert( !stalledAtQuantumBoundary(tid) );
     getCache( tid )->syncOp( op, validSource, cpuOfTid( sourceTid ), syncObject );
 
+    bool newlyDependsOnThisRound = false;
+    if ( m_hb ) {
+      if ( SYNC_SOURCE == op ) {
+        m_hb->release( tid, syncObject );
+      } else {
+        newlyDependsOnThisRound = m_hb->acquire( tid, syncObject );
+      }
+    }
+
+    if ( m_simulateDMPO ) {
+      // sync ops only run in serial mode
+      enterSerialMode( cpuOfTid(tid) );
+      return;
+    }
+    if ( m_simulateKendo ) {
+      // Kendo has no quanta: acquires wait for their turn, and nothing else stalls
+      if ( SYNC_SINK == op ) waitForLockTurn( tid );
+      return;
+    }
+
     if ( m_simulateTSO && SYNC_SINK == op ) {
-      m_stalledAtQuantumBoundary.at( cpuOfTid(tid) ) = true;
+      setStalledAtQuantumBoundary( cpuOfTid(tid) );
       SyncInducedRoundBoundaries++;
       TotalQuanta++;
       commitThisRound = true;
@@ -245,25 +573,27 @@ public:
     } else {
       switch ( op ) {
       case SYNC_SINK: {
-        map<uint64_t,uint64_t>::iterator i = m_roundOfSyncSource.find( syncObject );
-        if ( i != m_roundOfSyncSource.end() ) {
-          uint64_t releaseRound = i->second;
-          assert( releaseRound <= QuantumRounds.get() );
-          if ( releaseRound == QuantumRounds.get() ) {
-            // release occurred in this round: have to stall
-            m_stalledAtQuantumBoundary.at( cpuOfTid(tid) ) = true;
-            SyncInducedRoundBoundaries++;
-            TotalQuanta++;
-            commitThisRound = true;
-
-            // check to see if I'm the last one in
-            if ( weAreDoneWithQuantumRound() ) finishQuantumRound();
-          }
+        bool mustStall = false;
+        if ( m_preciseHBStalls ) {
+          // only stall if we don't already (transitively) depend on the release
+          mustStall = newlyDependsOnThisRound;
+        } else {
+          // release occurred in this round: have to stall
+          mustStall = NULL != m_releasedThisRound.find( syncObject );
+        }
+        if ( mustStall ) {
+          setStalledAtQuantumBoundary( cpuOfTid(tid) );
+          SyncInducedRoundBoundaries++;
+          TotalQuanta++;
+          commitThisRound = true;
+
+          // check to see if I'm the last one in
+          if ( weAreDoneWithQuantumRound() ) finishQuantumRound();
         }
       }
         break;
       case SYNC_SOURCE:
-        m_roundOfSyncSource[ syncObject ] = QuantumRounds.get();
+        m_releasedThisRound[ syncObject ] = true;
         break;
       default:
         assert(false);
@@ -271,19 +601,52 @@ public:
     }
   } // end syncOp()
 
-  void basicBlock( int tid, unsigned insnCount ) {
+  void basicBlock( int tid, unsigned insnCount, Addr_t bbAddr, unsigned bbSize ) {
     unsigned cpuid = cpuOfTid( tid );
-    m_insnCounts.at( cpuid ) += insnCount;
-    m_workCounts.at( cpuid ) += insnCount;
+    cache_t* c = getCache( tid );
+    if ( m_blockCosts ) closeBlock( cpuid );
+    // the block's own fetch stalls count towards its cost
+    const uint64_t blockStart = c->timeInMemoryHierarchy;
+    if ( NULL == m_shards ) {
+      c->fetch( bbAddr, bbSize, LINE_SIZE );
+    } else if ( NULL != c->L1Icache && 0 != bbSize ) {
+      // coalescing depends on this core's fetch order across all lines, so do it here
+      const Addr_t lastLine = (bbAddr + bbSize - 1) & ~Addr_t(LINE_SIZE - 1);
+      for ( Addr_t line = bbAddr & ~Addr_t(LINE_SIZE - 1); line <= lastLine; line += LINE_SIZE ) {
+        if ( !c->fetchCoalesced( line ) ) {
+          m_shards->fetchLine( cpuid, line );
+        }
+      }
+    }
+    CoreState& core = activeCore( cpuid );
+    core.insns += insnCount;
+    m_scheduler.executed( tid, insnCount );
+
+    if ( m_blockCosts ) {
+      OpenBlock& b = m_openBlocks.at( cpuid );
+      b.open = true;
+      b.tid = tid;
+      b.bbAddr = bbAddr;
+      b.insns = insnCount;
+      b.predictedCycles = m_blockCosts->predict( tid, bbAddr, insnCount );
+      b.detMemoryCycles = 0;
+      b.detStart = core.detMemoryCycles;
+      b.memoryCycles = 0;
+      b.start = blockStart;
+      core.work += b.predictedCycles;
+    } else {
+      core.work += insnCount;
+    }
 
-    if ( !(m_simulateHB || m_simulateTSO) ) {
+    if ( !usesQuanta() ) {
       return;
     }
     assert( !stalledAtQuantumBoundary(tid) );
 
-    if ( m_workCounts[cpuid] >= m_quantumSize ) {
+    // NB: with m_blockCosts, quanta end on predicted cycles rather than insns
+    if ( core.work >= m_quantumSize ) {
       // hit quantum boundary
-      m_stalledAtQuantumBoundary.at( cpuid ) = true;
+      setStalledAtQuantumBoundary( cpuid );
       InsnCountInducedRoundBoundaries++;
       TotalQuanta++;
       commitThisRound = true;
@@ -293,53 +656,363 @@ public:
     }
   } // end basicBlock()
 
+  /** Whether threads run in quanta, i.e., whether quantum sizes matter */
+  bool usesQuanta() const {
+    return m_simulateHB || m_simulateTSO || m_simulateDMPO;
+  }
+
+  /** Cycles the given core has run for this round */
+  uint64_t coreRuntime( unsigned i ) {
+    const CoreState& s = m_cores[i];
+    return s.insns + m_allCaches[i]->timeInMemoryHierarchy + s.contextSwitchCycles + s.syncWaitCycles;
+  }
+
+  /** DMP-O: the rest of this core's quantum runs in serial mode. */
+  void enterSerialMode( unsigned cpuid ) {
+    CoreState& s = activeCore( cpuid );
+    if ( s.serialMode ) return;
+    s.serialMode = true;
+    s.parallelRuntime = coreRuntime( cpuid );
+    SerialModeQuanta++;
+  }
+
+  /** Kendo: a thread may only acquire a lock once every other running thread's
+   * logical clock has passed its own, with ties going to the lower tid. The
+   * logical clock is the thread's deterministic insn count, and it alone
+   * decides whose turn it is and how far behind each thread is. Cycles only
+   * price the wait: a lagging thread covers the insns it is behind at its
+   * core's execution rate this round (insns plus memory cycles per insn, not
+   * counting time the core itself spent waiting or switching threads), and
+   * tid's core stalls until the last of them catches up. */
+  void waitForLockTurn( unsigned tid ) {
+    const unsigned myCore = cpuOfTid( tid );
+    const uint64_t myClock = m_scheduler.insnsOf( tid );
+    const uint64_t myTime = coreRuntime( myCore );
+    uint64_t turnTime = myTime;
+    for ( unsigned c = 0; c < NUM_CORES; c++ ) {
+      const unsigned other = m_scheduler.currentThreadOf( c );
+      if ( c == myCore || ThreadScheduler::NO_THREAD == other ||
+           !m_scheduler.isRunnable( other ) ) {
+        continue;
+      }
+      const uint64_t otherClock = m_scheduler.insnsOf( other );
+      if ( otherClock > myClock || (otherClock == myClock && other > tid) ) {
+        continue;
+      }
+      const uint64_t behind = myClock - otherClock;
+      const uint64_t insns = m_cores[c].insns;
+      const uint64_t executing = insns + m_allCaches[c]->timeInMemoryHierarchy;
+      const uint64_t catchUp = insns ? behind * executing / insns : behind;
+      turnTime = max( turnTime, coreRuntime( c ) + catchUp );
+    }
+    if ( turnTime > myTime ) {
+      LockTurnWaits++;
+      LockTurnWaitCycles.add( turnTime - myTime );
+      activeCore( myCore ).syncWaitCycles += turnTime - myTime;
+    }
+  }
+
+  /** Measure quanta in cycles predicted per basic block, instead of insns.
+   * Replaces the store buffer-based estimate of smart quantum building. */
+  void useBlockCostPredictor() {
+    assert( NULL == m_blockCosts );
+    m_blockCosts = new BlockCostPredictor();
+  }
+
+  /** Track happens-before with vector clocks.
+   * @param preciseStalls Det-HB stalls sinks based on vector clocks instead of
+   * just the round of the last release
+   * @param raceReport check every access for data races */
+  void useHappensBefore( bool preciseStalls, bool raceReport ) {
+    assert( NULL == m_hb );
+    m_hb = new HappensBefore();
+    m_preciseHBStalls = preciseStalls;
+    m_raceReport = raceReport;
+  }
+
+  /** Compute miss-ratio curves for each core's data accesses, and for all of
+   * them together, in one pass. See StackDistance.hpp.
+   * @param rate fraction of lines to sample
+   * @param assoc associativity of the modeled caches, or 0 for fully-associative
+   * @param maxSize largest cache size to report, in bytes */
+  void useMissRatioCurves( double rate, unsigned assoc, uint64_t maxSize ) {
+    assert( NULL == m_mrc );
+    m_mrc = new MissRatioCurves( NUM_CORES, LINE_SIZE, rate, assoc, maxSize );
+  }
+
+  /** Attribute misses and coherence events to PCs.
+   * @param symbolFile the front-end's symbol file, or "" to report raw PCs
+   * @return whether the symbol file could be read */
+  bool usePCProfile( const string& symbolFile ) {
+    assert( NULL == m_pcProfile && NULL == m_shards );
+    m_pcProfile = new PCProfile();
+    return symbolFile.empty() || m_pcProfile->loadSymbols( symbolFile );
+  }
+
+  /** Attribute misses, coherence events and committed dirty lines to
+   * allocation sites. See AllocationMap.hpp.
+   * @param symbolFile the front-end's symbol file, or "" to report raw sites
+   * @return whether the symbol file could be read */
+  bool useAllocationMap( const string& symbolFile ) {
+    assert( NULL == m_allocations && NULL == m_shards );
+    m_allocations = new AllocationMap();
+    return symbolFile.empty() || m_allocations->loadSymbols( symbolFile );
+  }
+
+  /** Classify coherence misses as true or false sharing. See SharingTracker.hpp. */
+  void useSharingTracker() {
+    assert( NULL == m_sharing && NULL == m_shards );
+    m_sharing = new SharingTracker( NUM_CORES, LINE_SIZE );
+    for ( unsigned c = 0; c < NUM_CORES; c++ ) {
+      m_allCaches[c]->sharingTracker = m_sharing;
+    }
+  }
+
+  /** Record who talks to whom. See CoherenceTraffic.hpp. */
+  void useCoherenceTraffic() {
+    assert( NULL == m_coherence && NULL == m_shards );
+    m_coherence = new CoherenceTraffic( NUM_CORES );
+    for ( unsigned c = 0; c < NUM_CORES; c++ ) {
+      m_allCaches[c]->coherenceTraffic = m_coherence;
+    }
+  }
+
+  /** The block running on the given core is done: train the predictor on its
+   * deterministic cost, and report how well the prediction matched the cycles
+   * it actually took. */
+  void closeBlock( unsigned cpuid ) {
+    OpenBlock& b = m_openBlocks.at( cpuid );
+    if ( !b.open ) return;
+    const uint64_t cost = b.insns + b.detMemoryCycles + ( m_cores[cpuid].detMemoryCycles - b.detStart );
+    m_blockCosts->observe( b.tid, b.bbAddr, b.insns, cost );
+    const uint64_t actual = b.insns + b.memoryCycles
+        + ( m_allCaches.at( cpuid )->timeInMemoryHierarchy - b.start );
+    PredictedBlockCycles.add( b.predictedCycles );
+    ActualBlockCycles.add( actual );
+    BlockCyclePredictionAbsError.add( actual > b.predictedCycles ? actual - b.predictedCycles
+                                                                  : b.predictedCycles - actual );
+    b.open = false;
+  }
+
   bool weAreDoneWithQuantumRound() {
-    unsigned numNonProgressingCores = 0;
-    for ( unsigned i = 0; i < NUM_CORES; i++ ) {
-      if ( m_stalledAtQuantumBoundary.at(i) || m_blocked.at(i) || m_waitingForCausality.at(i) ) {
-        numNonProgressingCores++;
+    // NB: cores without any runnable threads count as blocked
+    return (m_numNonProgressingCores >= NUM_CORES);
+  }
+
+  /** Note that the given core has something to account for at the end of this round. */
+  CoreState& activeCore( unsigned cpuid ) {
+    CoreState& s = m_cores.at( cpuid );
+    if ( !s.active ) {
+      s.active = true;
+      m_activeCores.push_back( cpuid );
+    }
+    return s;
+  }
+
+  /** Keep m_numNonProgressingCores up to date after a core's state changed. */
+  void progressChanged( bool wasProgressing, const CoreState& s ) {
+    if ( wasProgressing && !s.progressing() ) {
+      m_numNonProgressingCores++;
+    } else if ( !wasProgressing && s.progressing() ) {
+      assert( m_numNonProgressingCores > 0 );
+      m_numNonProgressingCores--;
+    }
+  }
+
+  void setStalledAtQuantumBoundary( unsigned cpuid ) {
+    CoreState& s = activeCore( cpuid );
+    const bool was = s.progressing();
+    s.stalledAtQuantumBoundary = true;
+    progressChanged( was, s );
+  }
+
+  void setBlocked( unsigned cpuid, bool blocked ) {
+    CoreState& s = m_cores.at( cpuid );
+    const bool was = s.progressing();
+    s.blocked = blocked;
+    progressChanged( was, s );
+  }
+
+  void setWaitingForCausality( unsigned cpuid, bool waiting ) {
+    CoreState& s = m_cores.at( cpuid );
+    const bool was = s.progressing();
+    s.waitingForCausality = waiting;
+    progressChanged( was, s );
+  }
+
+  /** Cleans lines, counting how many were dirty */
+  struct CleanAndCount {
+    uint64_t dirtyLines;
+    /** if non-NULL, collects the tags of the dirty lines */
+    vector<uint64_t>* dirtyTags;
+    CleanAndCount( vector<uint64_t>* tags ) : dirtyLines( 0 ), dirtyTags( tags ) {}
+    void operator()( Line* l ) {
+      if ( l->isDirty() ) {
+        dirtyLines++;
+        if ( dirtyTags ) dirtyTags->push_back( l->tag() );
+        l->setClean();
       }
     }
+  };
+
+  /** Clear the store buffer of m_storeBuffersToClear[i], recording how many
+   * dirty lines it committed. */
+  void clearStoreBuffer( unsigned i ) {
+    cache_t* cache = m_storeBuffersToClear.at( i );
+    vector<uint64_t>* tags = NULL;
+    if ( m_allocations ) {
+      tags = &m_committedTags.at( i );
+      tags->clear();
+    }
+    CleanAndCount cleaner( tags );
+    // clear L1
+    cache->L1cache->visitAllLines( cleaner );
+    // clear L2, if present
+    if ( cache->L2cache ) {
+      cache->L2cache->visitAllLines( cleaner );
+    }
+    // dirty lines can migrate into the L1I via the L2
+    if ( cache->L1Icache ) {
+      cache->L1Icache->visitAllLines( cleaner );
+    }
+    cache->StoreBufferIsEmpty = true;
+    m_committedLines.at( i ) = cleaner.dirtyLines;
+  }
 
-    return (numNonProgressingCores >= min( NUM_CORES, m_liveThreads ));
+  /** Simulate the cache hierarchy with the given number of set-partitioned
+   * worker threads. Only valid for nondet, which has no quanta for an access
+   * to end (see ShardedCaches.hpp), and without TLBs, whose pages span many
+   * sets. Call after the per-core caches have been configured. */
+  void useShards( unsigned n, CacheConfiguration<Line> l1config,
+                  bool useL2, CacheConfiguration<Line> l2config,
+                  bool useL3, CacheConfiguration<Line> l3config,
+                  bool useL1I, CacheConfiguration<Line> l1iconfig ) {
+    assert( NULL == m_shards );
+    assert( !m_simulateHB && !m_simulateTSO && !m_useTLBs );
+    m_shards = new ShardedCaches<Line>( n, NUM_CORES, l1config, useL2, l2config,
+                                        useL3, l3config, useL1I, l1iconfig );
   }
 
-  static void clean(Line* l) {
-    l->setClean();
+  /** Adapt the quantum size between the given bounds after every round. */
+  void useAdaptiveQuantum( unsigned minSize, unsigned maxSize ) {
+    assert( NULL == m_adaptiveQuantum );
+    m_adaptiveQuantum = new AdaptiveQuantum( minSize, maxSize );
+    m_quantumSize = min( max( m_quantumSize, minSize ), maxSize );
   }
 
   void finishQuantumRound() {
+    PROFILE_SCOPE_ALWAYS( PROF_QUANTUM_ROUND );
+    if ( m_shards ) m_shards->collect( m_allCaches );
+
+    if ( m_adaptiveQuantum && usesQuanta() ) {
+      vector<uint64_t> work( m_activeCores.size() );
+      for ( unsigned a = 0; a < m_activeCores.size(); a++ ) {
+        const CoreState& s = m_cores[ m_activeCores[a] ];
+        work[a] = s.insns + s.detMemoryCycles;
+      }
+      m_quantumSize = m_adaptiveQuantum->roundFinished( m_quantumSize, work,
+          InsnCountInducedRoundBoundaries.get() - m_roundStartInsnBoundaries,
+          SyncInducedRoundBoundaries.get() - m_roundStartSyncBoundaries,
+          StoreBufferOverflows.get() - m_roundStartOverflows );
+      m_roundStartInsnBoundaries = InsnCountInducedRoundBoundaries.get();
+      m_roundStartSyncBoundaries = SyncInducedRoundBoundaries.get();
+      m_roundStartOverflows = StoreBufferOverflows.get();
+    }
+
+    if ( m_blockCosts ) {
+      // blocks can straddle rounds; carry over the cycles they've taken so far
+      for ( unsigned a = 0; a < m_activeCores.size(); a++ ) {
+        const unsigned i = m_activeCores[a];
+        OpenBlock& b = m_openBlocks[i];
+        if ( !b.open ) continue;
+        b.detMemoryCycles += m_cores[i].detMemoryCycles - b.detStart;
+        b.detStart = 0;
+        b.memoryCycles += m_allCaches.at( i )->timeInMemoryHierarchy - b.start;
+        b.start = 0;
+      }
+      m_blockCosts->quantumRoundFinished();
+    }
+
     uint64_t roundRuntime = 0;
-    uint64_t firstToFinish = numeric_limits<uint64_t>::max();
-    for ( unsigned i = 0; i < NUM_CORES; i++ ) {
-      cache_t* cache = m_allCaches.at(i);
-      uint64_t coreRuntime = m_insnCounts.at( i ) + cache->timeInMemoryHierarchy;
-      roundRuntime = max( roundRuntime, coreRuntime );
-      firstToFinish = min( coreRuntime, firstToFinish );
-      m_sumOfInsnsPerQuantum += m_insnCounts.at( i );
-      m_sumOfCyclesPerQuantum += coreRuntime;
-
-      m_stalledAtQuantumBoundary.at( i ) = false;
-      m_insnCounts.at( i ) = 0;
-      m_workCounts.at( i ) = 0;
+    // cores that did nothing this round finished first, at time 0
+    uint64_t firstToFinish = m_activeCores.size() < NUM_CORES ? 0 : numeric_limits<uint64_t>::max();
+    // DMP-O: serial parts of quanta run one after another, after the parallel parts
+    uint64_t serialRuntime = 0;
+    for ( unsigned a = 0; a < m_activeCores.size(); a++ ) {
+      const unsigned i = m_activeCores[a];
+      CoreState& s = m_cores[i];
+      cache_t* cache = m_allCaches[i];
+      const uint64_t runtime = coreRuntime( i );
+      const uint64_t parallelRuntime = s.serialMode ? s.parallelRuntime : runtime;
+      serialRuntime += runtime - parallelRuntime;
+      roundRuntime = max( roundRuntime, parallelRuntime );
+      firstToFinish = min( parallelRuntime, firstToFinish );
+      m_sumOfInsnsPerQuantum += s.insns;
+      m_sumOfCyclesPerQuantum += runtime;
+
+      const bool wasProgressing = s.progressing();
+      s.stalledAtQuantumBoundary = false;
+      progressChanged( wasProgressing, s );
+      s.insns = 0;
+      s.work = 0;
+      s.contextSwitchCycles = 0;
+      s.detMemoryCycles = 0;
+      s.syncWaitCycles = 0;
+      s.serialMode = false;
+      s.active = false;
       cache->timeInMemoryHierarchy = 0;
       cache->storeBufferOverflowed = false;
 
-      // clear out store buffers
       if ( !cache->StoreBufferIsEmpty ) {
-        // clear L1
-        cache->L1cache->visitAllLines( MultiCacheSimulator::clean );
-        // clear L2, if present
-        if ( cache->L2cache ) {
-          cache->L2cache->visitAllLines( MultiCacheSimulator::clean );
+        m_storeBuffersToClear.push_back( cache );
+      }
+    }
+
+    m_activeCores.clear();
+    const uint64_t imbalance = roundRuntime - firstToFinish;
+    roundRuntime += serialRuntime;
+    SerialCycles.add( serialRuntime );
+
+    // clear out store buffers
+    m_committedLines.assign( m_storeBuffersToClear.size(), 0 );
+    if ( m_allocations ) m_committedTags.resize( m_storeBuffersToClear.size() );
+    {
+      PROFILE_SCOPE_ALWAYS( PROF_STORE_BUFFER_COMMIT );
+      for ( unsigned i = 0; i < m_storeBuffersToClear.size(); i++ ) {
+        clearStoreBuffer( i );
+      }
+    }
+    if ( m_allocations ) {
+      for ( unsigned i = 0; i < m_storeBuffersToClear.size(); i++ ) {
+        for ( unsigned j = 0; j < m_committedTags[i].size(); j++ ) {
+          m_allocations->of( m_committedTags[i][j] * LINE_SIZE ).dirtyLines++;
         }
+      }
+    }
+    m_storeBuffersToClear.clear();
 
-        cache->StoreBufferIsEmpty = true;
+    if ( m_modelCommit ) {
+      const uint64_t commit = m_commit.cycles( m_committedLines );
+      uint64_t dirtyLines = 0;
+      for ( unsigned i = 0; i < m_committedLines.size(); i++ ) {
+        dirtyLines += m_committedLines[i];
       }
+      DirtyLinesCommitted.add( dirtyLines );
+      CommitCycles.add( commit );
+      m_commitCyclesHistogram.record( commit );
+      m_dirtyLinesHistogram.record( dirtyLines );
+
+      const uint64_t exposed = m_commit.roundFinished( roundRuntime, commit );
+      roundRuntime += exposed;
+      ExposedCommitCycles.add( exposed );
     }
+
     Runtime += roundRuntime;
-    TotalQuantumImbalance += (roundRuntime - firstToFinish);
+    TotalQuantumImbalance.add( imbalance );
     QuantumRounds++;
+    m_releasedThisRound.clear();
+    if ( m_hb ) m_hb->quantumRoundFinished();
+    if ( m_coherence ) m_coherence->endRound();
     if ( commitThisRound ) {
       QuantumRoundCommits++;
       commitThisRound = false;
@@ -351,33 +1024,63 @@ public:
   }
 
   void waitForCausality(int tid) {
-    m_waitingForCausality.at( cpuOfTid(tid) ) = true;
+    setWaitingForCausality( cpuOfTid(tid), true );
+    // other threads on this core may be able to run in the meantime
+    m_scheduler.preempt( cpuOfTid(tid) );
     if ( weAreDoneWithQuantumRound() ) finishQuantumRound();
   }
   void satisfiedCausality(int tid) {
-    m_waitingForCausality.at( cpuOfTid(tid) ) = false;
+    setWaitingForCausality( cpuOfTid(tid), false );
   }
   bool isWaitingForCausality(int tid) {
-    return m_waitingForCausality.at( cpuOfTid(tid) );
+    return m_cores.at( cpuOfTid(tid) ).waitingForCausality;
+  }
+
+  /** Number of quantum rounds finished so far; changes whenever stalled cores are released. */
+  uint64_t numQuantumRounds() {
+    return QuantumRounds.get();
   }
 
   bool stalledAtQuantumBoundary(int tid) {
-    return m_stalledAtQuantumBoundary.at( cpuOfTid(tid) );
+    return m_cores.at( cpuOfTid(tid) ).stalledAtQuantumBoundary;
+  }
+
+  /** For progress reports: why the given core isn't running, or "running" */
+  const char* coreStatus(unsigned cpuid) const {
+    const CoreState& core = m_cores.at( cpuid );
+    if ( core.blocked ) return "blocked";
+    if ( core.stalledAtQuantumBoundary ) return "quantum-boundary";
+    if ( core.waitingForCausality ) return "causality";
+    return "running";
+  }
+
+  void threadStarted(int tid) {
+    m_scheduler.threadStarted( tid );
+    setBlocked( cpuOfTid(tid), m_scheduler.coreIsIdle( cpuOfTid(tid) ) );
+  }
+  void threadFinished(int tid) {
+    m_scheduler.threadFinished( tid );
+    setBlocked( cpuOfTid(tid), m_scheduler.coreIsIdle( cpuOfTid(tid) ) );
+    if ( weAreDoneWithQuantumRound() ) finishQuantumRound();
   }
 
   void block(int tid) {
-    // NB: can't assert that un/block events are properly nested, because of thread:core multiplexing
-    //assert( !m_blocked.at( cpuOfTid(tid) ) );
-    m_blocked.at( cpuOfTid(tid) ) = true;
+    m_scheduler.block( tid );
+    setBlocked( cpuOfTid(tid), m_scheduler.coreIsIdle( cpuOfTid(tid) ) );
     if ( weAreDoneWithQuantumRound() ) finishQuantumRound();
   }
   void unblock(int tid) {
-    // NB: can't assert that un/block events are properly nested, because of thread:core multiplexing
-    //assert( m_blocked.at( cpuOfTid(tid) ) );
-    m_blocked.at( cpuOfTid(tid) ) = false;
+    m_scheduler.unblock( tid );
+    setBlocked( cpuOfTid(tid), m_scheduler.coreIsIdle( cpuOfTid(tid) ) );
   }
   bool isblocked(int tid) {
-    return m_blocked.at( cpuOfTid(tid) );
+    return m_cores.at( cpuOfTid(tid) ).blocked;
+  }
+  /** Treat a core as blocked regardless of its threads, e.g. once the trace has run dry. */
+  void blockCore(unsigned cpuid) {
+    setBlocked( cpuid, true );
+    m_scheduler.preempt( cpuid );
+    if ( weAreDoneWithQuantumRound() ) finishQuantumRound();
   }
 
   void setLiveThreads(unsigned n) {
@@ -0,0 +1,71 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OWNERSHIPTABLE_HPP_
+#define OWNERSHIPTABLE_HPP_
+
+#include <stdint.h>
+
+#include "FlatHashMap.hpp"
+
+using namespace std;
+
+/** The DMP-O ownership table. Each line is either owned by a single thread or
+ * shared by everyone. In parallel mode a thread may read lines it owns or that
+ * are shared, and write lines it owns; any other access communicates with
+ * another thread and has to wait for serial mode. */
+class OwnershipTable {
+public:
+  static const unsigned SHARED = static_cast<unsigned>(-1);
+
+private:
+  /** line address => owning thread or SHARED */
+  FlatHashMap<unsigned> m_owners;
+
+public:
+
+  /** Whether the given access by tid communicates. The ownership change that a
+   * communicating access makes in serial mode (a write takes the line, a read
+   * shares it) is applied right away. Lines nobody has touched yet go to the
+   * first thread to access them. */
+  bool communicates( uint64_t line, unsigned tid, bool write ) {
+    bool untouched;
+    unsigned& owner = m_owners.findOrInsert( line, untouched );
+    if ( untouched ) {
+      owner = tid;
+      return false;
+    }
+    if ( owner == tid || (SHARED == owner && !write) ) {
+      return false;
+    }
+    owner = write ? tid : SHARED;
+    return true;
+  }
+
+  unsigned ownerOf( uint64_t line ) const {
+    const unsigned* owner = m_owners.find( line );
+    return NULL == owner ? SHARED : *owner;
+  }
+
+};
+
+#endif /* OWNERSHIPTABLE_HPP_ */
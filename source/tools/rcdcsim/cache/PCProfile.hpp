@@ -0,0 +1,121 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Attributes cache misses and coherence events to the instructions that
+ * caused them, using the PC the front-end puts in memory events, and reports
+ * the instructions that cost the most. PCs are named with a SymbolTable.
+ */
+
+#ifndef PCPROFILE_HPP_
+#define PCPROFILE_HPP_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+
+#include "FlatHashMap.hpp"
+#include "SymbolTable.hpp"
+#include "StatsDocument.hpp"
+
+using namespace std;
+
+class PCProfile {
+public:
+  struct PCStats {
+    uint64_t pc;
+    uint64_t misses;
+    uint64_t remoteHits;
+    uint64_t upgradeMisses;
+    /** accesses that overflowed the det store buffer, ending the quantum */
+    uint64_t storeBufferOverflows;
+
+    uint64_t cost() const {
+      return misses + remoteHits + upgradeMisses + storeBufferOverflows;
+    }
+  };
+
+private:
+  vector<PCStats> m_pcs;
+  /** 1 + index into m_pcs */
+  FlatHashMap<uint32_t> m_index;
+  /** loops hit the same PC over and over */
+  uint64_t m_lastPC;
+  uint32_t m_lastIndex;
+
+  SymbolTable m_symbols;
+
+  static const unsigned TOP_PCS = 20;
+
+  static bool costlier( const PCStats& a, const PCStats& b ) {
+    return a.cost() > b.cost();
+  }
+
+public:
+  PCProfile() : m_lastPC( 0 ), m_lastIndex( 0 ) {}
+
+  /** The stats for the given PC, created if needed. References are
+   * invalidated by later calls. */
+  PCStats& of( uint64_t pc ) {
+    if ( pc == m_lastPC && m_lastIndex != 0 ) return m_pcs[ m_lastIndex - 1 ];
+    bool inserted;
+    uint32_t& slot = m_index.findOrInsert( pc, inserted );
+    if ( inserted ) {
+      PCStats s = PCStats();
+      s.pc = pc;
+      m_pcs.push_back( s );
+      slot = m_pcs.size();
+    }
+    m_lastPC = pc;
+    m_lastIndex = slot;
+    return m_pcs[ slot - 1 ];
+  }
+
+  /** @return whether the symbol file could be read */
+  bool loadSymbols( const string& filename ) {
+    return m_symbols.load( filename );
+  }
+
+  /** "routine+0xoffset", or "" if no routine contains pc */
+  string symbolOf( uint64_t pc ) const {
+    return m_symbols.symbolOf( pc );
+  }
+
+  /** One line for each of the costliest PCs. */
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    os << prefix << "'ProfiledPCs': " << m_pcs.size() << suffix;
+    vector<PCStats> top( m_pcs );
+    const unsigned n = top.size() < TOP_PCS ? top.size() : TOP_PCS;
+    partial_sort( top.begin(), top.begin() + n, top.end(), costlier );
+    for ( unsigned i = 0; i < n && top[i].cost() > 0; i++ ) {
+      os << prefix << "'pc': " << top[i].pc
+         << ", 'pcSymbol': " << StatsDocument::pyQuote( symbolOf( top[i].pc ) )
+         << ", 'pcMisses': " << top[i].misses << ", 'pcRemoteHits': " << top[i].remoteHits
+         << ", 'pcUpgradeMisses': " << top[i].upgradeMisses
+         << ", 'pcStoreBufferOverflows': " << top[i].storeBufferOverflows << suffix;
+    }
+  }
+};
+
+#endif /* PCPROFILE_HPP_ */
@@ -24,8 +24,12 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 #define _IVDSIMSMPCACHE_H_
 
 #include "HierarchicalCache.hpp"
+#include "TLB.hpp"
+#include "SharingTracker.hpp"
+#include "CoherenceTraffic.hpp"
 
 #include "Counter.hpp"
+#include "SelfProfile.hpp"
 
 #include "cachesim.hpp"
 
@@ -51,9 +55,12 @@ public:
 class InvalidateReply {
 public:
   bool nobodyHasThisLine;
+  /** a core that had the line, if anybody did */
+  unsigned supplier;
 
-  InvalidateReply( bool nhtl ) {
+  InvalidateReply( bool nhtl, unsigned sup = 0 ) {
     nobodyHasThisLine = nhtl;
+    supplier = sup;
   }
 };
 
@@ -66,9 +73,6 @@ public:
   }
 };
 
-/** global map from sync objects to a vector clock snapshot. Lives in SimulatorThread.cpp */
-extern map<uint64_t, vector<uint64_t> > g_vcOfSyncObject;
-
 template<class State, class Addr_t = uint64_t>
 class SMPCache : public CacheCallbacks<State> {
 
@@ -80,6 +84,8 @@ public:
   static const unsigned L3_HIT_LATENCY = 35;
   //static const unsigned MEMORY_ACCESS_LATENCY = 120;
   static const unsigned MEMORY_ACCESS_LATENCY = 121;
+  static const unsigned L2_TLB_HIT_LATENCY = 7;
+  static const unsigned PAGE_WALK_CACHE_HIT_LATENCY = 1;
 
   int CPUId;
 
@@ -99,6 +105,26 @@ public:
   /** L3, shared by all processors */
   HierarchicalCache<State>* L3cache;
 
+  /** private instruction cache, backed by L2cache (or L3cache if there is no L2).
+   * NULL unless fetch modeling is enabled. Its lines are read-only sharers in
+   * the coherence protocol: while any L1I holds a line, no data cache holds it
+   * Exclusive or Modified, so every write to it snoops and invalidates the
+   * instruction copies. */
+  HierarchicalCache<State>* L1Icache;
+  unsigned fetchLineSize;
+  /** The line most recently fetched. Only the fetch stream can evict lines from
+   * the L1I, so a fetch to this line is guaranteed to hit. */
+  Addr_t lastFetchLine;
+
+  /** data TLBs; NULL unless TLB modeling is enabled */
+  DataTLB* dtlb;
+  /** classifies coherence misses; shared by all the caches, NULL unless enabled */
+  SharingTracker* sharingTracker;
+  /** core-to-core coherence traffic; shared by all the caches, NULL unless enabled */
+  CoherenceTraffic* coherenceTraffic;
+  /** scratch space for page walks */
+  vector<uint64_t> walkPTEs;
+
 
   typedef typename vector<SMPCache<State, Addr_t> *>::const_iterator cache_iter_t;
   /** List of all the caches in the system. This points to the same vector for all caches */
@@ -122,6 +148,17 @@ public:
   Counter numSyncTotalSinks;
   Counter numSyncSourcelessSinks;
   Counter numSyncUnmatchedSinks;
+  Counter numL1DTLBMisses;
+  Counter numL2DTLBMisses; /** i.e., page walks */
+  Counter numHugePageAccesses;
+  Counter numPageWalkCacheHits;
+  Counter numPageWalkMemoryRefs;
+  Counter pageWalkCycles;
+  Counter numFetches;
+  Counter numCoalescedFetches;
+  Counter numFetchL1IMisses;
+  Counter numFetchMemoryMisses;
+  Counter fetchStallCycles;
 
   // counters for RCDC events
 
@@ -130,6 +167,8 @@ public:
   virtual ~SMPCache() {
     delete L1cache;
     delete L2cache;
+    delete L1Icache;
+    delete dtlb;
   }
 
   SMPCache( int cpuid, int numCpus,
@@ -144,6 +183,12 @@ public:
         deterministicTimeInMemoryHierarchy( 0 ),
         StoreBufferIsEmpty( true ),
         L3cache( l3 ),
+        L1Icache( NULL ),
+        fetchLineSize( 0 ),
+        lastFetchLine( numeric_limits<Addr_t>::max() ),
+        dtlb( NULL ),
+        sharingTracker( NULL ),
+        coherenceTraffic( NULL ),
         allCaches( cacheVector ),
 
 #define COUNTER(name) name( Counter(cpuid,#name) )
@@ -161,7 +206,18 @@ public:
         COUNTER(numSyncSources),
         COUNTER(numSyncTotalSinks),
         COUNTER(numSyncSourcelessSinks),
-        COUNTER(numSyncUnmatchedSinks)
+        COUNTER(numSyncUnmatchedSinks),
+        COUNTER(numL1DTLBMisses),
+        COUNTER(numL2DTLBMisses),
+        COUNTER(numHugePageAccesses),
+        COUNTER(numPageWalkCacheHits),
+        COUNTER(numPageWalkMemoryRefs),
+        COUNTER(pageWalkCycles),
+        COUNTER(numFetches),
+        COUNTER(numCoalescedFetches),
+        COUNTER(numFetchL1IMisses),
+        COUNTER(numFetchMemoryMisses),
+        COUNTER(fetchStallCycles)
 #undef COUNTER
   {
     L1cache = L2cache = NULL;
@@ -226,6 +282,159 @@ public:
   } // end syncOp()
 
 
+  /** Turn on TLB modeling for this core. */
+  void enableTLBs( const TLBConfiguration& config ) {
+    assert( NULL == dtlb );
+    dtlb = new DataTLB( config );
+  }
+
+  /** Translate the given virtual address via the TLBs, walking the page table on a
+   * TLB miss. Page table entries are read through this core's cache hierarchy, so
+   * walks compete with data for cache capacity, and walk latency shows up in
+   * timeInMemoryHierarchy. A no-op if TLB modeling is disabled. */
+  void translate( uint64_t vaddr, bool hugePage, unsigned lineSize ) {
+    if ( NULL == dtlb ) return;
+    if ( hugePage ) numHugePageAccesses++;
+
+    switch ( dtlb->lookup( vaddr, hugePage ) ) {
+    case TLB_L1_HIT:
+      // overlapped with the L1 cache access
+      return;
+    case TLB_L2_HIT:
+      numL1DTLBMisses++;
+      timeInMemoryHierarchy += L2_TLB_HIT_LATENCY;
+      return;
+    case TLB_MISS:
+      break;
+    default:
+      assert(false);
+    }
+
+    numL1DTLBMisses++;
+    numL2DTLBMisses++;
+    const uint64_t walkStart = timeInMemoryHierarchy;
+    timeInMemoryHierarchy += L2_TLB_HIT_LATENCY;
+
+    unsigned pwcLevels = dtlb->walk( vaddr, hugePage, walkPTEs );
+    if ( pwcLevels > 0 ) {
+      numPageWalkCacheHits++;
+      timeInMemoryHierarchy += PAGE_WALK_CACHE_HIT_LATENCY;
+    }
+    // each level of the walk depends on the previous one, so the reads are serialized
+    for ( unsigned i = 0; i < walkPTEs.size(); i++ ) {
+      numPageWalkMemoryRefs++;
+      read( DataAccess( READ_ACCESS, walkPTEs[i], DataTLB::PTE_SIZE, lineSize ) );
+    }
+    pageWalkCycles += ( timeInMemoryHierarchy - walkStart );
+  } // end translate()
+
+  /** Turn on instruction fetch modeling for this core. Must be called after
+   * the data caches have been built. */
+  void enableICache( CacheConfiguration<State> l1iconfig ) {
+    assert( NULL == L1Icache );
+    l1iconfig.callbacks = this;
+    L1Icache = new HierarchicalCache<State>( l1iconfig, L2cache ? L2cache : L3cache );
+    fetchLineSize = l1iconfig.blockSize;
+  }
+
+  /** Fetch the instruction bytes [addr, addr+size). Fetches that hit in the
+   * L1I are pipelined and cost nothing; misses stall the core for the latency
+   * of the level that supplied the line, which is added to
+   * timeInMemoryHierarchy. A no-op if fetch modeling is disabled. */
+  void fetch( Addr_t addr, unsigned size, unsigned lineSize ) {
+    if ( NULL == L1Icache || 0 == size ) return;
+
+    const Addr_t lastLine = (addr + size - 1) & ~Addr_t(lineSize - 1);
+    for ( Addr_t line = addr & ~Addr_t(lineSize - 1); line <= lastLine; line += lineSize ) {
+      if ( !fetchCoalesced( line ) ) {
+        fetchLine( line );
+      }
+    }
+  } // end fetch()
+
+  /** Count a fetch of the given line, and return whether it is guaranteed to
+   * hit because it goes to the same line as the previous fetch. */
+  bool fetchCoalesced( Addr_t line ) {
+    numFetches++;
+    if ( line == lastFetchLine ) {
+      numCoalescedFetches++;
+      return true;
+    }
+    lastFetchLine = line;
+    return false;
+  }
+
+  /** Fetch a single line through the L1I, charging any stall. The line joins
+   * the coherence protocol as a read-only sharer. */
+  void fetchLine( Addr_t line ) {
+    State* l = NULL;
+    CacheResponse r = L1Icache->access( line, l );
+    if ( L1_HIT == r ) return;
+
+    // our own data copy, if any, loses write permission
+    State* data = NULL;
+    if ( MISSED_TO_MEMORY != L1cache->search( line, data ) &&
+         ( MESI_EXCLUSIVE == data->getState() || MESI_MODIFIED == data->getState() ) ) {
+      data->changeStateTo( MESI_SHARED );
+    }
+
+    switch ( r ) {
+    case L2_HIT:
+      timeInMemoryHierarchy += L2_HIT_LATENCY;
+      fetchStallCycles += L2_HIT_LATENCY;
+      break;
+    case L3_HIT:
+      timeInMemoryHierarchy += L3_HIT_LATENCY;
+      fetchStallCycles += L3_HIT_LATENCY;
+      break;
+    case MISSED_TO_MEMORY:
+      // other cores' copies lose write permission too
+      if ( readRemoteAction( DataAccess( READ_ACCESS, line, 1, fetchLineSize ) ).providedData ) {
+        timeInMemoryHierarchy += REMOTE_HIT_LATENCY;
+        fetchStallCycles += REMOTE_HIT_LATENCY;
+      } else {
+        numFetchMemoryMisses++;
+        timeInMemoryHierarchy += MEMORY_ACCESS_LATENCY;
+        fetchStallCycles += MEMORY_ACCESS_LATENCY;
+      }
+      break;
+    default:
+      assert(false);
+    }
+    // a line that came up from the L2 may have been Exclusive or Modified
+    l->changeStateTo( MESI_SHARED );
+    numFetchL1IMisses++;
+  }
+
+  /** Whether any core's L1I holds the given line. */
+  bool instructionCopyExists( Addr_t addr ) const {
+    for ( cache_iter_t c = allCaches->begin(); c != allCaches->end(); c++ ) {
+      if ( NULL != (*c)->L1Icache && NULL != (*c)->L1Icache->lineFor( addr ) ) return true;
+    }
+    return false;
+  }
+
+  /** Invalidate this core's L1I copy of the given line, and every copy of it
+   * in from and the caches above it. With fetch modeling, a core can hold a
+   * line in its L1I and a data cache at once, and an L1I eviction can leave a
+   * second copy in the L2, so a write has to find them all.
+   * @param from NULL to only invalidate the L1I copy
+   * @return whether there were any copies */
+  bool invalidateCopies( Addr_t addr, HierarchicalCache<State>* from ) {
+    if ( NULL == L1Icache ) return false;
+    bool found = false;
+    State* l = L1Icache->lineFor( addr );
+    if ( NULL != l ) {
+      l->invalidate();
+      found = true;
+    }
+    while ( NULL != from && MISSED_TO_MEMORY != from->search( addr, l ) ) {
+      l->invalidate();
+      found = true;
+    }
+    return found;
+  }
+
   /** Perform a data read specified by the given `access'. */
   virtual void read( const DataAccess& access ) {
 
@@ -235,6 +444,7 @@ public:
     if ( r != MISSED_TO_MEMORY ) {
       // we hit somewhere in our private cache(s), or a shared cache
       numReadHits++;
+      if ( sharingTracker ) sharingTracker->access( CPUId, access, false, false );
       switch ( r ) {
       case L1_HIT:
         timeInMemoryHierarchy += L1_HIT_LATENCY;
@@ -273,8 +483,12 @@ public:
       numReadMisses++;
       timeInMemoryHierarchy += MEMORY_ACCESS_LATENCY-1;
 
-      /* NB: we always fetch from memory into Exclusive. */
+      /* NB: we always fetch from memory into Exclusive, unless an L1I
+       * shares the line. */
       newMesiState = MESI_EXCLUSIVE;
+      if ( NULL != L1Icache && instructionCopyExists( access.addr() ) ) {
+        newMesiState = MESI_SHARED;
+      }
 
     } else if ( rrs.isShared ) {
       newMesiState = MESI_SHARED;
@@ -292,10 +506,12 @@ public:
     // pull in the actual line
     L1cache->access( access.addr(), line );
     line->changeStateTo( newMesiState );
+    if ( sharingTracker ) sharingTracker->access( CPUId, access, true, false );
 
   } // end read()
 
   virtual RemoteReadService readRemoteAction( const DataAccess& access ) {
+    PROFILE_SCOPE( PROF_SNOOP );
     cache_iter_t cacheIter;
     for ( cacheIter = allCaches->begin(); cacheIter != allCaches->end(); cacheIter++ ) {
       SMPCache<State, Addr_t> *otherCache = *cacheIter;
@@ -314,6 +530,7 @@ public:
       case MESI_EXCLUSIVE:
       case MESI_MODIFIED:
         otherLine->changeStateTo( MESI_SHARED );
+        if ( coherenceTraffic ) coherenceTraffic->transfer( otherCache->CPUId, CPUId );
         return RemoteReadService( false, true );
       case MESI_SHARED:
         // everyone else will be in Shared state as well, so return now
@@ -373,6 +590,8 @@ public:
       case MESI_SHARED: // upgrade miss
         numUpgradeMisses++;
         writeRemoteAction( access ); // invalidate other copies
+        invalidateCopies( access.addr(), L1cache->m_nextCache );
+        if ( sharingTracker ) sharingTracker->access( CPUId, access, false, true );
         timeInMemoryHierarchy += REMOTE_HIT_LATENCY;
 
         myLine->changeStateTo( MESI_MODIFIED );
@@ -384,6 +603,7 @@ public:
       case MESI_EXCLUSIVE: // write hit
       case MESI_MODIFIED:
         numWriteHits++;
+        if ( sharingTracker ) sharingTracker->access( CPUId, access, false, false );
 
         // TODO: fix this duplication from the MESI_SHARED case
         myLine->changeStateTo( MESI_MODIFIED );
@@ -411,9 +631,12 @@ public:
     } else {
       numWriteRemoteHits++;
       timeInMemoryHierarchy += REMOTE_HIT_LATENCY;
+      if ( coherenceTraffic ) coherenceTraffic->transfer( inv_ack.supplier, CPUId );
     }
 
     L1cache->access( access.addr(), myLine );
+    invalidateCopies( access.addr(), L1cache->m_nextCache );
+    if ( sharingTracker ) sharingTracker->access( CPUId, access, true, false );
 
     myLine->changeStateTo( MESI_MODIFIED );
     if ( useDetStoreBuffers && doStoreBufferAccess ) {
@@ -424,9 +647,12 @@ public:
   } // end write()
 
   virtual InvalidateReply writeRemoteAction( const DataAccess& access ) {
+    PROFILE_SCOPE( PROF_SNOOP );
     cache_iter_t cacheIter;
 
     bool noOtherCachesHaveLine = true;
+    unsigned supplier = 0;
+    unsigned invalidatedCopies = 0;
     for ( cacheIter = allCaches->begin(); cacheIter != allCaches->end(); cacheIter++ ) {
       SMPCache<State, Addr_t> *otherCache = *cacheIter;
       if ( otherCache->CPUId == this->CPUId ) {
@@ -436,6 +662,11 @@ public:
       State* otherLine = NULL;
       CacheResponse r = otherCache->L1cache->search( access.addr(), otherLine );
       if ( r == MISSED_TO_MEMORY ) { // not found in this cache
+        // but it may be in the L1I
+        if ( otherCache->invalidateCopies( access.addr(), NULL ) ) {
+          invalidatedCopies++;
+          if ( coherenceTraffic ) coherenceTraffic->invalidation( CPUId, otherCache->CPUId );
+        }
         continue;
       }
 
@@ -443,8 +674,16 @@ public:
       case MESI_MODIFIED:
       case MESI_EXCLUSIVE:
       case MESI_SHARED:
+        // an owner supplies the data; otherwise any sharer will do
+        if ( noOtherCachesHaveLine || otherLine->getState() != MESI_SHARED ) {
+          supplier = otherCache->CPUId;
+        }
         otherLine->invalidate();
+        otherCache->invalidateCopies( access.addr(), otherCache->L1cache );
         noOtherCachesHaveLine = false;
+        invalidatedCopies++;
+        if ( sharingTracker ) sharingTracker->invalidated( access.addr(), otherCache->CPUId );
+        if ( coherenceTraffic ) coherenceTraffic->invalidation( CPUId, otherCache->CPUId );
         // have to keep searching to find all Shared copies
         break;
       case MESI_INVALID:
@@ -455,7 +694,8 @@ public:
       }
     } // done with other caches
 
-    return InvalidateReply( noOtherCachesHaveLine );
+    if ( coherenceTraffic ) coherenceTraffic->snoopingWrite( invalidatedCopies );
+    return InvalidateReply( noOtherCachesHaveLine, supplier );
   } // end writeRemoteAction()
 
 };
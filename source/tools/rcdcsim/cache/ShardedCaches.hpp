@@ -0,0 +1,378 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Set-partitioned parallel simulation of the cache hierarchy, for the nondet
+ * mode. Lines whose set-index bits differ never interact (they live in
+ * different sets at every level, and coherence is per-line), so the address
+ * space is split by the low set-index bits into shards. Each shard has a
+ * worker thread that owns its slice of every core's caches and of the L3, and
+ * the event-processing thread feeds it accesses over a single-producer,
+ * single-consumer queue. Within a shard, accesses are applied in the same
+ * order as in serial mode, so the results are identical.
+ *
+ * The det modes can't be sharded this way. There, the event loop needs the
+ * outcome of every access before it runs the core's next event: a store
+ * buffer overflow ends the core's quantum at that access, and with smart
+ * quantum building the access's deterministic latency counts towards the
+ * quantum. So the workers could never run ahead of the event loop.
+ *
+ * A worker with an empty queue, or a producer with a full queue or waiting
+ * for a shard to drain, spins briefly and then blocks on a condition
+ * variable, so idle threads don't compete with busy ones for host CPUs.
+ */
+
+#ifndef SHARDEDCACHES_HPP_
+#define SHARDEDCACHES_HPP_
+
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "SMPCache.hpp"
+#include "TLB.hpp"
+#include "Counter.hpp"
+
+using namespace std;
+
+/** Bounded queue with one producer thread and one consumer thread. */
+template<class T>
+class SPSCQueue {
+private:
+  vector<T> m_slots;
+  const uint64_t m_mask;
+  // keep the producer's and consumer's indices on different cache lines
+  char m_pad0[64];
+  uint64_t m_head; /** next slot to read; written only by the consumer */
+  char m_pad1[64];
+  uint64_t m_tail; /** next slot to write; written only by the producer */
+  char m_pad2[64];
+
+public:
+  /** @param capacity must be a power of 2 */
+  SPSCQueue( uint64_t capacity ) : m_slots( capacity ), m_mask( capacity - 1 ), m_head( 0 ), m_tail( 0 ) {
+    assert( 0 == (capacity & (capacity - 1)) );
+  }
+
+  bool push( const T& t ) {
+    const uint64_t tail = m_tail;
+    if ( tail - __atomic_load_n( &m_head, __ATOMIC_ACQUIRE ) == m_slots.size() ) {
+      return false; // full
+    }
+    m_slots[tail & m_mask] = t;
+    __atomic_store_n( &m_tail, tail + 1, __ATOMIC_RELEASE );
+    return true;
+  }
+
+  /** Only meaningful to the consumer. */
+  bool empty() const {
+    return m_head == __atomic_load_n( &m_tail, __ATOMIC_ACQUIRE );
+  }
+
+  /** Only meaningful to the producer. */
+  bool full() const {
+    return m_tail - __atomic_load_n( &m_head, __ATOMIC_ACQUIRE ) == m_slots.size();
+  }
+
+  bool pop( T& t ) {
+    const uint64_t head = m_head;
+    if ( head == __atomic_load_n( &m_tail, __ATOMIC_ACQUIRE ) ) {
+      return false; // empty
+    }
+    t = m_slots[head & m_mask];
+    __atomic_store_n( &m_head, head + 1, __ATOMIC_RELEASE );
+    return true;
+  }
+};
+
+enum ShardAccessType { SHARD_READ = 1, SHARD_WRITE, SHARD_FETCH, SHARD_EXIT };
+
+/** An access to a single cache line, routed to the shard that owns the line. */
+struct ShardAccess {
+  uint64_t addr;
+  uint16_t core;
+  uint8_t type;
+  uint8_t size;
+};
+
+template<class Line>
+class ShardedCaches {
+private:
+  typedef SMPCache<Line, uint64_t> cache_t;
+
+  /** how many times a thread re-checks its condition before blocking */
+  static const unsigned SPINS_BEFORE_BLOCKING = 1000;
+
+  struct Shard {
+    ShardedCaches* owner;
+    HierarchicalCache<Line>* l3;
+    LRUCallbacks<Line> l3Callbacks;
+    /** this shard's slice of each core's private caches */
+    vector<cache_t*> caches;
+    /** the Counters of the caches above, which are folded into the real ones by collect() */
+    vector<Counter*> counters;
+    /** the real Counter for each of counters */
+    vector<Counter*> realCounters;
+    SPSCQueue<ShardAccess> queue;
+    pthread_t thread;
+    /** accesses sent to this shard; only touched by the producer */
+    uint64_t sent;
+    /** accesses this shard has finished */
+    uint64_t done;
+
+    pthread_mutex_t lock;
+    /** signalled when the worker may have something to pop */
+    pthread_cond_t workReady;
+    /** signalled when the worker has finished an access */
+    pthread_cond_t workDone;
+    /** set while the worker, or the producer, is blocked (or about to block) */
+    bool workerWaiting;
+    bool producerWaiting;
+
+    Shard() : owner( NULL ), l3( NULL ), queue( 1 << 16 ), sent( 0 ), done( 0 ),
+              workerWaiting( false ), producerWaiting( false ) {
+      pthread_mutex_init( &lock, NULL );
+      pthread_cond_init( &workReady, NULL );
+      pthread_cond_init( &workDone, NULL );
+    }
+
+    ~Shard() {
+      pthread_cond_destroy( &workDone );
+      pthread_cond_destroy( &workReady );
+      pthread_mutex_destroy( &lock );
+    }
+
+    static bool hasWork( Shard* s ) {
+      return !s->queue.empty();
+    }
+    static bool hasRoom( Shard* s ) {
+      return !s->queue.full();
+    }
+    static bool drained( Shard* s ) {
+      return __atomic_load_n( &s->done, __ATOMIC_ACQUIRE ) == s->sent;
+    }
+
+    /** Return once ready(this) holds. Spins for a while, then blocks on cond
+     * until the other thread calls wake() with the same waiting flag. */
+    void waitUntil( bool (*ready)( Shard* ), bool& waiting, pthread_cond_t& cond ) {
+      for ( unsigned i = 0; i < SPINS_BEFORE_BLOCKING; i++ ) {
+        if ( ready( this ) ) return;
+      }
+      pthread_mutex_lock( &lock );
+      __atomic_store_n( &waiting, true, __ATOMIC_RELAXED );
+      // pairs with the fence in wake(): either we see the other thread's
+      // update, or it sees that we're waiting
+      __atomic_thread_fence( __ATOMIC_SEQ_CST );
+      while ( !ready( this ) ) {
+        pthread_cond_wait( &cond, &lock );
+      }
+      __atomic_store_n( &waiting, false, __ATOMIC_RELAXED );
+      pthread_mutex_unlock( &lock );
+    }
+
+    /** Call after an update that might satisfy a waitUntil() on cond. */
+    void wake( bool& waiting, pthread_cond_t& cond ) {
+      __atomic_thread_fence( __ATOMIC_SEQ_CST );
+      if ( __atomic_load_n( &waiting, __ATOMIC_RELAXED ) ) {
+        pthread_mutex_lock( &lock );
+        pthread_cond_signal( &cond );
+        pthread_mutex_unlock( &lock );
+      }
+    }
+  };
+
+  const unsigned NUM_SHARDS;
+  const unsigned NUM_CORES;
+  const unsigned LINE_BITS;
+  unsigned m_shardBits;
+  vector<Shard*> m_shards;
+
+  unsigned shardOf( uint64_t addr ) const {
+    return (addr >> LINE_BITS) & (NUM_SHARDS - 1);
+  }
+
+  /** Drop the shard bits from addr. Shards have 1/NUM_SHARDS as many sets, and
+   * indexing them with the compacted address gives the same set as indexing
+   * the full-size cache with the full address. */
+  uint64_t compact( uint64_t addr ) const {
+    return ( (addr >> (LINE_BITS + m_shardBits)) << LINE_BITS ) | ( addr & ((1ULL << LINE_BITS) - 1) );
+  }
+
+  static unsigned log2( uint64_t n ) {
+    unsigned bits = 0;
+    while ( (1ULL << bits) < n ) bits++;
+    assert( (1ULL << bits) == n );
+    return bits;
+  }
+
+  /** Slice a cache configuration into one shard's worth of sets. */
+  CacheConfiguration<Line> sliced( CacheConfiguration<Line> config ) const {
+    const int numSets = config.cacheSize / (config.blockSize * config.assoc);
+    if ( numSets < (int) NUM_SHARDS ) {
+      cerr << "[rcdcsim] can't shard a cache with " << numSets << " sets " << NUM_SHARDS << " ways" << endl;
+      exit( 1 );
+    }
+    config.cacheSize /= NUM_SHARDS;
+    return config;
+  }
+
+  static void* workerMain( void* v ) {
+    Shard* s = (Shard*) v;
+    ShardAccess a;
+    while ( true ) {
+      if ( !s->queue.pop( a ) ) {
+        s->waitUntil( Shard::hasWork, s->workerWaiting, s->workReady );
+        continue;
+      }
+      cache_t* c = s->caches[a.core];
+      switch ( a.type ) {
+      case SHARD_READ:
+        c->read( DataAccess( READ_ACCESS, a.addr, a.size, 1 << s->owner->LINE_BITS ) );
+        break;
+      case SHARD_WRITE:
+        c->write( DataAccess( WRITE_ACCESS, a.addr, a.size, 1 << s->owner->LINE_BITS ), false );
+        break;
+      case SHARD_FETCH:
+        c->fetchLine( a.addr );
+        break;
+      case SHARD_EXIT:
+        return NULL;
+      default:
+        assert(false);
+      }
+      __atomic_store_n( &s->done, s->done + 1, __ATOMIC_RELEASE );
+      s->wake( s->producerWaiting, s->workDone );
+    }
+  }
+
+  void send( const ShardAccess& a, unsigned shard ) {
+    Shard* s = m_shards[shard];
+    while ( !s->queue.push( a ) ) {
+      s->waitUntil( Shard::hasRoom, s->producerWaiting, s->workDone );
+    }
+    s->sent++;
+    s->wake( s->workerWaiting, s->workReady );
+  }
+
+public:
+
+  ShardedCaches( unsigned numShards, unsigned numCores, CacheConfiguration<Line> l1config,
+                 bool useL2, CacheConfiguration<Line> l2config,
+                 bool useL3, CacheConfiguration<Line> l3config,
+                 bool useL1I, CacheConfiguration<Line> l1iconfig ) :
+    NUM_SHARDS( numShards ), NUM_CORES( numCores ), LINE_BITS( log2(l1config.blockSize) )
+  {
+    m_shardBits = log2( NUM_SHARDS );
+    l1config = sliced( l1config );
+    if ( useL2 ) l2config = sliced( l2config );
+    if ( useL3 ) l3config = sliced( l3config );
+    if ( useL1I ) l1iconfig = sliced( l1iconfig );
+
+    for ( unsigned i = 0; i < NUM_SHARDS; i++ ) {
+      Shard* s = new Shard();
+      s->owner = this;
+      if ( useL3 ) {
+        l3config.callbacks = &s->l3Callbacks;
+        s->l3 = new HierarchicalCache<Line>( l3config, NULL );
+      }
+      Counter::openGroup( &s->counters );
+      for ( unsigned c = 0; c < NUM_CORES; c++ ) {
+        s->caches.push_back( new cache_t( c, NUM_CORES, s->l3, &s->caches, l1config, useL2, l2config ) );
+        if ( useL1I ) s->caches.back()->enableICache( l1iconfig );
+      }
+      Counter::closeGroup();
+      for ( unsigned k = 0; k < s->counters.size(); k++ ) {
+        Counter* shadow = s->counters[k];
+        Counter* real = Counter::find( shadow->cpuid(), shadow->name() );
+        assert( NULL != real );
+        s->realCounters.push_back( real );
+      }
+      m_shards.push_back( s );
+    }
+
+    for ( unsigned i = 0; i < NUM_SHARDS; i++ ) {
+      int err = pthread_create( &m_shards[i]->thread, NULL, workerMain, m_shards[i] );
+      assert( 0 == err );
+    }
+  }
+
+  ~ShardedCaches() {
+    ShardAccess exit;
+    exit.addr = 0;
+    exit.core = 0;
+    exit.type = SHARD_EXIT;
+    exit.size = 0;
+    for ( unsigned i = 0; i < NUM_SHARDS; i++ ) {
+      send( exit, i );
+    }
+    for ( unsigned i = 0; i < NUM_SHARDS; i++ ) {
+      Shard* s = m_shards[i];
+      pthread_join( s->thread, NULL );
+      for ( unsigned c = 0; c < s->caches.size(); c++ ) {
+        delete s->caches[c];
+      }
+      delete s->l3;
+      delete s;
+    }
+  }
+
+  /** Send a data access, which must lie within one line, to its shard. */
+  void access( unsigned core, bool write, uint64_t addr, unsigned size ) {
+    ShardAccess a;
+    a.addr = compact( addr );
+    a.core = core;
+    a.type = write ? SHARD_WRITE : SHARD_READ;
+    a.size = size;
+    send( a, shardOf(addr) );
+  }
+
+  /** Send an instruction fetch of the line at the given address to its shard. */
+  void fetchLine( unsigned core, uint64_t line ) {
+    ShardAccess a;
+    a.addr = compact( line );
+    a.core = core;
+    a.type = SHARD_FETCH;
+    a.size = 0;
+    send( a, shardOf(line) );
+  }
+
+  /** Wait for all shards to finish their queued accesses, then fold their
+   * per-core time and counters into the given (unsharded) caches. */
+  void collect( vector<cache_t*>& mainCaches ) {
+    for ( unsigned i = 0; i < NUM_SHARDS; i++ ) {
+      Shard* s = m_shards[i];
+      s->waitUntil( Shard::drained, s->producerWaiting, s->workDone );
+      for ( unsigned c = 0; c < NUM_CORES; c++ ) {
+        mainCaches.at( c )->timeInMemoryHierarchy += s->caches[c]->timeInMemoryHierarchy;
+        s->caches[c]->timeInMemoryHierarchy = 0;
+      }
+      for ( unsigned k = 0; k < s->counters.size(); k++ ) {
+        s->realCounters[k]->add( s->counters[k]->get() );
+        s->counters[k]->set( 0 );
+      }
+    }
+  }
+
+};
+
+#endif /* SHARDEDCACHES_HPP_ */
@@ -0,0 +1,230 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Classifies coherence misses as true or false sharing, following Dubois et
+ * al. (ISCA'93): a core that lost a line to another core's write and fetches
+ * it again has a true sharing miss iff, before losing the line again, it
+ * touches some byte that was written while it was away. Otherwise it only
+ * missed because it shares the line with unrelated data.
+ *
+ * Upgrade misses are classified when they happen: they are true sharing iff
+ * some core whose copy gets invalidated had touched the bytes being written.
+ *
+ * Only lines that have been involved in an invalidation are tracked, so
+ * private data costs one hash lookup per access. Byte masks are kept per line
+ * and per core; lines bigger than 64 bytes are tracked in 64 equal pieces.
+ */
+
+#ifndef SHARINGTRACKER_HPP_
+#define SHARINGTRACKER_HPP_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include <assert.h>
+
+#include "FlatHashMap.hpp"
+#include "cachesim.hpp"
+
+using namespace std;
+
+class SharingTracker {
+private:
+  struct LineSharing {
+    uint64_t line;
+    /** cores whose copy was invalidated, and that haven't fetched it again */
+    uint64_t lost;
+    /** cores that fetched the line after losing it, and haven't lost it again */
+    uint64_t pending;
+    /** cores whose TOUCHED mask covers everything since they last fetched the line */
+    uint64_t known;
+    uint64_t trueMisses;
+    uint64_t falseMisses;
+  };
+
+  /** per-core masks, stored MASKS_PER_CORE to a core for each tracked line */
+  enum { MISSED, FETCHED, TOUCHED, MASKS_PER_CORE };
+
+  const unsigned m_numCores;
+  const unsigned m_lineBits;
+  /** log2 of the bytes covered by each mask bit */
+  const unsigned m_granuleBits;
+
+  vector<LineSharing> m_lines;
+  vector<uint64_t> m_masks;
+  /** 1 + index into m_lines */
+  FlatHashMap<uint32_t> m_index;
+
+  /** what the cores invalidated by the current access had touched */
+  uint64_t m_victimTouches;
+  bool m_victimsKnown;
+
+  uint64_t m_trueMisses;
+  uint64_t m_falseMisses;
+  uint64_t m_unclassifiedUpgrades;
+
+  static const unsigned TOP_LINES = 20;
+
+  uint64_t& mask( uint32_t index, unsigned core, unsigned which ) {
+    return m_masks[ (uint64_t(index) * m_numCores + core) * MASKS_PER_CORE + which ];
+  }
+
+  uint64_t bytesOf( const DataAccess& access ) const {
+    const unsigned first = access.lineOffset() >> m_granuleBits;
+    const unsigned last = (access.lineOffset() + access.size() - 1) >> m_granuleBits;
+    const unsigned n = last - first + 1;
+    return ( 64 == n ? ~uint64_t(0) : ((uint64_t(1) << n) - 1) ) << first;
+  }
+
+  void count( LineSharing& l, bool trueSharing ) {
+    if ( trueSharing ) {
+      l.trueMisses++;
+      m_trueMisses++;
+    } else {
+      l.falseMisses++;
+      m_falseMisses++;
+    }
+  }
+
+  /** the core's copy is gone: was its coherence miss worth it? */
+  void endLifetime( uint32_t index, unsigned core ) {
+    LineSharing& l = m_lines[index];
+    const uint64_t bit = uint64_t(1) << core;
+    if ( !(l.pending & bit) ) return;
+    l.pending &= ~bit;
+    count( l, 0 != (mask( index, core, TOUCHED ) & mask( index, core, FETCHED )) );
+  }
+
+  static bool moreFalseSharing( const LineSharing& a, const LineSharing& b ) {
+    return a.falseMisses > b.falseMisses;
+  }
+
+public:
+  SharingTracker( unsigned numCores, unsigned lineSize ) :
+    m_numCores( numCores ), m_lineBits( __builtin_ctz( lineSize ) ),
+    m_granuleBits( lineSize > 64 ? __builtin_ctz( lineSize / 64 ) : 0 ),
+    m_victimTouches( 0 ), m_victimsKnown( false ),
+    m_trueMisses( 0 ), m_falseMisses( 0 ), m_unclassifiedUpgrades( 0 ) {
+    assert( numCores <= 64 );
+  }
+
+  uint64_t trueSharingMisses() const {
+    return m_trueMisses;
+  }
+
+  uint64_t falseSharingMisses() const {
+    return m_falseMisses;
+  }
+
+  /** The given core's copy of the line holding addr was just invalidated by
+   * another core's write. Must be followed by that write's access(). */
+  void invalidated( uint64_t addr, unsigned core ) {
+    bool inserted;
+    uint32_t& slot = m_index.findOrInsert( addr >> m_lineBits, inserted );
+    if ( inserted ) {
+      slot = m_lines.size() + 1;
+      LineSharing l = LineSharing();
+      l.line = addr >> m_lineBits << m_lineBits;
+      m_lines.push_back( l );
+      m_masks.resize( m_masks.size() + m_numCores * MASKS_PER_CORE, 0 );
+    }
+    const uint32_t index = slot - 1;
+    LineSharing& l = m_lines[index];
+    const uint64_t bit = uint64_t(1) << core;
+
+    endLifetime( index, core );
+    if ( l.known & bit ) {
+      m_victimTouches |= mask( index, core, TOUCHED );
+      m_victimsKnown = true;
+    }
+    l.known &= ~bit;
+    l.lost |= bit;
+    mask( index, core, MISSED ) = 0;
+  }
+
+  /** Called after every data access.
+   * @param fetched whether the access brought the line into the core's cache
+   * @param upgrade whether the access was an upgrade miss */
+  void access( unsigned core, const DataAccess& access, bool fetched, bool upgrade ) {
+    const uint32_t* slot = m_index.find( access.addr() >> m_lineBits );
+    if ( NULL != slot ) {
+      const uint32_t index = *slot - 1;
+      LineSharing& l = m_lines[index];
+      const uint64_t bit = uint64_t(1) << core;
+      const uint64_t bytes = bytesOf( access );
+
+      if ( upgrade ) {
+        if ( m_victimsKnown ) {
+          count( l, 0 != (m_victimTouches & bytes) );
+        } else {
+          m_unclassifiedUpgrades++;
+        }
+      }
+      if ( fetched ) {
+        if ( l.lost & bit ) {
+          // a coherence miss; classified when this copy is lost again
+          mask( index, core, FETCHED ) = mask( index, core, MISSED );
+          l.lost &= ~bit;
+          l.pending |= bit;
+        }
+        mask( index, core, TOUCHED ) = 0;
+        l.known |= bit;
+      }
+      mask( index, core, TOUCHED ) |= bytes;
+      if ( access.write() ) {
+        // everyone who lost the line will have to see this write
+        for ( uint64_t lost = l.lost & ~bit; lost != 0; lost &= lost - 1 ) {
+          mask( index, __builtin_ctzll( lost ), MISSED ) |= bytes;
+        }
+      }
+    }
+    m_victimTouches = 0;
+    m_victimsKnown = false;
+  }
+
+  /** Classifies the coherence misses whose copies are still live, then dumps
+   * the totals and the lines with the most false sharing misses. */
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) {
+    for ( uint32_t i = 0; i < m_lines.size(); i++ ) {
+      for ( unsigned c = 0; c < m_numCores; c++ ) {
+        endLifetime( i, c );
+      }
+    }
+    os << prefix << "'TrueSharingMisses': " << m_trueMisses << suffix;
+    os << prefix << "'FalseSharingMisses': " << m_falseMisses << suffix;
+    os << prefix << "'UnclassifiedUpgradeMisses': " << m_unclassifiedUpgrades << suffix;
+    os << prefix << "'SharedLinesTracked': " << m_lines.size() << suffix;
+
+    vector<LineSharing> top( m_lines );
+    const unsigned n = top.size() < TOP_LINES ? top.size() : TOP_LINES;
+    partial_sort( top.begin(), top.begin() + n, top.end(), moreFalseSharing );
+    for ( unsigned i = 0; i < n && top[i].falseMisses > 0; i++ ) {
+      os << prefix << "'falseSharingLine': " << top[i].line << ", 'falseSharingMisses': " << top[i].falseMisses
+         << ", 'trueSharingMisses': " << top[i].trueMisses << suffix;
+    }
+  }
+};
+
+#endif /* SHARINGTRACKER_HPP_ */
@@ -0,0 +1,264 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Miss-ratio curves for every cache size from a single pass, via LRU stack
+ * distances. A line's stack distance is the number of distinct lines touched
+ * since its previous access: in a fully-associative LRU cache of C lines it
+ * hits iff its distance is less than C.
+ *
+ * Distances are computed SHARDS-style (Waldspurger et al., FAST'15): only lines
+ * whose hash falls under a threshold are tracked, so a sample rate R tracks
+ * about R of the footprint, and each measured distance is scaled up by 1/R.
+ * Each tracked line remembers the time of its last access, and a Fenwick tree
+ * over those times counts the distinct lines accessed since, in O(log n).
+ *
+ * Set-associative caches are estimated from the fully-associative distances
+ * with the usual binomial model (Smith '78): with S sets, each of the d lines
+ * in between lands in the same set with probability 1/S, and the access hits
+ * iff fewer than A of them do.
+ */
+
+#ifndef STACKDISTANCE_HPP_
+#define STACKDISTANCE_HPP_
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <stdint.h>
+#include <assert.h>
+
+#include "FlatHashMap.hpp"
+
+using namespace std;
+
+class StackDistance {
+private:
+  /** sample a line iff the low SAMPLE_BITS of its hash are below this */
+  uint64_t m_threshold;
+  double m_rate;
+  static const unsigned SAMPLE_BITS = 24;
+
+  /** last access time of every tracked line; times start at 1 */
+  FlatHashMap<uint64_t> m_lastAccess;
+  /** Fenwick tree over times: 1 at a time iff it is some line's last access */
+  vector<uint32_t> m_tree;
+  /** which line was accessed at each time, for compaction */
+  vector<uint64_t> m_lineAt;
+  vector<bool> m_live;
+  uint64_t m_time;
+
+  /** distance histogram: exact below 16, then 8 buckets per power of 2 */
+  vector<uint64_t> m_buckets;
+  uint64_t m_coldMisses;
+  uint64_t m_sampledAccesses;
+  uint64_t m_accesses;
+
+  static const uint64_t INITIAL_CAPACITY = 1 << 16;
+
+  /** murmur3's finalizer, so sampling is independent of FlatHashMap's hash */
+  static uint64_t mix( uint64_t k ) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+
+  void add( uint64_t t, int delta ) {
+    for ( ; t < m_tree.size(); t += t & (~t + 1) ) {
+      m_tree[t] += delta;
+    }
+  }
+
+  /** number of live times in [1, t] */
+  uint64_t prefix( uint64_t t ) const {
+    uint64_t sum = 0;
+    for ( ; t > 0; t -= t & (~t + 1) ) {
+      sum += m_tree[t];
+    }
+    return sum;
+  }
+
+  /** Renumber the live times 1..n, in order, growing if they fill more than
+   * half of the tree. */
+  void compact() {
+    uint64_t n = 0;
+    for ( uint64_t t = 1; t <= m_time; t++ ) {
+      if ( !m_live[t] ) continue;
+      n++;
+      m_lineAt[n] = m_lineAt[t];
+      *m_lastAccess.find( m_lineAt[n] ) = n;
+    }
+    uint64_t capacity = m_tree.size() - 1;
+    while ( 2 * n > capacity ) capacity *= 2;
+    m_tree.assign( capacity + 1, 0 );
+    m_lineAt.resize( capacity + 1 );
+    m_live.assign( capacity + 1, false );
+    // linear-time Fenwick construction: every node passes its sum to its parent
+    for ( uint64_t t = 1; t <= capacity; t++ ) {
+      if ( t <= n ) {
+        m_live[t] = true;
+        m_tree[t]++;
+      }
+      const uint64_t parent = t + (t & (~t + 1));
+      if ( parent <= capacity ) m_tree[parent] += m_tree[t];
+    }
+    m_time = n;
+  }
+
+public:
+  static unsigned bucketOf( uint64_t d ) {
+    if ( d < 16 ) return d;
+    unsigned log = 63 - __builtin_clzll( d );
+    return 16 + (log - 4) * 8 + ( (d >> (log - 3)) & 7 );
+  }
+
+  /** smallest distance in the given bucket */
+  static uint64_t lowerBound( unsigned b ) {
+    if ( b < 16 ) return b;
+    const unsigned log = (b - 16) / 8 + 4;
+    return (uint64_t(8 + (b - 16) % 8)) << (log - 3);
+  }
+
+  /** @param rate fraction of lines to track, in (0, 1] */
+  StackDistance( double rate ) :
+    m_threshold( uint64_t( rate * (1 << SAMPLE_BITS) ) ), m_rate( rate ), m_time( 0 ),
+    m_coldMisses( 0 ), m_sampledAccesses( 0 ), m_accesses( 0 ) {
+    assert( rate > 0 && rate <= 1 );
+    m_tree.assign( INITIAL_CAPACITY + 1, 0 );
+    m_lineAt.resize( INITIAL_CAPACITY + 1 );
+    m_live.assign( INITIAL_CAPACITY + 1, false );
+  }
+
+  /** @param line the address of the accessed line, divided by the line size */
+  void access( uint64_t line ) {
+    m_accesses++;
+    if ( (mix( line ) & ((1 << SAMPLE_BITS) - 1)) >= m_threshold ) return;
+    m_sampledAccesses++;
+
+    if ( m_time + 1 >= m_tree.size() ) compact();
+    const uint64_t now = ++m_time;
+
+    bool inserted;
+    uint64_t& last = m_lastAccess.findOrInsert( line, inserted );
+    if ( inserted ) {
+      m_coldMisses++;
+    } else {
+      const uint64_t distance = prefix( now - 1 ) - prefix( last );
+      const unsigned b = bucketOf( uint64_t( distance / m_rate ) );
+      if ( b >= m_buckets.size() ) m_buckets.resize( b + 1, 0 );
+      m_buckets[b]++;
+      add( last, -1 );
+      m_live[last] = false;
+    }
+    last = now;
+    add( now, 1 );
+    m_live[now] = true;
+    m_lineAt[now] = line;
+  }
+
+  uint64_t accesses() const {
+    return m_accesses;
+  }
+
+  /** Estimated miss ratio of an LRU cache. Cold misses count as misses.
+   * @param lines capacity of the cache, in lines
+   * @param assoc associativity, or 0 for fully-associative */
+  double missRatio( uint64_t lines, unsigned assoc ) const {
+    if ( 0 == m_sampledAccesses ) return 0;
+    double misses = m_coldMisses;
+    const uint64_t sets = 0 == assoc ? 1 : max( uint64_t(1), lines / assoc );
+    const unsigned ways = 0 == assoc ? lines : assoc;
+    for ( unsigned b = 0; b < m_buckets.size(); b++ ) {
+      if ( 0 == m_buckets[b] ) continue;
+      // within a bucket, assume distances are spread evenly
+      const double d = b < 16 ? b : lowerBound( b ) * 1.0625;
+      misses += m_buckets[b] * conflictProbability( d, sets, ways );
+    }
+    return misses / m_sampledAccesses;
+  }
+
+  /** Probability that at least ways of the d lines in between map to the same
+   * set, out of sets sets. */
+  static double conflictProbability( double d, uint64_t sets, unsigned ways ) {
+    if ( 1 == sets ) return d >= ways ? 1 : 0;
+    const double p = 1.0 / sets;
+    // P(X < ways) for X ~ Binomial(d, p), summed term by term
+    double term = exp( d * log1p( -p ) );
+    double hit = 0;
+    for ( unsigned k = 0; k < ways && k <= d; k++ ) {
+      hit += term;
+      term *= (d - k) / (k + 1) * p / (1 - p);
+    }
+    return max( 0.0, 1 - hit );
+  }
+};
+
+/** Stack distances for each core's accesses and for all of them together */
+class MissRatioCurves {
+private:
+  vector<StackDistance*> m_cores;
+  StackDistance m_global;
+  const unsigned m_lineBits;
+  const unsigned m_assoc;
+  const uint64_t m_maxSize;
+
+public:
+  MissRatioCurves( unsigned numCores, unsigned lineSize, double rate, unsigned assoc, uint64_t maxSize ) :
+    m_global( rate ), m_lineBits( __builtin_ctz( lineSize ) ), m_assoc( assoc ), m_maxSize( maxSize ) {
+    for ( unsigned c = 0; c < numCores; c++ ) {
+      m_cores.push_back( new StackDistance( rate ) );
+    }
+  }
+
+  ~MissRatioCurves() {
+    for ( unsigned c = 0; c < m_cores.size(); c++ ) {
+      delete m_cores[c];
+    }
+  }
+
+  void access( unsigned cpuid, uint64_t addr ) {
+    m_cores[cpuid]->access( addr >> m_lineBits );
+    m_global.access( addr >> m_lineBits );
+  }
+
+  /** One line per (curve, cache size), for power-of-2 sizes from one set up to
+   * the maximum size. The global curve (MRCCore -1) is for one cache shared by
+   * all cores. */
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    const uint64_t lineSize = uint64_t(1) << m_lineBits;
+    for ( int c = -1; c < int( m_cores.size() ); c++ ) {
+      const StackDistance& sd = c < 0 ? m_global : *m_cores[c];
+      if ( 0 == sd.accesses() ) continue;
+      for ( uint64_t size = lineSize * max( 1u, m_assoc ); size <= m_maxSize; size *= 2 ) {
+        os << prefix << "'MRCCore': " << c << ", 'MRCAssoc': " << m_assoc
+           << ", 'MRCCacheSize': " << size
+           << ", 'MRCMissRatio': " << sd.missRatio( size / lineSize, m_assoc ) << suffix;
+      }
+    }
+  }
+};
+
+#endif /* STACKDISTANCE_HPP_ */
@@ -0,0 +1,77 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Names code addresses with the symbol file the front-end writes as images
+ * load (its -symbol-file knob): one "start size name" line per routine, start
+ * in hex.
+ */
+
+#ifndef SYMBOLTABLE_HPP_
+#define SYMBOLTABLE_HPP_
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+class SymbolTable {
+  struct Symbol {
+    uint64_t size;
+    string name;
+  };
+  /** routines, by start address */
+  map<uint64_t, Symbol> m_symbols;
+
+public:
+  /** @return whether the symbol file could be read */
+  bool load( const string& filename ) {
+    ifstream in( filename.c_str() );
+    if ( !in.good() ) return false;
+    string line;
+    while ( getline( in, line ) ) {
+      stringstream ss( line );
+      uint64_t start;
+      Symbol s;
+      if ( ss >> hex >> start >> dec >> s.size >> ws && getline( ss, s.name ) ) {
+        m_symbols[start] = s;
+      }
+    }
+    return true;
+  }
+
+  /** "routine+0xoffset", or "" if no routine contains pc */
+  string symbolOf( uint64_t pc ) const {
+    map<uint64_t, Symbol>::const_iterator it = m_symbols.upper_bound( pc );
+    if ( it == m_symbols.begin() ) return "";
+    it--;
+    if ( pc - it->first >= it->second.size ) return "";
+    stringstream ss;
+    ss << it->second.name << "+0x" << hex << pc - it->first;
+    return ss.str();
+  }
+};
+
+#endif /* SYMBOLTABLE_HPP_ */
@@ -0,0 +1,198 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Per-core data TLBs and page-walk cache. As in Pin's Memory/allcache.cpp, a
+ * TLB is just a cache whose block size is the page size, so we build the TLBs
+ * out of HierarchicalCache. The page tables are x86-64 style radix trees; the
+ * page-table entries that a walk has to fetch are handed back to the caller so
+ * they can be read through the data cache hierarchy.
+ */
+
+#ifndef TLB_HPP_
+#define TLB_HPP_
+
+#include <vector>
+#include <list>
+#include <limits>
+#include <stdint.h>
+#include <assert.h>
+
+#include "HierarchicalCache.hpp"
+
+using namespace std;
+
+template<class Line>
+class LRUCallbacks : public CacheCallbacks<Line> {
+public:
+  virtual Line* eviction(const list<Line*>& set, int level) {
+    return set.back();
+  }
+};
+
+class TLBConfiguration {
+public:
+  unsigned l1Entries;
+  unsigned l1Assoc;
+  unsigned l1HugeEntries;
+  unsigned l1HugeAssoc;
+  unsigned l2Entries;
+  unsigned l2HugeEntries;
+  unsigned l2Assoc;
+  /** page-walk cache entries (fully associative) */
+  unsigned pwcEntries;
+};
+
+enum TLBResponse { TLB_L1_HIT = 1, TLB_L2_HIT, TLB_MISS };
+
+/** Which memory is backed by 2MB pages */
+enum HugePagePolicy {
+  HUGE_PAGES_NONE = 1,
+  HUGE_PAGES_ALL,
+  /** 2MB-aligned chunks of allocations of at least 2MB, like transparent huge pages */
+  HUGE_PAGES_LARGE_ALLOCS
+};
+
+class DataTLB {
+public:
+
+  static const unsigned SMALL_PAGE_BITS = 12; // 4KB
+  static const unsigned HUGE_PAGE_BITS = 21; // 2MB
+  static const unsigned PAGE_TABLE_LEVELS = 4;
+  static const unsigned PTE_SIZE = 8;
+
+  /** Page tables live in the (non-canonical for user code) upper half of the
+   * address space, so they never alias application data. Each level is laid
+   * out linearly, so neighboring pages' PTEs share cache lines. */
+  static const uint64_t PAGE_TABLE_BASE = 0xFFFF800000000000ULL;
+
+private:
+  LRUCallbacks<VILine> m_lru;
+
+  HierarchicalCache<VILine>* m_l1;
+  HierarchicalCache<VILine>* m_l2;
+  HierarchicalCache<VILine>* m_l1Huge;
+  HierarchicalCache<VILine>* m_l2Huge;
+  /** caches upper-level (non-leaf) page table entries */
+  HierarchicalCache<VILine>* m_pwc;
+
+  static unsigned levelShift( unsigned level ) {
+    // level 1 entries map 4KB pages, level 2 map 2MB, level 3 map 1GB, level 4 map 512GB
+    return SMALL_PAGE_BITS + 9 * (level - 1);
+  }
+
+  static HierarchicalCache<VILine>* makeCache( unsigned entries, unsigned assoc,
+                                               unsigned pageBits, CacheCallbacks<VILine>* cb,
+                                               HierarchicalCache<VILine>* next ) {
+    CacheConfiguration<VILine> config;
+    // CacheConfiguration sizes are ints
+    assert( (uint64_t(entries) << pageBits) <= uint64_t(numeric_limits<int>::max()) );
+    config.blockSize = 1 << pageBits;
+    config.cacheSize = entries * config.blockSize;
+    config.assoc = assoc;
+    config.callbacks = cb;
+    return new HierarchicalCache<VILine>( config, next );
+  }
+
+  /** Address used to key the page-walk cache on the entry for vaddr at the given level. */
+  static uint64_t pwcKey( uint64_t vaddr, unsigned level ) {
+    return ( (uint64_t(level) << 56) | (vaddr >> levelShift(level)) ) * PTE_SIZE;
+  }
+
+public:
+
+  DataTLB( const TLBConfiguration& config ) {
+    m_l2 = makeCache( config.l2Entries, config.l2Assoc, SMALL_PAGE_BITS, &m_lru, NULL );
+    m_l1 = makeCache( config.l1Entries, config.l1Assoc, SMALL_PAGE_BITS, &m_lru, m_l2 );
+    m_l2Huge = makeCache( config.l2HugeEntries, config.l2Assoc, HUGE_PAGE_BITS, &m_lru, NULL );
+    m_l1Huge = makeCache( config.l1HugeEntries, config.l1HugeAssoc, HUGE_PAGE_BITS, &m_lru, m_l2Huge );
+
+    CacheConfiguration<VILine> pwcConfig;
+    pwcConfig.blockSize = PTE_SIZE;
+    pwcConfig.assoc = config.pwcEntries;
+    pwcConfig.cacheSize = config.pwcEntries * PTE_SIZE;
+    pwcConfig.callbacks = &m_lru;
+    m_pwc = new HierarchicalCache<VILine>( pwcConfig, NULL );
+  }
+
+  ~DataTLB() {
+    delete m_l1;
+    delete m_l2;
+    delete m_l1Huge;
+    delete m_l2Huge;
+    delete m_pwc;
+  }
+
+  /** Address of the page-table entry that maps vaddr at the given level. */
+  static uint64_t pteAddress( uint64_t vaddr, unsigned level ) {
+    assert( level >= 1 && level <= PAGE_TABLE_LEVELS );
+    // give each level its own 2^44-byte region
+    return PAGE_TABLE_BASE + (uint64_t(level) << 44) + (vaddr >> levelShift(level)) * PTE_SIZE;
+  }
+
+  /** Look up the translation for vaddr, filling it into the L1 TLB on an L2 hit.
+   * On a miss nothing is filled; the caller should walk() the page table. */
+  TLBResponse lookup( uint64_t vaddr, bool hugePage ) {
+    HierarchicalCache<VILine>* l1 = hugePage ? m_l1Huge : m_l1;
+    VILine* ignore = NULL;
+    if ( l1->search( vaddr, ignore ) == MISSED_TO_MEMORY ) {
+      return TLB_MISS;
+    }
+    // update LRU and move L2 hits into the L1
+    return (TLBResponse) l1->access( vaddr, ignore );
+  }
+
+  /** Walk the page table for vaddr and fill the translation into the TLBs.
+   * @param ptes output parameter: the page-table entries that missed in the page-walk
+   * cache and have to be fetched from the memory hierarchy, from the root down
+   * @return the number of levels whose entries were found in the page-walk cache */
+  unsigned walk( uint64_t vaddr, bool hugePage, vector<uint64_t>& ptes ) {
+    const unsigned leaf = hugePage ? 2 : 1;
+    VILine* ignore = NULL;
+
+    // find the lowest non-leaf level that the page-walk cache can give us
+    unsigned start = PAGE_TABLE_LEVELS;
+    for ( unsigned level = leaf + 1; level <= PAGE_TABLE_LEVELS; level++ ) {
+      if ( m_pwc->search( pwcKey(vaddr, level), ignore ) != MISSED_TO_MEMORY ) {
+        m_pwc->access( pwcKey(vaddr, level), ignore );
+        start = level - 1;
+        break;
+      }
+    }
+
+    ptes.clear();
+    for ( unsigned level = start; level >= leaf; level-- ) {
+      ptes.push_back( pteAddress(vaddr, level) );
+      if ( level > leaf ) {
+        m_pwc->access( pwcKey(vaddr, level), ignore );
+      }
+    }
+
+    // install the translation
+    (hugePage ? m_l1Huge : m_l1)->access( vaddr, ignore );
+
+    return PAGE_TABLE_LEVELS - start;
+  }
+
+};
+
+#endif /* TLB_HPP_ */
@@ -0,0 +1,393 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Maps application threads onto simulated cores. When there are more threads
+ * than cores, threads assigned to the same core are time-multiplexed: a core
+ * runs one thread at a time, and switches to another of its threads only when
+ * the current one blocks, finishes, or uses up its time slice. Events from
+ * threads that aren't currently running are deferred by the event loop.
+ *
+ * When a thread must give up its core (slice expiry, preemption, blocking)
+ * depends only on simulated quantities: insns executed, blocking and
+ * causality waits. Which waiting thread gets a freed core does not: threads
+ * are dispatched by tryDispatch() as the event loop reaches their events, so
+ * with more threads than cores the placement, and hence the det schemes'
+ * results, can depend on how the front-end interleaves the event stream.
+ */
+
+#ifndef THREADSCHEDULER_HPP_
+#define THREADSCHEDULER_HPP_
+
+#include <vector>
+#include <map>
+#include <string>
+#include <ostream>
+#include <limits>
+#include <stdint.h>
+#include <assert.h>
+
+#include "Counter.hpp"
+
+using namespace std;
+
+enum SchedulingPolicy {
+  SCHED_AFFINITY = 1, /** threads are pinned to a core and never migrate */
+  SCHED_ROUND_ROBIN, /** global round-robin: a thread may run on whichever core frees up next */
+  SCHED_LOAD_BALANCE /** per-core run queues, with migration from overloaded to idle cores */
+};
+
+class ThreadScheduler {
+public:
+
+  static const unsigned NO_THREAD = static_cast<unsigned>(-1);
+  static const unsigned NO_CORE = static_cast<unsigned>(-1);
+
+  SchedulingPolicy m_policy;
+  /** insns a thread may run before it can be switched out */
+  uint64_t m_timeSlice;
+  /** cycles charged to a core each time it switches between threads */
+  uint64_t m_contextSwitchCycles;
+
+private:
+  const unsigned NUM_CORES;
+
+  struct ThreadState {
+    bool known;
+    bool live;
+    bool blocked;
+    unsigned core;
+    uint64_t insns;
+    uint64_t sliceInsns;
+    uint64_t switchesIn;
+    uint64_t migrations;
+
+    ThreadState() :
+      known( false ), live( false ), blocked( false ), core( 0 ), insns( 0 ),
+      sliceInsns( 0 ), switchesIn( 0 ), migrations( 0 ) {}
+  };
+
+  struct CoreState {
+    /** the thread that last ran on this core */
+    unsigned current;
+    /** number of live, unblocked threads assigned to this core */
+    unsigned runnable;
+    /** set when the current thread should give up the core at the next opportunity */
+    bool preempted;
+
+    CoreState() : current( NO_THREAD ), runnable( 0 ), preempted( false ) {}
+  };
+
+  vector<ThreadState> m_threads;
+  vector<CoreState> m_cores;
+  /** explicit thread=>core pinning, used by SCHED_AFFINITY */
+  map<unsigned, unsigned> m_affinity;
+  /** next core to hand out under SCHED_ROUND_ROBIN */
+  unsigned m_rrCursor;
+
+  /** bumped whenever a core might have become available to a different thread */
+  uint64_t m_generation;
+
+  /** Never deleted: a Counter registers itself in a process-wide list that
+   * Counter::dumpCounters() and Counter::allCounters() walk. */
+  vector<Counter*> m_contextSwitches;
+  vector<Counter*> m_threadMigrations;
+
+  ThreadState& stateOf( unsigned tid ) {
+    if ( tid >= m_threads.size() ) {
+      m_threads.resize( tid + 1 );
+    }
+    return m_threads[tid];
+  }
+
+  bool known( unsigned tid ) const {
+    return tid < m_threads.size() && m_threads[tid].known;
+  }
+
+  bool sliceExpired( unsigned tid ) const {
+    return m_threads[tid].sliceInsns >= m_timeSlice;
+  }
+
+  /** Whether the given core can start running a different thread right now. */
+  bool coreAvailable( unsigned core ) const {
+    const CoreState& c = m_cores[core];
+    if ( NO_THREAD == c.current ) return true;
+    const ThreadState& cur = m_threads[c.current];
+    return !cur.live || cur.blocked || c.preempted || sliceExpired( c.current );
+  }
+
+  unsigned leastLoadedCore() const {
+    unsigned best = 0;
+    for ( unsigned i = 1; i < NUM_CORES; i++ ) {
+      if ( m_cores[i].runnable < m_cores[best].runnable ) best = i;
+    }
+    return best;
+  }
+
+  unsigned placeNewThread( unsigned tid ) {
+    switch ( m_policy ) {
+    case SCHED_AFFINITY: {
+      map<unsigned, unsigned>::const_iterator it = m_affinity.find( tid );
+      if ( it != m_affinity.end() ) return it->second;
+      return tid % NUM_CORES;
+    }
+    case SCHED_ROUND_ROBIN:
+      return m_rrCursor++ % NUM_CORES;
+    case SCHED_LOAD_BALANCE:
+      return leastLoadedCore();
+    default:
+      assert(false);
+      return 0;
+    }
+  }
+
+  /** Find a core other than home that could run tid right now. */
+  template<class StalledCores>
+  unsigned findMigrationTarget( unsigned home, const StalledCores& stalledCores ) {
+    switch ( m_policy ) {
+    case SCHED_AFFINITY:
+      return NO_CORE;
+
+    case SCHED_ROUND_ROBIN:
+      for ( unsigned i = 0; i < NUM_CORES; i++ ) {
+        unsigned core = (m_rrCursor + i) % NUM_CORES;
+        if ( core != home && !stalledCores[core] && coreAvailable( core ) ) {
+          m_rrCursor = core + 1;
+          return core;
+        }
+      }
+      return NO_CORE;
+
+    case SCHED_LOAD_BALANCE: {
+      unsigned target = NO_CORE;
+      for ( unsigned core = 0; core < NUM_CORES; core++ ) {
+        if ( core == home || stalledCores[core] || !coreAvailable( core ) ) continue;
+        if ( NO_CORE == target || m_cores[core].runnable < m_cores[target].runnable ) {
+          target = core;
+        }
+      }
+      // only migrate if it actually evens out the load
+      if ( NO_CORE != target && m_cores[target].runnable + 1 < m_cores[home].runnable ) {
+        return target;
+      }
+      return NO_CORE;
+    }
+
+    default:
+      assert(false);
+      return NO_CORE;
+    }
+  }
+
+  void migrate( unsigned tid, unsigned target ) {
+    ThreadState& t = m_threads[tid];
+    if ( !t.blocked ) {
+      m_cores[t.core].runnable--;
+      m_cores[target].runnable++;
+    }
+    t.core = target;
+    t.migrations++;
+    m_generation++;
+    (*m_threadMigrations[target])++;
+  }
+
+  /** @return the context switch cost incurred by the core */
+  uint64_t switchTo( unsigned core, unsigned tid ) {
+    CoreState& c = m_cores[core];
+    ThreadState& t = m_threads[tid];
+    uint64_t cost = 0;
+    if ( c.current != NO_THREAD && c.current != tid ) {
+      (*m_contextSwitches[core])++;
+      t.switchesIn++;
+      cost = m_contextSwitchCycles;
+    }
+    m_generation++;
+    c.current = tid;
+    c.preempted = false;
+    t.sliceInsns = 0;
+    return cost;
+  }
+
+public:
+
+  ThreadScheduler( unsigned numCores ) :
+    m_policy( SCHED_AFFINITY ),
+    m_timeSlice( numeric_limits<uint64_t>::max() ),
+    m_contextSwitchCycles( 0 ),
+    NUM_CORES( numCores ),
+    m_rrCursor( 0 ),
+    m_generation( 0 )
+  {
+    m_cores.resize( NUM_CORES );
+    for ( unsigned i = 0; i < NUM_CORES; i++ ) {
+      m_contextSwitches.push_back( new Counter(i, "ContextSwitches") );
+      m_threadMigrations.push_back( new Counter(i, "ThreadMigrations") );
+    }
+  }
+
+  /** Parse a policy name as given on the command line. Returns false if the name is unknown. */
+  static bool policyOfName( const string& name, SchedulingPolicy& policy ) {
+    if ( "affinity" == name ) policy = SCHED_AFFINITY;
+    else if ( "round-robin" == name ) policy = SCHED_ROUND_ROBIN;
+    else if ( "load-balance" == name ) policy = SCHED_LOAD_BALANCE;
+    else return false;
+    return true;
+  }
+
+  /** Pin a thread to a core; only honored by SCHED_AFFINITY. */
+  void setAffinity( unsigned tid, unsigned core ) {
+    assert( core < NUM_CORES );
+    m_affinity[tid] = core;
+  }
+
+  /** map from thread id to the core it is currently assigned to */
+  unsigned coreOf( unsigned tid ) const {
+    if ( known( tid ) ) {
+      return m_threads[tid].core;
+    }
+    // threads we haven't seen start (or INVALID_THREADID) get a fixed mapping
+    return tid % NUM_CORES;
+  }
+
+  /** the thread that last ran on the given core, or NO_THREAD */
+  unsigned currentThreadOf( unsigned core ) const {
+    return m_cores.at( core ).current;
+  }
+
+  /** Insns the given thread has executed so far. */
+  uint64_t insnsOf( unsigned tid ) const {
+    return known( tid ) ? m_threads[tid].insns : 0;
+  }
+
+  /** Whether the given thread has started, not finished, and is not blocked. */
+  bool isRunnable( unsigned tid ) const {
+    return known( tid ) && m_threads[tid].live && !m_threads[tid].blocked;
+  }
+
+  /** Whether no thread on this core can make progress. */
+  bool coreIsIdle( unsigned core ) const {
+    return 0 == m_cores.at( core ).runnable;
+  }
+
+  void threadStarted( unsigned tid ) {
+    ThreadState& t = stateOf( tid );
+    t.known = true;
+    t.live = true;
+    t.blocked = false;
+    t.core = placeNewThread( tid );
+    m_cores[t.core].runnable++;
+    m_generation++;
+  }
+
+  void threadFinished( unsigned tid ) {
+    if ( !known( tid ) ) return;
+    ThreadState& t = m_threads[tid];
+    if ( !t.live ) return;
+    if ( !t.blocked ) m_cores[t.core].runnable--;
+    t.live = false;
+    m_generation++;
+  }
+
+  void block( unsigned tid ) {
+    if ( !known( tid ) ) return;
+    ThreadState& t = m_threads[tid];
+    if ( !t.live || t.blocked ) return;
+    t.blocked = true;
+    m_cores[t.core].runnable--;
+    m_generation++;
+  }
+
+  void unblock( unsigned tid ) {
+    if ( !known( tid ) ) return;
+    ThreadState& t = m_threads[tid];
+    if ( !t.live || !t.blocked ) return;
+    t.blocked = false;
+    m_cores[t.core].runnable++;
+    m_generation++;
+  }
+
+  /** Credit insns to the given thread's current time slice. */
+  void executed( unsigned tid, uint64_t insns ) {
+    if ( !known( tid ) ) return;
+    ThreadState& t = m_threads[tid];
+    const bool wasExpired = sliceExpired( tid );
+    t.insns += insns;
+    t.sliceInsns += insns;
+    if ( !wasExpired && sliceExpired( tid ) ) m_generation++;
+  }
+
+  /** Try to make tid the running thread on some core, possibly migrating it.
+   * @param stalledCores cores that can't run anything until the quantum round
+   * ends; anything indexable by core that yields a bool, e.g. a vector<bool>
+   * @param switchCost output parameter: cycles charged to the thread's (new) core
+   * @return true iff tid can run now, on coreOf(tid) */
+  template<class StalledCores>
+  bool tryDispatch( unsigned tid, const StalledCores& stalledCores, uint64_t& switchCost ) {
+    switchCost = 0;
+    if ( !known( tid ) ) return true;
+
+    ThreadState& t = m_threads[tid];
+    CoreState& home = m_cores[t.core];
+    if ( home.current == tid ) return true;
+    if ( coreAvailable( t.core ) ) {
+      switchCost = switchTo( t.core, tid );
+      return true;
+    }
+
+    unsigned target = findMigrationTarget( t.core, stalledCores );
+    if ( NO_CORE != target ) {
+      migrate( tid, target );
+      switchCost = switchTo( target, tid );
+      return true;
+    }
+    return false;
+  }
+
+  /** Let another thread take over this core at the next opportunity. */
+  void preempt( unsigned core ) {
+    if ( !m_cores.at( core ).preempted ) {
+      m_cores[core].preempted = true;
+      m_generation++;
+    }
+  }
+
+  /** Changes whenever a thread that was refused by tryDispatch() might now
+   * succeed, so callers can wait for a change instead of polling. */
+  uint64_t generation() const {
+    return m_generation;
+  }
+
+  /** dump per-thread stats; per-core stats are dumped via the Counter class */
+  void dumpStats( ostream& os, const string& prefix, const string& suffix ) const {
+    for ( unsigned tid = 0; tid < m_threads.size(); tid++ ) {
+      const ThreadState& t = m_threads[tid];
+      if ( !t.known ) continue;
+      os << prefix << "'tid': " << tid << ", 'ThreadInsns': " << t.insns << suffix;
+      os << prefix << "'tid': " << tid << ", 'ThreadContextSwitches': " << t.switchesIn << suffix;
+      os << prefix << "'tid': " << tid << ", 'ThreadMigrations': " << t.migrations << suffix;
+      os << prefix << "'tid': " << tid << ", 'ThreadFinalCore': " << t.core << suffix;
+    }
+  }
+
+};
+
+#endif /* THREADSCHEDULER_HPP_ */
@@ -31,6 +31,15 @@ KNOB<string> KnobToSimulatorFifo( KNOB_MODE_WRITEONCE, "pintool", "tosim-fifo",
                                   "tosim", "The named fifo used to send events to the simulator." );
 KNOB<unsigned> KnobCores( KNOB_MODE_WRITEONCE, "pintool", "cores",
                           "1", "Number of simulated cores." );
+KNOB<BOOL> KnobFutexSync( KNOB_MODE_WRITEONCE, "pintool", "futex-sync",
+                          "0", "Also turn futex wake/wait syscalls into HB edges, for "
+                          "sync primitives that don't go through pthreads." );
+KNOB<string> KnobSymbolFile( KNOB_MODE_WRITEONCE, "pintool", "symbol-file",
+                             "", "Write the address range of every routine here as images "
+                             "load, so the simulator can name PCs (its --pc-symbols)." );
+
+/** routine address ranges, for KnobSymbolFile */
+static ofstream s_symbolFile;
 
 // Print a memory read record
 VOID RecordMemRead(VOID * ip, VOID * addr)
@@ -54,20 +63,21 @@ VOID instrumentTrace( TRACE trace, VOID *v ) {
     INS ins = BBL_InsHead( bbl );
 
     INS_InsertCall( ins, IPOINT_BEFORE, (AFUNPTR) startBasicBlock, IARG_THREAD_ID,
-                    IARG_CONTEXT, IARG_UINT32, BBL_NumIns( bbl ), IARG_END );
+                    IARG_CONTEXT, IARG_UINT32, BBL_NumIns( bbl ),
+                    IARG_ADDRINT, BBL_Address( bbl ), IARG_UINT32, BBL_Size( bbl ), IARG_END );
 
     UINT32 instPos = 0;
     for ( ; INS_Valid( ins ); ins = INS_Next( ins ) ) {
       if ( INS_IsMemoryRead( ins ) ) {
         INS_InsertCall( ins, IPOINT_BEFORE, (AFUNPTR) memOp, IARG_THREAD_ID, IARG_UINT32,
                         instPos, IARG_MEMORYREAD_EA, IARG_MEMORYREAD_SIZE, IARG_BOOL,
-                        true, IARG_BOOL, INS_IsStackRead( ins ), IARG_END );
+                        true, IARG_BOOL, INS_IsStackRead( ins ), IARG_INST_PTR, IARG_END );
       }
 
       if ( INS_IsMemoryWrite( ins ) ) {
         INS_InsertCall( ins, IPOINT_BEFORE, (AFUNPTR) memOp, IARG_THREAD_ID, IARG_UINT32,
                         instPos, IARG_MEMORYWRITE_EA, IARG_MEMORYWRITE_SIZE, IARG_BOOL,
-                        false, IARG_BOOL, INS_IsStackWrite( ins ), IARG_END );
+                        false, IARG_BOOL, INS_IsStackWrite( ins ), IARG_INST_PTR, IARG_END );
       }
       instPos++;
     }
@@ -78,13 +88,39 @@ BOOL isLikeLockAcquire( const char *rtnName ) {
   return strstr( rtnName, "pthread_mutex_lock" ) || //
       strstr( rtnName, "pthread_cond_wait" ) || //
       strstr( rtnName, "pthread_cond_timedwait" ) || //
+      // readers are treated like writers, so they synchronize with each other too
+      strstr( rtnName, "pthread_rwlock_rdlock" ) || //
+      strstr( rtnName, "pthread_rwlock_wrlock" ) || //
       strstr( rtnName, "ACQUIRE_FENCE" ); //custom hook for canneal
 }
 
+/** Blocking acquires that can fail, e.g. by timing out, so we have to check the return value. */
+BOOL isLikeTimedAcquire( const char *rtnName ) {
+  return strstr( rtnName, "pthread_mutex_timedlock" ) || //
+      strstr( rtnName, "pthread_rwlock_timedrdlock" ) || //
+      strstr( rtnName, "pthread_rwlock_timedwrlock" ) || //
+      strstr( rtnName, "sem_wait" ) || // can be interrupted by a signal
+      strstr( rtnName, "sem_timedwait" );
+}
+
+/** Acquires that never block, and return 0 on success. */
+BOOL isLikeTrylock( const char *rtnName ) {
+  return strstr( rtnName, "pthread_mutex_trylock" ) || //
+      strstr( rtnName, "pthread_rwlock_tryrdlock" ) || //
+      strstr( rtnName, "pthread_rwlock_trywrlock" ) || //
+      strstr( rtnName, "sem_trywait" ) || //
+      // spin locks spin instead of blocking in the kernel
+      strstr( rtnName, "pthread_spin_lock" ) || //
+      strstr( rtnName, "pthread_spin_trylock" );
+}
+
 BOOL isLikeLockRelease( const char *rtnName ) {
   return strstr( rtnName, "pthread_mutex_unlock" ) || //
       strstr( rtnName, "pthread_cond_broadcast" ) || //
       strstr( rtnName, "pthread_cond_signal" ) || //
+      strstr( rtnName, "pthread_rwlock_unlock" ) || //
+      strstr( rtnName, "pthread_spin_unlock" ) || //
+      strstr( rtnName, "sem_post" ) || //
       strstr( rtnName, "RELEASE_FENCE" ); // custom hook for canneal
 }
 
@@ -131,6 +167,11 @@ VOID instrumentImage( IMG img, VOID *v ) {
     for ( RTN rtn = SEC_RtnHead( sec ); RTN_Valid( rtn ); rtn = RTN_Next( rtn ) ) {
       const char *rtnName = RTN_Name( rtn ).c_str();
 
+      if ( s_symbolFile.is_open() ) {
+        s_symbolFile << hex << RTN_Address( rtn ) << dec << " " << RTN_Size( rtn ) << " "
+                     << IMG_Name( img ) << ":" << RTN_Name( rtn ) << "\n";
+      }
+
       if ( strstr( rtnName, "__parsec_roi_begin" ) ) {
         RTN_Open( rtn );
         RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) setStartReached, IARG_THREAD_ID,
@@ -147,6 +188,7 @@ VOID instrumentImage( IMG img, VOID *v ) {
         RTN_Open( rtn );
         RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeMalloc, IARG_THREAD_ID,
                         IARG_FUNCARG_ENTRYPOINT_VALUE, 0, // size requested
+                        IARG_RETURN_IP, // allocation site
                         IARG_END );
         RTN_InsertCall( rtn, IPOINT_AFTER, (AFUNPTR) afterMalloc, IARG_THREAD_ID,
                         IARG_FUNCRET_EXITPOINT_VALUE, // pointer to allocation
@@ -156,6 +198,7 @@ VOID instrumentImage( IMG img, VOID *v ) {
         RTN_Open( rtn );
         RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeMalloc, IARG_THREAD_ID,
                         IARG_FUNCARG_ENTRYPOINT_VALUE, 0, // size requested
+                        IARG_RETURN_IP, // allocation site
                         IARG_END );
         RTN_InsertCall( rtn, IPOINT_AFTER, (AFUNPTR) afterMalloc, IARG_THREAD_ID,
                         IARG_FUNCRET_EXITPOINT_VALUE, // pointer to allocation
@@ -204,7 +247,15 @@ VOID instrumentImage( IMG img, VOID *v ) {
         RTN_InsertCall( rtn, IPOINT_AFTER, (AFUNPTR) afterLockAcquire, IARG_THREAD_ID,
                         IARG_END );
         RTN_Close( rtn );
-      } else if ( strstr( rtnName, "pthread_mutex_trylock" ) ) {
+      } else if ( isLikeTimedAcquire( rtnName ) ) {
+        RTN_Open( rtn );
+        RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeLockAcquire, IARG_THREAD_ID,
+                        IARG_FUNCARG_ENTRYPOINT_VALUE, 0, IARG_END );
+        RTN_InsertCall( rtn, IPOINT_AFTER, (AFUNPTR) afterTimedAcquire, IARG_THREAD_ID,
+                        IARG_FUNCRET_EXITPOINT_VALUE, IARG_END );
+        RTN_Close( rtn );
+
+      } else if ( isLikeTrylock( rtnName ) ) {
         RTN_Open( rtn );
         RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeTrylock, IARG_THREAD_ID,
                         IARG_FUNCARG_ENTRYPOINT_VALUE, 0, IARG_END );
@@ -212,6 +263,22 @@ VOID instrumentImage( IMG img, VOID *v ) {
                         IARG_FUNCRET_EXITPOINT_VALUE, IARG_END );
         RTN_Close( rtn );
 
+      } else if ( strstr( rtnName, "pthread_barrier_init" ) ) {
+        RTN_Open( rtn );
+        RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeBarrierInit, IARG_THREAD_ID,
+                        IARG_FUNCARG_ENTRYPOINT_VALUE, 0, // the barrier
+                        IARG_FUNCARG_ENTRYPOINT_VALUE, 2, // threads per generation
+                        IARG_END );
+        RTN_Close( rtn );
+
+      } else if ( strstr( rtnName, "pthread_barrier_wait" ) ) {
+        RTN_Open( rtn );
+        RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeBarrierWait, IARG_THREAD_ID,
+                        IARG_FUNCARG_ENTRYPOINT_VALUE, 0, IARG_END );
+        RTN_InsertCall( rtn, IPOINT_AFTER, (AFUNPTR) afterBarrierWait, IARG_THREAD_ID,
+                        IARG_END );
+        RTN_Close( rtn );
+
       } else if ( isLikeLockRelease( rtnName ) ) {
         RTN_Open( rtn );
         RTN_InsertCall( rtn, IPOINT_BEFORE, (AFUNPTR) beforeLockRelease, IARG_THREAD_ID,
@@ -226,10 +293,12 @@ VOID instrumentImage( IMG img, VOID *v ) {
         RTN_Close( rtn );
       }
 
-      // TODO: pthread_mutex_timedlock, reader-writer locks
-
     } // for RTN
   } // for SEC
+
+  if ( s_symbolFile.is_open() ) {
+    s_symbolFile.flush();
+  }
 } // end instrumentImage()
 
 
@@ -267,6 +336,14 @@ int main( int argc, char *argv[] ) {
   }
   PIN_InitSymbols();
 
+  if ( !KnobSymbolFile.Value().empty() ) {
+    s_symbolFile.open( KnobSymbolFile.Value().c_str(), ios::trunc );
+    if ( !s_symbolFile.good() ) {
+      cerr << "[rcdcsim] can't write " << KnobSymbolFile.Value() << endl;
+      return 1;
+    }
+  }
+
   initRcdcSim();
 
   IMG_AddInstrumentFunction( instrumentImage, NULL );
@@ -0,0 +1,59 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Converts an interval stats file (see IntervalStats.hpp) into CSV.
+ *
+ * usage: intervalcsv [--cumulative] INTERVAL_FILE > out.csv
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+
+#include "IntervalStats.hpp"
+
+int main( int argc, char** argv ) {
+  bool cumulative = false;
+  const char* path = NULL;
+  for ( int i = 1; i < argc; i++ ) {
+    if ( 0 == strcmp( argv[i], "--cumulative" ) ) {
+      cumulative = true;
+    } else {
+      path = argv[i];
+    }
+  }
+  if ( NULL == path ) {
+    std::cerr << "usage: " << argv[0] << " [--cumulative] INTERVAL_FILE" << std::endl;
+    return 1;
+  }
+
+  std::ifstream in( path, std::ios::binary );
+  IntervalReader reader( in );
+  if ( !reader.m_valid ) {
+    std::cerr << "[intervalcsv] " << path << " is not an interval stats file" << std::endl;
+    return 1;
+  }
+  reader.toCSV( std::cout, cumulative );
+  return 0;
+}
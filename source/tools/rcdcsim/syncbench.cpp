@@ -0,0 +1,130 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Sync-throughput microbenchmark: replays the per-sync-event bookkeeping that
+ * processEvents() and MultiCacheSimulator do (logical-time assignment, the
+ * life-lock turn check, and the released-this-round set) on synthetic lock
+ * traffic, once with std::map and once with FlatHashMap.
+ *
+ * usage: syncbench [SYNC_OBJECTS [EVENTS [EVENTS_PER_ROUND]]]
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include <ctime>
+#include <stdint.h>
+
+#include "FlatHashMap.hpp"
+
+using namespace std;
+
+static double seconds() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** The bookkeeping as it was done with std::map */
+static uint64_t runTreeMaps( const vector<uint64_t>& syncObjects, uint64_t events, uint64_t eventsPerRound ) {
+  map<uint64_t,uint64_t> received, active, roundOfSource;
+  uint64_t round = 0, stalls = 0;
+  for ( uint64_t i = 0; i < events; i++ ) {
+    const uint64_t obj = syncObjects[ (i * 7919) % syncObjects.size() ];
+    map<uint64_t,uint64_t>::iterator mit = received.find( obj );
+    uint64_t time;
+    if ( mit == received.end() ) {
+      received[obj] = time = 1;
+    } else {
+      received[obj] = time = mit->second + 1;
+    }
+    map<uint64_t,uint64_t>::iterator ait = active.find( obj );
+    if ( 1 == time || (ait != active.end() && ait->second == time) ) {
+      active[obj] = time + 1;
+    }
+    if ( i & 1 ) {
+      roundOfSource[obj] = round;
+    } else {
+      map<uint64_t,uint64_t>::iterator rit = roundOfSource.find( obj );
+      if ( rit != roundOfSource.end() && rit->second == round ) stalls++;
+    }
+    if ( 0 == (i + 1) % eventsPerRound ) round++;
+  }
+  return stalls;
+}
+
+static uint64_t runFlatMaps( const vector<uint64_t>& syncObjects, uint64_t events, uint64_t eventsPerRound ) {
+  FlatHashMap<uint64_t> received, active;
+  FlatHashMap<bool> releasedThisRound;
+  uint64_t stalls = 0;
+  for ( uint64_t i = 0; i < events; i++ ) {
+    const uint64_t obj = syncObjects[ (i * 7919) % syncObjects.size() ];
+    const uint64_t time = ++received[obj];
+    uint64_t* a = active.find( obj );
+    if ( 1 == time || (NULL != a && *a == time) ) {
+      active[obj] = time + 1;
+    }
+    if ( i & 1 ) {
+      releasedThisRound[obj] = true;
+    } else if ( NULL != releasedThisRound.find( obj ) ) {
+      stalls++;
+    }
+    if ( 0 == (i + 1) % eventsPerRound ) releasedThisRound.clear();
+  }
+  return stalls;
+}
+
+int main( int argc, char** argv ) {
+  const uint64_t numObjects = argc > 1 ? strtoull( argv[1], NULL, 0 ) : 1024;
+  const uint64_t events = argc > 2 ? strtoull( argv[2], NULL, 0 ) : 10000000;
+  const uint64_t eventsPerRound = argc > 3 ? strtoull( argv[3], NULL, 0 ) : 64;
+  if ( 0 == numObjects || 0 == eventsPerRound ) {
+    cerr << "usage: " << argv[0] << " [SYNC_OBJECTS [EVENTS [EVENTS_PER_ROUND]]]" << endl;
+    return 1;
+  }
+
+  // locks are scattered around the heap, one per cache line at most
+  srand( 42 );
+  vector<uint64_t> syncObjects( numObjects );
+  for ( uint64_t i = 0; i < numObjects; i++ ) {
+    syncObjects[i] = 0x600000ULL + ( (uint64_t(rand()) << 16) ^ rand() ) * 64;
+  }
+
+  double start = seconds();
+  const uint64_t treeStalls = runTreeMaps( syncObjects, events, eventsPerRound );
+  const double tree = seconds() - start;
+  start = seconds();
+  const uint64_t flatStalls = runFlatMaps( syncObjects, events, eventsPerRound );
+  const double flat = seconds() - start;
+
+  if ( treeStalls != flatStalls ) {
+    cerr << "[syncbench] results differ: " << treeStalls << " vs " << flatStalls << " stalls" << endl;
+    return 1;
+  }
+  cout << "sync objects: " << numObjects << ", events: " << events << endl;
+  cout << "std::map:    " << events / tree / 1e6 << " M sync events/s" << endl;
+  cout << "FlatHashMap: " << events / flat / 1e6 << " M sync events/s" << endl;
+  cout << "speedup:     " << tree / flat << "x" << endl;
+  return 0;
+}
@@ -0,0 +1,113 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+#include "AdaptiveQuantum.hpp"
+#include "IntervalStats.hpp"
+
+BOOST_AUTO_TEST_SUITE( AdaptiveQuanta )
+
+BOOST_AUTO_TEST_CASE( growsWhenBalanced ) {
+  AdaptiveQuantum aq( 100, 2000 );
+  vector<uint64_t> work( 4, 1000 );
+  unsigned size = 1000;
+  for ( unsigned r = 0; r < 10; r++ ) {
+    size = aq.roundFinished( size, work, 4, 0, 0 );
+  }
+  BOOST_CHECK_EQUAL( size, 2000U );
+}
+
+BOOST_AUTO_TEST_CASE( shrinksWhenImbalanced ) {
+  AdaptiveQuantum aq( 100, 2000 );
+  vector<uint64_t> work( 4, 1000 );
+  work[0] = 100;
+  unsigned size = 1000;
+  for ( unsigned r = 0; r < 10; r++ ) {
+    size = aq.roundFinished( size, work, 4, 0, 0 );
+  }
+  BOOST_CHECK( size < 1000U );
+  BOOST_CHECK( size >= 100U );
+}
+
+BOOST_AUTO_TEST_CASE( shrinksOnOverflows ) {
+  AdaptiveQuantum aq( 100, 2000 );
+  vector<uint64_t> work( 4, 1000 );
+  unsigned size = 1000;
+  size = aq.roundFinished( size, work, 0, 0, 4 );
+  BOOST_CHECK_EQUAL( size, 500U );
+  // idle cores and rounds without quanta don't count
+  work[1] = 0;
+  BOOST_CHECK_EQUAL( aq.roundFinished( size, work, 0, 0, 0 ), 500U );
+}
+
+BOOST_AUTO_TEST_CASE( dumpsSizeHistogram ) {
+  AdaptiveQuantum aq( 100, 2000 );
+  vector<uint64_t> work( 4, 1000 );
+  unsigned size = 1000;
+  for ( unsigned r = 0; r < 100; r++ ) {
+    size = aq.roundFinished( size, work, 4, 0, 0 );
+  }
+  // rounds at 1000, 1250, 1562 and 1952, then 96 at the max
+  stringstream ss;
+  aq.dumpStats( ss, "", "\n" );
+  BOOST_CHECK( string::npos != ss.str().find( "'QuantumSizeHistogram': {512: 1, 1024: 99}" ) );
+  BOOST_CHECK( string::npos != ss.str().find( "'QuantumSizeIncreases': 4" ) );
+}
+
+BOOST_AUTO_TEST_CASE( recordsSizeTimeSeries ) {
+  std::vector<Counter*> group;
+  Counter::openGroup( &group );
+  AdaptiveQuantum aq( 100, 2000 );
+  Counter::closeGroup();
+  BOOST_REQUIRE_EQUAL( group.size(), 1U );
+  BOOST_CHECK_EQUAL( group[0]->get(), 0U );
+
+  vector<uint64_t> work( 4, 1000 );
+  vector<unsigned> sizes;
+  unsigned size = 1000;
+  stringstream file;
+  {
+    IntervalStats is( file, group, 0, 1 );
+    for ( unsigned r = 1; r <= 6; r++ ) {
+      size = aq.roundFinished( size, work, 4, 0, 0 );
+      sizes.push_back( size );
+      is.tick( 0, r );
+    }
+  }
+  BOOST_CHECK_EQUAL( group[0]->get(), 2000U );
+
+  IntervalReader reader( file );
+  BOOST_REQUIRE( reader.m_valid );
+  BOOST_CHECK_EQUAL( reader.m_names[0], "QuantumSize" );
+  std::vector<int64_t> row;
+  int64_t value = 0;
+  for ( unsigned r = 0; r < sizes.size(); r++ ) {
+    BOOST_REQUIRE( reader.next( row ) );
+    value += row[2];
+    BOOST_CHECK_EQUAL( value, (int64_t) sizes[r] );
+  }
+  BOOST_CHECK( !reader.next( row ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+#include "AllocationMap.hpp"
+
+BOOST_AUTO_TEST_SUITE( AllocationMaps )
+
+BOOST_AUTO_TEST_CASE( attributesToSites ) {
+  AllocationMap m;
+  m.allocated( 0x1000, 64, 0x400100 );
+  m.allocated( 0x2000, 128, 0x400200 );
+  m.allocated( 0x3000, 64, 0x400100 );
+  m.of( 0x1000 ).misses++;
+  m.of( 0x103f ).misses++;
+  m.of( 0x3010 ).remoteHits++;
+  m.of( 0x2080 ).misses++;  // just past the second allocation
+  m.of( 0x20 ).dirtyLines++;
+
+  BOOST_CHECK_EQUAL( m.of( 0x1010 ).misses, 2U );
+  BOOST_CHECK_EQUAL( m.of( 0x1010 ).remoteHits, 1U );
+  BOOST_CHECK_EQUAL( m.of( 0x1010 ).allocations, 2U );
+  BOOST_CHECK_EQUAL( m.of( 0x1010 ).bytesAllocated, 128U );
+  BOOST_CHECK_EQUAL( m.of( 0x2000 ).misses, 0U );
+  BOOST_CHECK_EQUAL( m.of( 0x5000 ).misses, 1U );
+  BOOST_CHECK_EQUAL( m.of( 0x5000 ).dirtyLines, 1U );
+}
+
+BOOST_AUTO_TEST_CASE( freesAndOverlaps ) {
+  AllocationMap m;
+  m.allocated( 0x1000, 64, 0x400100 );
+  m.of( 0x1000 ).misses++;  // fills the last-hit cache
+  m.freed( 0x1000 );
+  m.of( 0x1000 ).misses++;  // no longer heap
+  BOOST_CHECK_EQUAL( m.of( 0x9000 ).misses, 1U );
+  BOOST_CHECK_EQUAL( m.liveAllocations(), 0U );
+
+  // a missed free leaves a stale allocation that the new one replaces
+  m.allocated( 0x2000, 256, 0x400100 );
+  m.allocated( 0x2040, 64, 0x400300 );
+  BOOST_CHECK_EQUAL( m.liveAllocations(), 1U );
+  m.of( 0x2040 ).misses++;
+  m.of( 0x2000 ).misses++;
+  BOOST_CHECK_EQUAL( m.of( 0x2050 ).misses, 1U );
+  BOOST_CHECK_EQUAL( m.of( 0x2050 ).site, 0x400300U );
+  BOOST_CHECK_EQUAL( m.of( 0x0 ).misses, 2U );
+}
+
+BOOST_AUTO_TEST_CASE( reportsCostliestSites ) {
+  AllocationMap m;
+  m.allocated( 0x1000, 64, 0x400100 );
+  m.allocated( 0x2000, 64, 0x400200 );
+  m.of( 0x2000 ).upgradeMisses += 3;
+  m.of( 0x1000 ).misses++;
+  stringstream ss;
+  m.dumpStats( ss, "{", "}\n" );
+  const string s = ss.str();
+  BOOST_CHECK( s.find( "{'AllocationSites': 2}" ) != string::npos );
+  BOOST_CHECK( s.find( "'allocSite': 4194816" ) < s.find( "'allocSite': 4194560" ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
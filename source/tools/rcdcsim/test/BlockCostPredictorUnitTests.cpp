@@ -0,0 +1,113 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "BlockCostPredictor.hpp"
+#include "MultiCacheSimulator.hpp"
+
+BOOST_AUTO_TEST_SUITE( BlockCostPrediction )
+
+BOOST_AUTO_TEST_CASE( unknownThreadsRunAtOneCyclePerInsn ) {
+  BlockCostPredictor bcp;
+  BOOST_CHECK_EQUAL( bcp.predict( 3, 0x400000, 10 ), 10U );
+}
+
+BOOST_AUTO_TEST_CASE( trainsOnlyAtRoundEnd ) {
+  BlockCostPredictor bcp;
+  bcp.observe( 0, 0x400000, 10, 40 );
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 10 ), 10U );
+  bcp.observe( 0, 0x400000, 10, 20 );
+  bcp.quantumRoundFinished();
+  // both runs are folded in together: 60 cycles over 20 insns
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 10 ), 30U );
+  // other threads know nothing yet
+  BOOST_CHECK_EQUAL( bcp.predict( 1, 0x400000, 10 ), 10U );
+}
+
+BOOST_AUTO_TEST_CASE( unseenBlocksUseThreadAverage ) {
+  BlockCostPredictor bcp;
+  bcp.observe( 0, 0x400000, 10, 20 );
+  bcp.observe( 0, 0x400100, 30, 100 );
+  bcp.quantumRoundFinished();
+  // 120 cycles over 40 insns
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400200, 10 ), 30U );
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 10 ), 20U );
+}
+
+BOOST_AUTO_TEST_CASE( movingAverage ) {
+  BlockCostPredictor bcp;
+  bcp.observe( 0, 0x400000, 100, 100 );
+  bcp.quantumRoundFinished();
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 100 ), 100U );
+  // a new observation gets weight 1/EWMA_WEIGHT
+  bcp.observe( 0, 0x400000, 100, 500 );
+  bcp.quantumRoundFinished();
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 100 ), 200U );
+  // rounds where the block doesn't run leave its prediction alone
+  bcp.observe( 0, 0x400100, 100, 100 );
+  bcp.quantumRoundFinished();
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 100 ), 200U );
+}
+
+BOOST_AUTO_TEST_CASE( emptyBlocksAreIgnored ) {
+  BlockCostPredictor bcp;
+  bcp.observe( 0, 0x400000, 0, 50 );
+  bcp.quantumRoundFinished();
+  BOOST_CHECK_EQUAL( bcp.predict( 0, 0x400000, 10 ), 10U );
+}
+
+BOOST_AUTO_TEST_CASE( quantaEndOnPredictedCycles ) {
+  CacheConfiguration<RCDCLine> l1;
+  l1.cacheSize = 1024;
+  l1.assoc = 2;
+  l1.blockSize = 64;
+  l1.callbacks = NULL;
+  MultiCacheSimulator<RCDCLine, uint64_t> sim( 1, l1, false, l1, false, l1 );
+  sim.m_simulateHB = true;
+  sim.m_quantumSize = 100;
+  sim.useBlockCostPredictor();
+  sim.threadStarted( 0 );
+  BOOST_REQUIRE( sim.tryDispatch( 0 ) );
+
+  // each block is 10 insns and 10 L1 hits. Nothing is known yet, so the
+  // first quantum is 100 insns.
+  unsigned blocks = 0;
+  while ( 0 == sim.numQuantumRounds() ) {
+    sim.basicBlock( 0, 10, 0x400000, 0 );
+    blocks++;
+    for ( unsigned i = 0; i < 10; i++ ) sim.cacheRead( 0, 0x1000, 8 );
+  }
+  BOOST_CHECK_EQUAL( blocks, 10U );
+
+  // now the block is predicted to take 20 cycles, so a quantum of 100
+  // cycles is only 50 insns
+  blocks = 0;
+  while ( 1 == sim.numQuantumRounds() ) {
+    sim.basicBlock( 0, 10, 0x400000, 0 );
+    blocks++;
+    for ( unsigned i = 0; i < 10; i++ ) sim.cacheRead( 0, 0x1000, 8 );
+  }
+  BOOST_CHECK_EQUAL( blocks, 5U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
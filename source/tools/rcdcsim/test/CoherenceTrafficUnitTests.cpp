@@ -0,0 +1,61 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+#include "CoherenceTraffic.hpp"
+
+BOOST_AUTO_TEST_SUITE( CoherenceTraffics )
+
+BOOST_AUTO_TEST_CASE( countsPairs ) {
+  CoherenceTraffic t( 3 );
+  t.transfer( 0, 1 );
+  t.transfer( 0, 1 );
+  t.transfer( 2, 0 );
+  t.invalidation( 1, 2 );
+  BOOST_CHECK_EQUAL( t.transfers( 0, 1 ), 2U );
+  BOOST_CHECK_EQUAL( t.transfers( 1, 0 ), 0U );
+  BOOST_CHECK_EQUAL( t.transfers( 2, 0 ), 1U );
+  BOOST_CHECK_EQUAL( t.invalidations( 1, 2 ), 1U );
+  BOOST_CHECK_EQUAL( t.invalidations( 2, 1 ), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( dumpsCompactly ) {
+  CoherenceTraffic t( 2 );
+  t.transfer( 1, 0 );
+  t.invalidation( 0, 1 );
+  t.snoopingWrite( 1 );
+  t.snoopingWrite( 0 );
+  t.snoopingWrite( 1 );
+  t.endRound();
+  t.endRound();
+  stringstream ss;
+  t.dumpStats( ss, "{", "}\n" );
+  BOOST_CHECK_EQUAL( ss.str(),
+                     "{'CoherenceTransferMatrix': [[0, 0], [1, 0]]}\n"
+                     "{'CoherenceInvalidationMatrix': [[0, 1], [0, 0]]}\n"
+                     "{'InvalidationFanOut': {0: 1, 1: 2}}\n"
+                     "{'CommunicationPerRoundHistogram': {0: 1, 2: 1}}\n" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
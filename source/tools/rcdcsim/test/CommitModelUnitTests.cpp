@@ -0,0 +1,83 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "CommitModel.hpp"
+
+BOOST_AUTO_TEST_SUITE( CommitModels )
+
+BOOST_AUTO_TEST_CASE( nothingDirty ) {
+  CommitModel cm;
+  cm.m_latency = 100;
+  BOOST_CHECK_EQUAL( cm.cycles( vector<uint64_t>( 4, 0 ) ), 0U );
+  BOOST_CHECK_EQUAL( cm.cycles( vector<uint64_t>() ), 0U );
+  BOOST_CHECK_EQUAL( cm.roundFinished( 1000, 0 ), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( perLineBound ) {
+  CommitModel cm;
+  cm.m_latency = 10;
+  cm.m_lineCycles = 4;
+  cm.m_bandwidth = 4;
+  vector<uint64_t> lines( 4, 0 );
+  lines[0] = 8;
+  lines[2] = 2;
+  // the busiest core needs 8*4 cycles, the shared level only 10/4
+  BOOST_CHECK_EQUAL( cm.cycles( lines ), 10U + 32U );
+}
+
+BOOST_AUTO_TEST_CASE( bandwidthBound ) {
+  CommitModel cm;
+  cm.m_latency = 10;
+  cm.m_lineCycles = 1;
+  cm.m_bandwidth = 2;
+  vector<uint64_t> lines( 4, 5 );
+  // each core needs 5 cycles, but 20 lines at 2 per cycle take 10
+  BOOST_CHECK_EQUAL( cm.cycles( lines ), 10U + 10U );
+  // partial cycles round up
+  lines[3] = 6;
+  BOOST_CHECK_EQUAL( cm.cycles( lines ), 10U + 11U );
+}
+
+BOOST_AUTO_TEST_CASE( exposedWithoutOverlap ) {
+  CommitModel cm;
+  BOOST_CHECK_EQUAL( cm.roundFinished( 1000, 300 ), 300U );
+  BOOST_CHECK_EQUAL( cm.roundFinished( 1000, 50 ), 50U );
+  BOOST_CHECK_EQUAL( cm.drain(), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( overlapped ) {
+  CommitModel cm;
+  cm.m_overlap = true;
+  // this commit runs during the next round...
+  BOOST_CHECK_EQUAL( cm.roundFinished( 1000, 300 ), 0U );
+  // ...which is long enough to hide it
+  BOOST_CHECK_EQUAL( cm.roundFinished( 1000, 500 ), 0U );
+  // this round is too short to hide the previous commit
+  BOOST_CHECK_EQUAL( cm.roundFinished( 200, 100 ), 300U );
+  // the last commit has nothing to overlap with
+  BOOST_CHECK_EQUAL( cm.drain(), 100U );
+  BOOST_CHECK_EQUAL( cm.drain(), 0U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,66 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "Counter.hpp"
+
+BOOST_AUTO_TEST_SUITE( Counters )
+
+BOOST_AUTO_TEST_CASE( deletedCountersUnregister ) {
+  const size_t before = Counter::allCounters().size();
+  Counter* a = new Counter( 0, "UnitTestA" );
+  Counter* b = new Counter( 1, "UnitTestB" );
+  BOOST_CHECK_EQUAL( Counter::allCounters().size(), before + 2 );
+  BOOST_CHECK( Counter::find( 0, "UnitTestA" ) == a );
+
+  // out of creation order
+  delete a;
+  BOOST_CHECK( NULL == Counter::find( 0, "UnitTestA" ) );
+  BOOST_CHECK( Counter::find( 1, "UnitTestB" ) == b );
+  delete b;
+  BOOST_CHECK_EQUAL( Counter::allCounters().size(), before );
+}
+
+BOOST_AUTO_TEST_CASE( groupedCountersLeaveTheirGroup ) {
+  const size_t before = Counter::allCounters().size();
+  std::vector<Counter*> group;
+  Counter::openGroup( &group );
+  Counter* a = new Counter( 0, "UnitTestA" );
+  {
+    Counter b( 0, "UnitTestB" );
+    BOOST_CHECK_EQUAL( group.size(), 2U );
+  }
+  Counter::closeGroup();
+  BOOST_REQUIRE_EQUAL( group.size(), 1U );
+  BOOST_CHECK( group[0] == a );
+
+  // a copy joins its original's group, even once the group is closed
+  Counter* c = new Counter( *a );
+  BOOST_CHECK_EQUAL( group.size(), 2U );
+  delete a;
+  delete c;
+  BOOST_CHECK( group.empty() );
+  BOOST_CHECK_EQUAL( Counter::allCounters().size(), before );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "EventBuffer.hpp"
+
+static Event eventNumber( uint64_t i ) {
+  Event e;
+  e.m_addr = i;
+  return e;
+}
+
+BOOST_AUTO_TEST_SUITE( EventBuffers )
+
+BOOST_AUTO_TEST_CASE( inMemory ) {
+  EventBuffer b( 8, 4 );
+  for ( uint64_t i = 0; i < 8; i++ ) {
+    b.push_back( eventNumber(i) );
+  }
+  BOOST_CHECK_EQUAL( b.m_spilledEvents, 0U );
+  for ( uint64_t i = 0; i < 8; i++ ) {
+    BOOST_CHECK_EQUAL( b.front().m_addr, i );
+    b.pop_front();
+  }
+  BOOST_CHECK( b.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( spillPreservesOrder ) {
+  EventBuffer b( 8, 4 );
+  uint64_t next = 0, expected = 0;
+  // interleave pushes and pops so events move between ring, file and tail
+  for ( unsigned round = 0; round < 10; round++ ) {
+    for ( unsigned i = 0; i < 13; i++ ) {
+      b.push_back( eventNumber(next++) );
+    }
+    BOOST_CHECK( b.inMemory() <= 8 + 4 );
+    for ( unsigned i = 0; i < 7; i++ ) {
+      BOOST_CHECK_EQUAL( b.front().m_addr, expected++ );
+      b.pop_front();
+    }
+  }
+  BOOST_CHECK( b.m_spilledEvents > 0 );
+  while ( !b.empty() ) {
+    BOOST_CHECK_EQUAL( b.front().m_addr, expected++ );
+    b.pop_front();
+  }
+  BOOST_CHECK_EQUAL( expected, next );
+}
+
+BOOST_AUTO_TEST_CASE( eventsStaySmall ) {
+  // every event crosses the fifo and may be spilled; per-type fields share space
+  BOOST_CHECK_EQUAL( sizeof(Event), 48U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
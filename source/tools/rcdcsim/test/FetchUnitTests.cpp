@@ -0,0 +1,191 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "SMPCache.hpp"
+
+typedef SMPCache<RCDCLine, uint64_t> Cache;
+
+static const unsigned LINE = 64;
+static const uint64_t CODE = 0x400000;
+
+static CacheConfiguration<RCDCLine> config( int size, int assoc ) {
+  CacheConfiguration<RCDCLine> c;
+  c.cacheSize = size;
+  c.assoc = assoc;
+  c.blockSize = LINE;
+  c.callbacks = NULL;
+  return c;
+}
+
+/** Two cores with private L1D, L1I and L2, and a shared L3. */
+struct FetchBookends {
+  LRUCallbacks<RCDCLine> l3Callbacks;
+  HierarchicalCache<RCDCLine>* l3;
+  vector<Cache*> caches;
+  vector<Counter*> counters;
+
+  FetchBookends() {
+    CacheConfiguration<RCDCLine> l3config = config( 64*1024, 8 );
+    l3config.callbacks = &l3Callbacks;
+    l3 = new HierarchicalCache<RCDCLine>( l3config, NULL );
+    // keep these caches' Counters out of the dumped stats
+    Counter::openGroup( &counters );
+    for ( unsigned c = 0; c < 2; c++ ) {
+      caches.push_back( new Cache( c, 2, l3, &caches, config( 4*1024, 2 ), true, config( 16*1024, 4 ) ) );
+      // 2 ways of 8 sets
+      caches.back()->enableICache( config( 1024, 2 ) );
+    }
+    Counter::closeGroup();
+  }
+
+  ~FetchBookends() {
+    for ( unsigned c = 0; c < caches.size(); c++ ) {
+      delete caches[c];
+    }
+    delete l3;
+  }
+
+  bool inL1I( unsigned core, uint64_t addr ) {
+    return NULL != caches[core]->L1Icache->lineFor( addr );
+  }
+
+  void write( unsigned core, uint64_t addr ) {
+    caches[core]->write( DataAccess( WRITE_ACCESS, addr, 8, LINE ), false );
+  }
+
+  void read( unsigned core, uint64_t addr ) {
+    caches[core]->read( DataAccess( READ_ACCESS, addr, 8, LINE ) );
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( InstructionFetch, FetchBookends )
+
+BOOST_AUTO_TEST_CASE( coalescesRepeatedLines ) {
+  Cache* c = caches[0];
+  BOOST_CHECK( !c->fetchCoalesced( CODE ) );
+  BOOST_CHECK( c->fetchCoalesced( CODE ) );
+  BOOST_CHECK( !c->fetchCoalesced( CODE + LINE ) );
+  BOOST_CHECK( !c->fetchCoalesced( CODE ) );
+  BOOST_CHECK_EQUAL( c->numFetches.get(), 4U );
+  BOOST_CHECK_EQUAL( c->numCoalescedFetches.get(), 1U );
+}
+
+BOOST_AUTO_TEST_CASE( fetchesEveryLineOfABlock ) {
+  Cache* c = caches[0];
+  // 16 bytes straddling two lines
+  c->fetch( CODE + LINE - 8, 16, LINE );
+  BOOST_CHECK_EQUAL( c->numFetches.get(), 2U );
+  BOOST_CHECK_EQUAL( c->numFetchL1IMisses.get(), 2U );
+  BOOST_CHECK_EQUAL( c->numFetchMemoryMisses.get(), 2U );
+  BOOST_CHECK( c->fetchStallCycles.get() == 2 * Cache::MEMORY_ACCESS_LATENCY );
+  BOOST_CHECK( c->timeInMemoryHierarchy == c->fetchStallCycles.get() );
+
+  // the same block again: neither line follows a fetch of itself, so neither
+  // is coalesced, but both hit in the L1I at no cost
+  c->fetch( CODE + LINE - 8, 16, LINE );
+  BOOST_CHECK_EQUAL( c->numFetches.get(), 4U );
+  BOOST_CHECK_EQUAL( c->numCoalescedFetches.get(), 0U );
+  BOOST_CHECK_EQUAL( c->numFetchL1IMisses.get(), 2U );
+  BOOST_CHECK( c->fetchStallCycles.get() == 2 * Cache::MEMORY_ACCESS_LATENCY );
+
+  // a block within the last line fetched is coalesced
+  c->fetch( CODE + LINE + 8, 4, LINE );
+  BOOST_CHECK_EQUAL( c->numCoalescedFetches.get(), 1U );
+
+  // empty blocks fetch nothing
+  c->fetch( CODE, 0, LINE );
+  BOOST_CHECK_EQUAL( c->numFetches.get(), 5U );
+}
+
+BOOST_AUTO_TEST_CASE( countsInstructionSideMisses ) {
+  Cache* c = caches[0];
+  // three lines in one 2-way L1I set: the first is evicted to the L2
+  const uint64_t SET_STRIDE = 8 * LINE;
+  c->fetchLine( CODE );
+  c->fetchLine( CODE + SET_STRIDE );
+  c->fetchLine( CODE + 2 * SET_STRIDE );
+  BOOST_CHECK_EQUAL( c->numFetchL1IMisses.get(), 3U );
+  BOOST_CHECK_EQUAL( c->numFetchMemoryMisses.get(), 3U );
+  BOOST_CHECK( !inL1I( 0, CODE ) );
+
+  c->fetchLine( CODE );
+  BOOST_CHECK_EQUAL( c->numFetchL1IMisses.get(), 4U );
+  BOOST_CHECK_EQUAL( c->numFetchMemoryMisses.get(), 3U );
+  BOOST_CHECK( c->fetchStallCycles.get() == 3 * Cache::MEMORY_ACCESS_LATENCY + Cache::L2_HIT_LATENCY );
+  // fetches aren't data accesses
+  BOOST_CHECK_EQUAL( c->numReadMisses.get(), 0U );
+  BOOST_CHECK_EQUAL( caches[1]->numFetchL1IMisses.get(), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( writesInvalidateInstructionCopies ) {
+  caches[0]->fetchLine( CODE );
+  caches[1]->fetchLine( CODE );
+  BOOST_CHECK( inL1I( 0, CODE ) && inL1I( 1, CODE ) );
+
+  write( 1, CODE + 8 );
+  BOOST_CHECK( !inL1I( 0, CODE ) );
+  BOOST_CHECK( !inL1I( 1, CODE ) );
+
+  // core 0 now gets the line from core 1, which keeps a Shared copy
+  caches[0]->fetchLine( CODE );
+  BOOST_CHECK( caches[0]->fetchStallCycles.get() == Cache::MEMORY_ACCESS_LATENCY + Cache::REMOTE_HIT_LATENCY );
+  BOOST_CHECK_EQUAL( caches[0]->numFetchMemoryMisses.get(), 1U );
+  // so writing it again needs an upgrade, which invalidates the L1I copy
+  write( 1, CODE + 8 );
+  BOOST_CHECK_EQUAL( caches[1]->numUpgradeMisses.get(), 1U );
+  BOOST_CHECK( !inL1I( 0, CODE ) );
+}
+
+BOOST_AUTO_TEST_CASE( fetchesTakeWritePermission ) {
+  // core 0's own Modified data copy becomes Shared when it fetches the line
+  write( 0, CODE );
+  caches[0]->fetchLine( CODE );
+  write( 0, CODE );
+  BOOST_CHECK_EQUAL( caches[0]->numUpgradeMisses.get(), 1U );
+  BOOST_CHECK( !inL1I( 0, CODE ) );
+
+  // data reads of a line an L1I holds are Shared, not Exclusive
+  caches[1]->fetchLine( CODE + LINE );
+  read( 0, CODE + LINE );
+  write( 0, CODE + LINE );
+  BOOST_CHECK_EQUAL( caches[0]->numUpgradeMisses.get(), 2U );
+  BOOST_CHECK( !inL1I( 1, CODE + LINE ) );
+}
+
+BOOST_AUTO_TEST_CASE( writesFindEvictedInstructionCopies ) {
+  // core 0 holds the line in its L1D and its L1I, then evicts the L1I copy to the L2
+  const uint64_t SET_STRIDE = 8 * LINE;
+  read( 0, CODE );
+  caches[0]->fetchLine( CODE );
+  caches[0]->fetchLine( CODE + SET_STRIDE );
+  caches[0]->fetchLine( CODE + 2 * SET_STRIDE );
+  BOOST_CHECK( !inL1I( 0, CODE ) );
+
+  // core 1's write must invalidate both of core 0's copies
+  write( 1, CODE );
+  RCDCLine* l = NULL;
+  BOOST_CHECK( MISSED_TO_MEMORY == caches[0]->L1cache->search( CODE, l ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
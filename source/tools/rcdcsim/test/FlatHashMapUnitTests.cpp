@@ -0,0 +1,74 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "FlatHashMap.hpp"
+
+BOOST_AUTO_TEST_SUITE( FlatHashMaps )
+
+BOOST_AUTO_TEST_CASE( insertAndFind ) {
+  FlatHashMap<uint64_t> m;
+  BOOST_CHECK( NULL == m.find( 0x1000 ) );
+  m[0x1000] = 3;
+  bool inserted = true;
+  BOOST_CHECK_EQUAL( ++m.findOrInsert( 0x1000, inserted ), 4U );
+  BOOST_CHECK( !inserted );
+  BOOST_CHECK_EQUAL( *m.find( 0x1000 ), 4U );
+  BOOST_CHECK_EQUAL( m.size(), 1U );
+}
+
+BOOST_AUTO_TEST_CASE( growsPastInitialSize ) {
+  FlatHashMap<uint64_t> m;
+  for ( uint64_t i = 0; i < 10000; i++ ) {
+    m[i * 64] = i;
+  }
+  BOOST_CHECK_EQUAL( m.size(), 10000U );
+  for ( uint64_t i = 0; i < 10000; i++ ) {
+    BOOST_REQUIRE( NULL != m.find( i * 64 ) );
+    BOOST_CHECK_EQUAL( *m.find( i * 64 ), i );
+  }
+  BOOST_CHECK( NULL == m.find( 10000 * 64 ) );
+}
+
+BOOST_AUTO_TEST_CASE( clearForgetsEverything ) {
+  FlatHashMap<bool> m;
+  for ( uint64_t i = 0; i < 100; i++ ) {
+    m[i] = true;
+  }
+  m.clear();
+  BOOST_CHECK( m.empty() );
+  for ( uint64_t i = 0; i < 100; i++ ) {
+    BOOST_CHECK( NULL == m.find( i ) );
+  }
+  // values are reset when a stale slot is reused
+  m[7];
+  BOOST_CHECK_EQUAL( *m.find( 7 ), false );
+  // growing after a clear must not resurrect stale entries
+  for ( uint64_t i = 1000; i < 1200; i++ ) {
+    m[i] = true;
+  }
+  BOOST_CHECK( NULL == m.find( 8 ) );
+  BOOST_CHECK_EQUAL( m.size(), 201U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "HappensBefore.hpp"
+
+BOOST_AUTO_TEST_SUITE( HappensBeforeTracking )
+
+BOOST_AUTO_TEST_CASE( lockOrdersAccesses ) {
+  HappensBefore hb;
+  hb.access( 0, 0x1000, 8, true );
+  hb.release( 0, 0x42 );
+  BOOST_CHECK( hb.acquire( 1, 0x42 ) );
+  hb.access( 1, 0x1000, 8, true );
+  BOOST_CHECK_EQUAL( hb.m_races, 0U );
+  // re-acquiring a lock we already know about is the O(1) path
+  BOOST_CHECK( !hb.acquire( 1, 0x42 ) );
+  BOOST_CHECK_EQUAL( hb.m_fastAcquires, 1U );
+}
+
+BOOST_AUTO_TEST_CASE( unorderedWritesRace ) {
+  HappensBefore hb;
+  hb.access( 0, 0x1000, 4, true );
+  hb.access( 1, 0x1004, 4, false );
+  hb.access( 1, 0x2000, 4, true );
+  BOOST_CHECK_EQUAL( hb.m_races, 1U );
+  BOOST_REQUIRE_EQUAL( hb.m_reported.size(), 1U );
+  BOOST_CHECK_EQUAL( hb.m_reported[0].kind, WRITE_READ_RACE );
+  BOOST_CHECK_EQUAL( hb.m_reported[0].addr, 0x1000U );
+}
+
+BOOST_AUTO_TEST_CASE( concurrentReadsThenWrite ) {
+  HappensBefore hb;
+  hb.access( 0, 0x1000, 8, false );
+  hb.access( 1, 0x1000, 8, false );
+  BOOST_CHECK_EQUAL( hb.m_races, 0U );
+  // thread 2 only synchronizes with thread 0, so it races with thread 1's read
+  hb.release( 0, 0x42 );
+  hb.acquire( 2, 0x42 );
+  hb.access( 2, 0x1000, 8, true );
+  BOOST_REQUIRE_EQUAL( hb.m_reported.size(), 1U );
+  BOOST_CHECK_EQUAL( hb.m_reported[0].kind, READ_WRITE_RACE );
+  BOOST_CHECK_EQUAL( hb.m_reported[0].firstTid, 1U );
+}
+
+BOOST_AUTO_TEST_CASE( transitiveEdges ) {
+  HappensBefore hb;
+  hb.release( 0, 0x1 );
+  hb.acquire( 1, 0x1 );
+  hb.release( 1, 0x2 );
+  // thread 2 learns about thread 0's release through thread 1
+  BOOST_CHECK( hb.acquire( 2, 0x2 ) );
+  BOOST_CHECK( !hb.acquire( 2, 0x1 ) );
+}
+
+BOOST_AUTO_TEST_CASE( concurrentReleasesAreJoined ) {
+  HappensBefore hb;
+  // e.g. two threads posting a semaphore
+  hb.release( 0, 0x1 );
+  hb.release( 1, 0x1 );
+  BOOST_CHECK( hb.acquire( 2, 0x1 ) );
+  BOOST_CHECK_EQUAL( hb.thread( 2 ).clockOf( 0 ), 1U );
+  BOOST_CHECK_EQUAL( hb.thread( 2 ).clockOf( 1 ), 1U );
+  // thread 0 knows its own release but not thread 1's
+  BOOST_CHECK( hb.acquire( 0, 0x1 ) );
+  BOOST_CHECK( !hb.acquire( 0, 0x1 ) );
+}
+
+BOOST_AUTO_TEST_CASE( onlyCurrentRoundIsUncommitted ) {
+  HappensBefore hb;
+  hb.release( 0, 0x1 );
+  hb.quantumRoundFinished();
+  // the release has been committed, so acquiring it needn't stall
+  BOOST_CHECK( !hb.acquire( 1, 0x1 ) );
+  BOOST_CHECK_EQUAL( hb.thread( 1 ).clockOf( 0 ), 1U );
+}
+
+BOOST_AUTO_TEST_CASE( freeForgetsAccesses ) {
+  HappensBefore hb;
+  hb.allocated( 0x1000, 16 );
+  hb.access( 0, 0x1000, 8, true );
+  hb.access( 0, 0x1010, 8, true );
+  hb.freed( 0x1000 );
+  // another thread reusing the freed block doesn't race with the old writes...
+  hb.access( 1, 0x1000, 8, true );
+  hb.access( 1, 0x1008, 8, false );
+  BOOST_CHECK_EQUAL( hb.m_races, 0U );
+  // ...but the words after it still remember thread 0
+  hb.access( 1, 0x1010, 8, false );
+  BOOST_CHECK_EQUAL( hb.m_races, 1U );
+  // a second free of the same block, and frees of unknown blocks, are ignored
+  hb.freed( 0x1000 );
+  hb.freed( 0x3000 );
+  hb.access( 0, 0x1000, 8, true );
+  BOOST_CHECK_EQUAL( hb.m_races, 2U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
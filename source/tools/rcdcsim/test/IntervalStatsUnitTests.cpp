@@ -0,0 +1,71 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+#include "IntervalStats.hpp"
+
+BOOST_AUTO_TEST_SUITE( IntervalStatistics )
+
+BOOST_AUTO_TEST_CASE( roundTrip ) {
+  std::vector<Counter*> group;
+  Counter::openGroup( &group );
+  Counter a( 0, "A" ), b( 1, "B" );
+  Counter::closeGroup();
+
+  std::stringstream file;
+  {
+    IntervalStats is( file, group, 100, 0 );
+    a.add( 5 );
+    is.tick( 50, 0 ); // not yet
+    is.tick( 120, 0 );
+    b.add( 1000 );
+    a.set( 2 ); // counters can go down
+    for ( uint64_t i = 2; i <= 300; i++ ) {
+      is.tick( i * 100, 0 );
+    }
+    BOOST_CHECK_EQUAL( is.m_intervals, 300U );
+  }
+
+  IntervalReader reader( file );
+  BOOST_REQUIRE( reader.m_valid );
+  BOOST_REQUIRE_EQUAL( reader.m_names.size(), 2U );
+  BOOST_CHECK_EQUAL( reader.m_names[1], "B" );
+  BOOST_CHECK_EQUAL( reader.m_cpuids[1], 1U );
+
+  std::vector<int64_t> row;
+  BOOST_REQUIRE( reader.next( row ) );
+  BOOST_CHECK_EQUAL( row[0], 120 );
+  BOOST_CHECK_EQUAL( row[2], 5 );
+  BOOST_CHECK_EQUAL( row[3], 0 );
+  BOOST_REQUIRE( reader.next( row ) );
+  BOOST_CHECK_EQUAL( row[0], 80 );
+  BOOST_CHECK_EQUAL( row[2], -3 );
+  BOOST_CHECK_EQUAL( row[3], 1000 );
+  unsigned rows = 2;
+  while ( reader.next( row ) ) rows++;
+  // crosses a block boundary
+  BOOST_CHECK_EQUAL( rows, 300U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "MultiCacheSimulator.hpp"
+
+typedef MultiCacheSimulator<RCDCLine, uint64_t> Simulator;
+
+struct KendoBookends {
+  Simulator* sim;
+  Counter* waits;
+  Counter* waitCycles;
+
+  // two threads, each on its own core
+  KendoBookends() {
+    CacheConfiguration<RCDCLine> l1;
+    l1.cacheSize = 1024;
+    l1.assoc = 2;
+    l1.blockSize = 64;
+    l1.callbacks = NULL;
+    sim = new Simulator( 2, l1, false, l1, false, l1 );
+    sim->m_simulateKendo = true;
+    sim->threadStarted( 0 );
+    sim->threadStarted( 1 );
+    BOOST_REQUIRE( sim->tryDispatch( 0 ) );
+    BOOST_REQUIRE( sim->tryDispatch( 1 ) );
+    waits = Counter::find( 0, "LockTurnWaits" );
+    waitCycles = Counter::find( 0, "LockTurnWaitCycles" );
+    BOOST_REQUIRE( NULL != waits && NULL != waitCycles );
+  }
+  ~KendoBookends() {
+    delete sim;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( KendoLockTurns, KendoBookends )
+
+BOOST_AUTO_TEST_CASE( laggingThreadGoesFirst ) {
+  sim->basicBlock( 0, 100, 0x400000, 0 );
+  sim->basicBlock( 1, 40, 0x400000, 0 );
+  // core 1 takes 2 cycles per insn
+  sim->getCache( 1 )->timeInMemoryHierarchy = 40;
+
+  // thread 1 is behind in logical time, so its acquire doesn't wait
+  sim->syncOp( 1, SYNC_SINK, false, 0, 0x1000 );
+  BOOST_CHECK_EQUAL( waits->get(), 0U );
+
+  // thread 0 waits until thread 1 should reach 100 insns: 60 more at
+  // 2 cycles each, from cycle 80
+  sim->syncOp( 0, SYNC_SINK, false, 1, 0x2000 );
+  BOOST_CHECK_EQUAL( waits->get(), 1U );
+  BOOST_CHECK_EQUAL( waitCycles->get(), 100U );
+  BOOST_CHECK_EQUAL( sim->coreRuntime( 0 ), 200U );
+}
+
+BOOST_AUTO_TEST_CASE( tiesGoToLowerTid ) {
+  sim->basicBlock( 0, 50, 0x400000, 0 );
+  sim->basicBlock( 1, 50, 0x400000, 0 );
+  sim->getCache( 0 )->timeInMemoryHierarchy = 50;
+
+  sim->syncOp( 0, SYNC_SINK, false, 0, 0x1000 );
+  BOOST_CHECK_EQUAL( waits->get(), 0U );
+  // thread 1 has to wait for core 0 to get to the same logical time
+  sim->syncOp( 1, SYNC_SINK, false, 0, 0x1000 );
+  BOOST_CHECK_EQUAL( waits->get(), 1U );
+  BOOST_CHECK_EQUAL( waitCycles->get(), 50U );
+}
+
+BOOST_AUTO_TEST_CASE( releasesDontWait ) {
+  sim->basicBlock( 0, 100, 0x400000, 0 );
+  sim->basicBlock( 1, 10, 0x400000, 0 );
+  sim->syncOp( 0, SYNC_SOURCE, false, 0, 0x1000 );
+  BOOST_CHECK_EQUAL( waits->get(), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( acquiresDontStallAtQuantumBoundaries ) {
+  sim->basicBlock( 0, 10, 0x400000, 0 );
+  sim->basicBlock( 1, 10, 0x400000, 0 );
+  // an acquire right after a release of the same lock would end a Det-HB quantum
+  sim->syncOp( 0, SYNC_SOURCE, false, 0, 0x1000 );
+  sim->syncOp( 1, SYNC_SINK, true, 0, 0x1000 );
+  BOOST_CHECK( !sim->stalledAtQuantumBoundary( 1 ) );
+  BOOST_CHECK_EQUAL( Counter::find( 0, "SyncInducedRoundBoundaries" )->get(), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( waitingDoesntSlowALaggingThread ) {
+  sim->basicBlock( 0, 20, 0x400000, 0 );
+  sim->basicBlock( 1, 40, 0x400000, 0 );
+  // core 0 takes 4 cycles per insn
+  sim->getCache( 0 )->timeInMemoryHierarchy = 60;
+
+  // thread 1 waits for thread 0 to run 20 more insns, from cycle 80: until cycle 160
+  sim->syncOp( 1, SYNC_SINK, false, 0, 0x1000 );
+  BOOST_CHECK_EQUAL( waitCycles->get(), 120U );
+  BOOST_CHECK_EQUAL( sim->coreRuntime( 1 ), 160U );
+
+  // thread 1 still runs at 1 cycle per insn: its 80 insns take it from cycle 160 to 240
+  sim->basicBlock( 0, 100, 0x400000, 0 );
+  sim->syncOp( 0, SYNC_SINK, false, 1, 0x2000 );
+  BOOST_CHECK_EQUAL( waits->get(), 2U );
+  BOOST_CHECK_EQUAL( waitCycles->get(), 120U + 60U );
+  BOOST_CHECK_EQUAL( sim->coreRuntime( 0 ), 240U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
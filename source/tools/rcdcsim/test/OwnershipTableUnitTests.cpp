@@ -0,0 +1,72 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "OwnershipTable.hpp"
+
+BOOST_AUTO_TEST_SUITE( DMPOOwnership )
+
+BOOST_AUTO_TEST_CASE( firstToucherOwns ) {
+  OwnershipTable ot;
+  BOOST_CHECK( OwnershipTable::SHARED == ot.ownerOf( 0x40 ) );
+  BOOST_CHECK( !ot.communicates( 0x40, 1, false ) );
+  BOOST_CHECK_EQUAL( ot.ownerOf( 0x40 ), 1U );
+  BOOST_CHECK( !ot.communicates( 0x40, 1, true ) );
+  BOOST_CHECK( !ot.communicates( 0x80, 2, true ) );
+  BOOST_CHECK_EQUAL( ot.ownerOf( 0x80 ), 2U );
+}
+
+BOOST_AUTO_TEST_CASE( readSharing ) {
+  OwnershipTable ot;
+  ot.communicates( 0x40, 1, true );
+  // another thread's read communicates, and leaves the line shared
+  BOOST_CHECK( ot.communicates( 0x40, 2, false ) );
+  BOOST_CHECK( OwnershipTable::SHARED == ot.ownerOf( 0x40 ) );
+  // after which anyone may read it
+  BOOST_CHECK( !ot.communicates( 0x40, 3, false ) );
+  BOOST_CHECK( !ot.communicates( 0x40, 1, false ) );
+}
+
+BOOST_AUTO_TEST_CASE( writeSteals ) {
+  OwnershipTable ot;
+  ot.communicates( 0x40, 1, false );
+  BOOST_CHECK( ot.communicates( 0x40, 2, true ) );
+  BOOST_CHECK_EQUAL( ot.ownerOf( 0x40 ), 2U );
+  BOOST_CHECK( !ot.communicates( 0x40, 2, true ) );
+  BOOST_CHECK( ot.communicates( 0x40, 1, false ) );
+  // writing a shared line takes it too
+  BOOST_CHECK( ot.communicates( 0x40, 3, true ) );
+  BOOST_CHECK_EQUAL( ot.ownerOf( 0x40 ), 3U );
+}
+
+BOOST_AUTO_TEST_CASE( manyLines ) {
+  OwnershipTable ot;
+  for ( uint64_t line = 0; line < 1000; line++ ) {
+    ot.communicates( line * 64, line % 4, true );
+  }
+  for ( uint64_t line = 0; line < 1000; line++ ) {
+    BOOST_CHECK_EQUAL( ot.ownerOf( line * 64 ), unsigned( line % 4 ) );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
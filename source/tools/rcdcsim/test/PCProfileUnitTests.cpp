@@ -0,0 +1,71 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <unistd.h>
+
+#include "PCProfile.hpp"
+
+BOOST_AUTO_TEST_SUITE( PCProfiles )
+
+BOOST_AUTO_TEST_CASE( countsPerPC ) {
+  PCProfile p;
+  p.of( 0x400100 ).misses++;
+  p.of( 0x400200 ).remoteHits++;
+  p.of( 0x400100 ).misses++;
+  BOOST_CHECK_EQUAL( p.of( 0x400100 ).misses, 2U );
+  BOOST_CHECK_EQUAL( p.of( 0x400200 ).remoteHits, 1U );
+  BOOST_CHECK_EQUAL( p.of( 0x400200 ).misses, 0U );
+}
+
+BOOST_AUTO_TEST_CASE( resolvesSymbols ) {
+  char name[] = "/tmp/pcprofile-test.XXXXXX";
+  const int fd = mkstemp( name );
+  BOOST_REQUIRE( fd >= 0 );
+  close( fd );
+  {
+    ofstream out( name );
+    out << "400000 16 /bin/app:main\n";
+    out << "400100 32 /bin/app:hot loop\n";
+    out << "400200 16 /bin/app:operator'\n";
+  }
+  PCProfile p;
+  BOOST_REQUIRE( p.loadSymbols( name ) );
+  unlink( name );
+
+  BOOST_CHECK_EQUAL( p.symbolOf( 0x400000 ), "/bin/app:main+0x0" );
+  BOOST_CHECK_EQUAL( p.symbolOf( 0x40000f ), "/bin/app:main+0xf" );
+  // between routines
+  BOOST_CHECK_EQUAL( p.symbolOf( 0x400010 ), "" );
+  BOOST_CHECK_EQUAL( p.symbolOf( 0x400104 ), "/bin/app:hot loop+0x4" );
+  BOOST_CHECK_EQUAL( p.symbolOf( 0x3fffff ), "" );
+  // names are kept as they are; dumpStats() quotes them
+  BOOST_CHECK_EQUAL( p.symbolOf( 0x400201 ), "/bin/app:operator'+0x1" );
+  p.of( 0x400201 ).misses++;
+  stringstream ss;
+  p.dumpStats( ss, "{", "}\n" );
+  BOOST_CHECK( ss.str().find( "'pcSymbol': '/bin/app:operator\\'+0x1'" ) != string::npos );
+  BOOST_CHECK( !p.loadSymbols( "/nonexistent/symbols" ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
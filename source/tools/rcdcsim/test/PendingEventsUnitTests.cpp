@@ -0,0 +1,130 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "PendingEvents.hpp"
+
+static Event eventOf( unsigned tid, uint64_t addr ) {
+  Event e;
+  e.m_tid = tid;
+  e.m_type = MEMORY_READ;
+  e.m_addr = addr;
+  return e;
+}
+
+BOOST_AUTO_TEST_SUITE( PendingEventQueues )
+
+BOOST_AUTO_TEST_CASE( threadsTakeTurns ) {
+  PendingEvents p( 16, 4 );
+  p.push( eventOf(0, 1) );
+  p.push( eventOf(0, 2) );
+  p.push( eventOf(1, 3) );
+  BOOST_CHECK_EQUAL( p.numBuffered(), 3U );
+
+  BOOST_REQUIRE( p.hasReady() );
+  BOOST_CHECK_EQUAL( p.nextReady(), 0U );
+  BOOST_CHECK_EQUAL( p.pop(0).m_addr, 1U );
+  // thread 0 still has an event, but goes behind thread 1
+  BOOST_CHECK_EQUAL( p.nextReady(), 1U );
+  BOOST_CHECK_EQUAL( p.pop(1).m_addr, 3U );
+  BOOST_CHECK_EQUAL( p.nextReady(), 0U );
+  BOOST_CHECK_EQUAL( p.pop(0).m_addr, 2U );
+  BOOST_CHECK( !p.hasReady() );
+  BOOST_CHECK( p.empty(0) && p.empty(1) );
+  BOOST_CHECK_EQUAL( p.m_peakBuffered, 3U );
+}
+
+BOOST_AUTO_TEST_CASE( quantumRoundWakesStalledThreads ) {
+  PendingEvents p( 16, 4 );
+  p.push( eventOf(0, 1) );
+  BOOST_CHECK_EQUAL( p.nextReady(), 0U );
+  p.waitForQuantumRound( 0 );
+  BOOST_CHECK( WAIT_QUANTUM_ROUND == p.waitReasonOf(0) );
+  BOOST_CHECK( !p.hasReady() );
+
+  // more events don't wake a waiting thread, and other wakeups leave it alone
+  p.push( eventOf(0, 2) );
+  p.coreAvailabilityChanged();
+  p.causalityAdvanced( 0x42 );
+  BOOST_CHECK( !p.hasReady() );
+
+  p.quantumRoundCommitted();
+  BOOST_REQUIRE( p.hasReady() );
+  BOOST_CHECK( NOT_WAITING == p.waitReasonOf(0) );
+  BOOST_CHECK_EQUAL( p.nextReady(), 0U );
+  BOOST_CHECK( WAIT_QUANTUM_ROUND == p.wokenFrom(0) );
+  BOOST_CHECK_EQUAL( p.pop(0).m_addr, 1U );
+  BOOST_CHECK( NOT_WAITING == p.wokenFrom(0) );
+  BOOST_CHECK_EQUAL( p.m_wakeups, 1U );
+}
+
+BOOST_AUTO_TEST_CASE( coreWaitersWakeOnSchedulingChanges ) {
+  PendingEvents p( 16, 4 );
+  p.push( eventOf(0, 1) );
+  p.push( eventOf(1, 2) );
+  p.nextReady();
+  p.waitForCore( 0 );
+  p.nextReady();
+  p.waitForCore( 1 );
+  BOOST_CHECK( WAIT_CORE == p.waitReasonOf(1) );
+
+  p.coreAvailabilityChanged();
+  BOOST_CHECK_EQUAL( p.nextReady(), 0U );
+  BOOST_CHECK( WAIT_CORE == p.wokenFrom(0) );
+  BOOST_CHECK_EQUAL( p.nextReady(), 1U );
+
+  // a committed round may also free up a core
+  p.waitForCore( 1 );
+  p.quantumRoundCommitted();
+  BOOST_CHECK_EQUAL( p.nextReady(), 1U );
+  BOOST_CHECK_EQUAL( p.m_wakeups, 3U );
+}
+
+BOOST_AUTO_TEST_CASE( causalityWaitersWakePerSyncObject ) {
+  PendingEvents p( 16, 4 );
+  p.push( eventOf(0, 1) );
+  p.push( eventOf(1, 2) );
+  p.nextReady();
+  p.waitForCausality( 0, 0x42 );
+  p.nextReady();
+  p.waitForCausality( 1, 0x43 );
+  BOOST_CHECK( WAIT_CAUSALITY == p.waitReasonOf(0) );
+
+  // neither round commits nor scheduling changes help
+  p.quantumRoundCommitted();
+  p.coreAvailabilityChanged();
+  BOOST_CHECK( !p.hasReady() );
+
+  p.causalityAdvanced( 0x43 );
+  BOOST_CHECK_EQUAL( p.nextReady(), 1U );
+  BOOST_CHECK( !p.hasReady() );
+  BOOST_CHECK( WAIT_CAUSALITY == p.waitReasonOf(0) );
+  p.causalityAdvanced( 0x42 );
+  BOOST_CHECK_EQUAL( p.nextReady(), 0U );
+  BOOST_CHECK( WAIT_CAUSALITY == p.wokenFrom(0) );
+  // waking up only happens once per wait
+  p.causalityAdvanced( 0x42 );
+  BOOST_CHECK( !p.hasReady() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
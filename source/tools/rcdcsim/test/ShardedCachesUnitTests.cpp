@@ -0,0 +1,148 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "ShardedCaches.hpp"
+
+typedef SMPCache<RCDCLine, uint64_t> Cache;
+
+static const unsigned CORES = 4;
+static const unsigned LINE = 64;
+
+static CacheConfiguration<RCDCLine> config( int size, int assoc ) {
+  CacheConfiguration<RCDCLine> c;
+  c.cacheSize = size;
+  c.assoc = assoc;
+  c.blockSize = LINE;
+  c.callbacks = NULL;
+  return c;
+}
+
+/** Unsharded caches, set up like ShardedCaches sets up each shard. */
+struct Hierarchy {
+  LRUCallbacks<RCDCLine> l3Callbacks;
+  HierarchicalCache<RCDCLine>* l3;
+  vector<Cache*> caches;
+
+  Hierarchy() {
+    CacheConfiguration<RCDCLine> l3config = config( 64*1024, 8 );
+    l3config.callbacks = &l3Callbacks;
+    l3 = new HierarchicalCache<RCDCLine>( l3config, NULL );
+    for ( unsigned c = 0; c < CORES; c++ ) {
+      caches.push_back( new Cache( c, CORES, l3, &caches, config( 4*1024, 2 ), true, config( 16*1024, 4 ) ) );
+      caches.back()->enableICache( config( 4*1024, 2 ) );
+    }
+  }
+
+  ~Hierarchy() {
+    for ( unsigned c = 0; c < caches.size(); c++ ) {
+      delete caches[c];
+    }
+    delete l3;
+  }
+};
+
+struct Access {
+  unsigned core;
+  bool fetch;
+  bool write;
+  uint64_t addr;
+};
+
+/** Reads and writes to shared and per-core data, plus instruction fetches. */
+static vector<Access> workload() {
+  vector<Access> accesses;
+  uint64_t seed = 1;
+  for ( unsigned i = 0; i < 20000; i++ ) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const unsigned r = seed >> 33;
+    Access a;
+    a.core = r % CORES;
+    a.fetch = 0 == (r >> 4) % 8;
+    a.write = 0 == (r >> 7) % 3;
+    if ( a.fetch ) {
+      a.addr = 0x400000 + ((r >> 10) % 512) * LINE;
+    } else if ( (r >> 9) & 1 ) {
+      a.addr = 0x100000 + ((r >> 10) % 8192) * 8; // shared
+    } else {
+      a.addr = 0x8000000 + a.core * 0x100000 + ((r >> 10) % 8192) * 8;
+    }
+    accesses.push_back( a );
+  }
+  return accesses;
+}
+
+BOOST_AUTO_TEST_SUITE( ShardedCacheSimulation )
+
+BOOST_AUTO_TEST_CASE( matchesSerial ) {
+  const vector<Access> accesses = workload();
+
+  // the serial run's Counters aren't registered, so they can't be mistaken for the sharded run's
+  vector<Counter*> serialCounters;
+  Counter::openGroup( &serialCounters );
+  Hierarchy serial;
+  Counter::closeGroup();
+  for ( unsigned i = 0; i < accesses.size(); i++ ) {
+    const Access& a = accesses[i];
+    Cache* c = serial.caches[a.core];
+    if ( a.fetch ) c->fetchLine( a.addr );
+    else if ( a.write ) c->write( DataAccess( WRITE_ACCESS, a.addr, 8, LINE ), false );
+    else c->read( DataAccess( READ_ACCESS, a.addr, 8, LINE ) );
+  }
+  BOOST_REQUIRE( serial.caches[0]->timeInMemoryHierarchy > 0 );
+
+  const unsigned shardCounts[] = { 1, 2, 4 };
+  for ( unsigned n = 0; n < 3; n++ ) {
+    Hierarchy main;
+    const vector<Counter*>& all = Counter::allCounters();
+    BOOST_REQUIRE( all.size() >= serialCounters.size() );
+    const unsigned firstMainCounter = all.size() - serialCounters.size();
+
+    ShardedCaches<RCDCLine> shards( shardCounts[n], CORES, config( 4*1024, 2 ),
+                                    true, config( 16*1024, 4 ), true, config( 64*1024, 8 ),
+                                    true, config( 4*1024, 2 ) );
+    for ( unsigned i = 0; i < accesses.size(); i++ ) {
+      const Access& a = accesses[i];
+      if ( a.fetch ) shards.fetchLine( a.core, a.addr );
+      else shards.access( a.core, a.write, a.addr, 8 );
+      // collect partway through too, as quantum rounds do
+      if ( accesses.size() / 2 == i ) shards.collect( main.caches );
+    }
+    shards.collect( main.caches );
+
+    for ( unsigned c = 0; c < CORES; c++ ) {
+      BOOST_CHECK_EQUAL( main.caches[c]->timeInMemoryHierarchy, serial.caches[c]->timeInMemoryHierarchy );
+    }
+    for ( unsigned k = 0; k < serialCounters.size(); k++ ) {
+      Counter* expected = serialCounters[k];
+      Counter* actual = all[firstMainCounter + k];
+      BOOST_REQUIRE_EQUAL( actual->name(), expected->name() );
+      BOOST_REQUIRE_EQUAL( actual->cpuid(), expected->cpuid() );
+      BOOST_CHECK_MESSAGE( actual->get() == expected->get(),
+                           shardCounts[n] << " shards: " << actual->name() << " on core " << actual->cpuid()
+                           << " is " << actual->get() << ", expected " << expected->get() );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
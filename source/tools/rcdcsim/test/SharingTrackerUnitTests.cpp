@@ -0,0 +1,122 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "SMPCache.hpp"
+
+struct SharingBookends {
+  vector< SMPCache<RCDCLine, uint64_t>* > caches;
+  SharingTracker tracker;
+
+  SharingBookends() : tracker( 2, 64 ) {
+    CacheConfiguration<RCDCLine> l1config;
+    l1config.cacheSize = 1024;
+    l1config.blockSize = 64;
+    l1config.assoc = 4;
+    l1config.callbacks = NULL;
+    for ( int i = 0; i < 2; i++ ) {
+      caches.push_back( new SMPCache<RCDCLine, uint64_t>( i, 2, NULL, &caches, l1config, false, l1config ) );
+      caches.back()->sharingTracker = &tracker;
+    }
+  }
+  ~SharingBookends() {
+    for ( unsigned i = 0; i < caches.size(); i++ ) {
+      delete caches[i];
+    }
+  }
+
+  void write( int core, uint64_t addr ) {
+    caches[core]->write( DataAccess( WRITE_ACCESS, addr, 8, 64 ), false );
+  }
+  void read( int core, uint64_t addr ) {
+    caches[core]->read( DataAccess( READ_ACCESS, addr, 8, 64 ) );
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( SharingClassification, SharingBookends )
+
+BOOST_AUTO_TEST_CASE( differentWordsAreFalseSharing ) {
+  write( 0, 0x1000 );
+  for ( int i = 0; i < 10; i++ ) {
+    write( 1, 0x1008 );
+    write( 0, 0x1000 );
+  }
+  write( 1, 0x1008 );
+  BOOST_CHECK_EQUAL( tracker.trueSharingMisses(), 0U );
+  BOOST_CHECK_EQUAL( tracker.falseSharingMisses(), 19U );
+}
+
+BOOST_AUTO_TEST_CASE( sameWordIsTrueSharing ) {
+  write( 0, 0x1000 );
+  for ( int i = 0; i < 10; i++ ) {
+    write( 1, 0x1000 );
+    read( 0, 0x1000 );
+  }
+  // every write after the first is an upgrade that ends one of core 0's
+  // lifetimes; the last lifetime is still live
+  BOOST_CHECK_EQUAL( tracker.falseSharingMisses(), 0U );
+  BOOST_CHECK_EQUAL( tracker.trueSharingMisses(), 9U + 9U );
+}
+
+BOOST_AUTO_TEST_CASE( laterTouchMakesTrueSharing ) {
+  // core 0 misses on an unrelated word first, but then reads the new data
+  write( 0, 0x1000 );
+  write( 1, 0x1000 );
+  read( 0, 0x1010 );
+  read( 0, 0x1000 );
+  // ends core 0's lifetime, and is an upgrade of a word core 0 read
+  write( 1, 0x1000 );
+  BOOST_CHECK_EQUAL( tracker.trueSharingMisses(), 2U );
+  BOOST_CHECK_EQUAL( tracker.falseSharingMisses(), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( untouchedNewDataIsFalseSharing ) {
+  write( 0, 0x1000 );
+  write( 1, 0x1000 );
+  read( 0, 0x1010 );
+  write( 1, 0x1000 );
+  BOOST_CHECK_EQUAL( tracker.trueSharingMisses(), 0U );
+  BOOST_CHECK_EQUAL( tracker.falseSharingMisses(), 2U );
+}
+
+BOOST_AUTO_TEST_CASE( upgradeOfUnreadWordIsFalseSharing ) {
+  write( 0, 0x2000 );
+  write( 1, 0x2000 );
+  // core 0 re-fetches and reads what core 1 wrote: true sharing
+  read( 0, 0x2000 );
+  // core 1 upgrades to write a word core 0 never read: false sharing
+  write( 1, 0x2008 );
+  BOOST_CHECK_EQUAL( tracker.trueSharingMisses(), 1U );
+  BOOST_CHECK_EQUAL( tracker.falseSharingMisses(), 1U );
+}
+
+BOOST_AUTO_TEST_CASE( privateLinesAreNotTracked ) {
+  for ( int i = 0; i < 100; i++ ) {
+    write( i % 2, 0x4000 + (i % 2) * 0x1000 );
+  }
+  stringstream ss;
+  tracker.dumpStats( ss, "{", "}\n" );
+  BOOST_CHECK( string::npos != ss.str().find( "'SharedLinesTracked': 0" ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
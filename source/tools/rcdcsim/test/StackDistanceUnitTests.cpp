@@ -0,0 +1,91 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "StackDistance.hpp"
+
+BOOST_AUTO_TEST_SUITE( StackDistances )
+
+BOOST_AUTO_TEST_CASE( bucketsCoverEveryDistance ) {
+  for ( uint64_t d = 0; d < 100000; d++ ) {
+    const unsigned b = StackDistance::bucketOf( d );
+    BOOST_REQUIRE( StackDistance::lowerBound( b ) <= d );
+    BOOST_REQUIRE( StackDistance::lowerBound( b + 1 ) > d );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( cyclicSweepFullyAssociative ) {
+  // sweeping 100 lines over and over: every reuse is at distance 99
+  StackDistance sd( 1.0 );
+  for ( unsigned i = 0; i < 100 * 100; i++ ) {
+    sd.access( i % 100 );
+  }
+  BOOST_CHECK_CLOSE( sd.missRatio( 64, 0 ), 1.0, 1e-9 );
+  BOOST_CHECK_CLOSE( sd.missRatio( 99, 0 ), 1.0, 1e-9 );
+  // only the cold misses remain
+  BOOST_CHECK_CLOSE( sd.missRatio( 128, 0 ), 0.01, 1e-9 );
+}
+
+BOOST_AUTO_TEST_CASE( repeatedLineAlwaysHits ) {
+  StackDistance sd( 1.0 );
+  for ( unsigned i = 0; i < 1000; i++ ) {
+    sd.access( 7 );
+  }
+  BOOST_CHECK_CLOSE( sd.missRatio( 8, 8 ), 0.001, 1e-9 );
+  BOOST_CHECK_CLOSE( sd.missRatio( 1, 0 ), 0.001, 1e-9 );
+}
+
+BOOST_AUTO_TEST_CASE( survivesCompaction ) {
+  // far more accesses than the initial Fenwick tree holds
+  StackDistance sd( 1.0 );
+  for ( unsigned i = 0; i < 1000000; i++ ) {
+    sd.access( i % 1000 );
+  }
+  BOOST_CHECK_CLOSE( sd.missRatio( 512, 0 ), 1.0, 1e-9 );
+  BOOST_CHECK_CLOSE( sd.missRatio( 1024, 0 ), 0.001, 1e-9 );
+}
+
+BOOST_AUTO_TEST_CASE( setAssociativeModel ) {
+  // one set behaves like a fully-associative cache
+  BOOST_CHECK_EQUAL( StackDistance::conflictProbability( 7, 1, 8 ), 0 );
+  BOOST_CHECK_EQUAL( StackDistance::conflictProbability( 8, 1, 8 ), 1 );
+  // fewer lines in between than ways can never conflict
+  BOOST_CHECK_SMALL( StackDistance::conflictProbability( 7, 64, 8 ), 1e-12 );
+  // many more lines than the cache holds almost always conflict
+  BOOST_CHECK_CLOSE( StackDistance::conflictProbability( 100000, 64, 8 ), 1.0, 1e-6 );
+}
+
+BOOST_AUTO_TEST_CASE( samplingApproximatesExact ) {
+  // sweep a working set of 20000 lines, touching each 10 times
+  StackDistance exact( 1.0 ), sampled( 0.1 );
+  for ( unsigned i = 0; i < 200000; i++ ) {
+    const uint64_t line = (i * 7919) % 20000;
+    exact.access( line );
+    sampled.access( line );
+  }
+  for ( uint64_t lines = 1024; lines <= 65536; lines *= 2 ) {
+    BOOST_CHECK_SMALL( exact.missRatio( lines, 8 ) - sampled.missRatio( lines, 8 ), 0.05 );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,95 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+#include "StatsDocument.hpp"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( StatsDocuments )
+
+BOOST_AUTO_TEST_CASE( groupsLines ) {
+  StatsDocument doc;
+  doc.markGlobal( "Runtime" );
+  doc.addLines( "{'RunConfig': {'cores': 2, 'det-hb': True, 'run-id': None}}\n"
+                "{'cpuid': 0, 'Runtime': 100}\n"
+                "{'cpuid': 1, 'numReadHits': 7}\n"
+                "{'cpuid': 0, 'numReadHits': 5}\n"
+                "{'tid': 0, 'ThreadInsns': 9}\n"
+                "{'Histo': {0: 1, 2: 3}}\n"
+                "{'pc': 16, 'pcSymbol': 'main+0x10', 'pcMisses': 2}\n"
+                "{'pc': 32, 'pcSymbol': 'say \"hi\"', 'pcMisses': 1}\n"
+                "{'ratio': inf}\n"
+                "not a dict\n" );
+  stringstream ss;
+  doc.writeJson( ss );
+  const string json = ss.str();
+  BOOST_CHECK( json.find( "\"det-hb\": true" ) != string::npos );
+  BOOST_CHECK( json.find( "\"run-id\": null" ) != string::npos );
+  BOOST_CHECK( json.find( "\"Runtime\": 100" ) != string::npos );
+  BOOST_CHECK( json.find( "{\"numReadHits\": 5},\n    {\"numReadHits\": 7}" ) != string::npos );
+  BOOST_CHECK( json.find( "{\"ThreadInsns\": 9}" ) != string::npos );
+  BOOST_CHECK( json.find( "\"Histo\": {\"0\": 1, \"2\": 3}" ) != string::npos );
+  BOOST_CHECK( json.find( "{\"pc\": 32, \"pcSymbol\": \"say \\\"hi\\\"\", \"pcMisses\": 1}" ) != string::npos );
+  BOOST_CHECK( json.find( "\"ratio\": null" ) != string::npos );
+  BOOST_CHECK( json.find( "\"unparsed\": [\"not a dict\"]" ) != string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( writesWideCsv ) {
+  StatsDocument doc;
+  doc.addLines( "{'RunWorkload': {'workload': 'a, b'}}\n"
+                "{'cpuid': 1, 'numReadHits': 7}\n"
+                "{'Matrix': [[0, 1], [2, 0]]}\n"
+                "{'pc': 16, 'pcMisses': 2}\n" );
+  stringstream none, ss;
+  BOOST_CHECK( !doc.writeCsv( ss, "run1", none ) );
+  BOOST_CHECK_EQUAL( ss.str(),
+                     "run,workload.workload,global.Matrix,core1.numReadHits,pc.0.pc,pc.0.pcMisses\n"
+                     "run1,\"a, b\",\"[[0, 1], [2, 0]]\",7,16,2\n" );
+
+  // a run with the same stats is just appended
+  stringstream file( ss.str() ), row;
+  BOOST_CHECK( doc.writeCsv( row, "run2", file ) );
+  BOOST_CHECK_EQUAL( row.str(), "run2,\"a, b\",\"[[0, 1], [2, 0]]\",7,16,2\n" );
+}
+
+BOOST_AUTO_TEST_CASE( widensCsvForNewStats ) {
+  const string existing = "run,core1.numReadHits,workload.workload\n"
+                          "run1,7,\"two\nlines\"\n";
+  StatsDocument doc;
+  doc.addLines( "{'cpuid': 3, 'numReadHits': 5}\n"
+                "{'cpuid': 1, 'numReadHits': 6}\n" );
+  stringstream file( existing ), ss;
+  BOOST_CHECK( !doc.writeCsv( ss, "run2", file ) );
+  BOOST_CHECK_EQUAL( ss.str(),
+                     "run,core1.numReadHits,workload.workload,core3.numReadHits\n"
+                     "run1,7,\"two\nlines\",\n"
+                     "run2,6,,5\n" );
+}
+
+BOOST_AUTO_TEST_CASE( quotesPython ) {
+  BOOST_CHECK_EQUAL( StatsDocument::pyQuote( "it's \\" ), "'it\\'s \\\\'" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
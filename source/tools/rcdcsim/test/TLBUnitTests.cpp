@@ -0,0 +1,88 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "TLB.hpp"
+
+static DataTLB* tlb = NULL;
+
+static const uint64_t PAGE = 1ULL << DataTLB::SMALL_PAGE_BITS;
+static const uint64_t HUGE_PAGE = 1ULL << DataTLB::HUGE_PAGE_BITS;
+
+struct DataTLBBookends {
+  // runs before each test case
+  DataTLBBookends() {
+    TLBConfiguration config;
+    config.l1Entries = 4;
+    config.l1Assoc = 4;
+    config.l1HugeEntries = 2;
+    config.l1HugeAssoc = 2;
+    config.l2Entries = 16;
+    config.l2HugeEntries = 4;
+    config.l2Assoc = 4;
+    config.pwcEntries = 4;
+    tlb = new DataTLB( config );
+  }
+  // runs after each test case
+  ~DataTLBBookends() {
+    delete tlb;
+    tlb = NULL;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( TLB, DataTLBBookends )
+
+BOOST_AUTO_TEST_CASE( walkFillsL1 ) {
+  vector<uint64_t> ptes;
+  BOOST_CHECK_EQUAL( tlb->lookup(0x400000, false), TLB_MISS );
+  BOOST_CHECK_EQUAL( tlb->walk(0x400000, false, ptes), 0U );
+  BOOST_CHECK_EQUAL( ptes.size(), 4U );
+  BOOST_CHECK_EQUAL( ptes.back(), DataTLB::pteAddress(0x400000, 1) );
+  BOOST_CHECK_EQUAL( tlb->lookup(0x400000 + 8, false), TLB_L1_HIT );
+}
+
+BOOST_AUTO_TEST_CASE( pageWalkCache ) {
+  vector<uint64_t> ptes;
+  tlb->walk( 0x400000, false, ptes );
+
+  // a neighboring 4KB page only needs its leaf entry
+  BOOST_CHECK_EQUAL( tlb->walk(0x400000 + PAGE, false, ptes), 3U );
+  BOOST_CHECK_EQUAL( ptes.size(), 1U );
+
+  // a 2MB page in the same 1GB region stops one level higher
+  BOOST_CHECK_EQUAL( tlb->walk(0x400000 + HUGE_PAGE, true, ptes), 2U );
+  BOOST_CHECK_EQUAL( ptes.size(), 1U );
+  BOOST_CHECK_EQUAL( tlb->lookup(0x400000 + HUGE_PAGE + PAGE, true), TLB_L1_HIT );
+}
+
+BOOST_AUTO_TEST_CASE( l2Hit ) {
+  vector<uint64_t> ptes;
+  // overflow the 4-entry L1
+  for ( uint64_t i = 0; i < 5; i++ ) {
+    tlb->walk( i * PAGE, false, ptes );
+  }
+  BOOST_CHECK_EQUAL( tlb->lookup(0, false), TLB_L2_HIT );
+  BOOST_CHECK_EQUAL( tlb->lookup(0, false), TLB_L1_HIT );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
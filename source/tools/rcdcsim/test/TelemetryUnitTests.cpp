@@ -0,0 +1,137 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "Telemetry.hpp"
+
+static std::string socketPath( const char* name ) {
+  std::stringstream path;
+  path << "/tmp/rcdcsim-test-" << getpid() << "-" << name;
+  return path.str();
+}
+
+/** Connect to the server at path and return everything it sends. */
+static std::string fetch( const std::string& path ) {
+  const int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+  BOOST_REQUIRE( fd >= 0 );
+  sockaddr_un addr;
+  memset( &addr, 0, sizeof(addr) );
+  addr.sun_family = AF_UNIX;
+  strcpy( addr.sun_path, path.c_str() );
+  BOOST_REQUIRE_EQUAL( 0, connect( fd, (sockaddr*) &addr, sizeof(addr) ) );
+  std::string reply;
+  char buf[256];
+  ssize_t n;
+  while ( (n = read( fd, buf, sizeof(buf) )) > 0 ) {
+    reply.append( buf, n );
+  }
+  close( fd );
+  return reply;
+}
+
+static bool exists( const std::string& path ) {
+  struct stat st;
+  return 0 == stat( path.c_str(), &st );
+}
+
+BOOST_AUTO_TEST_SUITE( Telemetry )
+
+BOOST_AUTO_TEST_CASE( servesLatestSnapshot ) {
+  const std::string path = socketPath( "latest" );
+  TelemetryServer server;
+  BOOST_REQUIRE( server.start( path ) );
+  BOOST_CHECK_EQUAL( fetch( path ), "{}\n" );
+
+  server.publish( "{\"simulatedInsns\": 1}\n" );
+  BOOST_CHECK_EQUAL( fetch( path ), "{\"simulatedInsns\": 1}\n" );
+  server.publish( "{\"simulatedInsns\": 2}\n" );
+  BOOST_CHECK_EQUAL( fetch( path ), "{\"simulatedInsns\": 2}\n" );
+}
+
+BOOST_AUTO_TEST_CASE( servesLargeSnapshots ) {
+  const std::string path = socketPath( "large" );
+  TelemetryServer server;
+  BOOST_REQUIRE( server.start( path ) );
+  const std::string big( 1 << 20, 'x' );
+  server.publish( big );
+  BOOST_CHECK( fetch( path ) == big );
+}
+
+BOOST_AUTO_TEST_CASE( replacesStaleSocketAndCleansUp ) {
+  const std::string path = socketPath( "stale" );
+  {
+    TelemetryServer first;
+    BOOST_REQUIRE( first.start( path ) );
+    // a crashed run leaves its socket behind
+    TelemetryServer second;
+    BOOST_REQUIRE( second.start( path ) );
+    second.publish( "{\"run\": 2}\n" );
+    BOOST_CHECK_EQUAL( fetch( path ), "{\"run\": 2}\n" );
+  }
+  BOOST_CHECK( !exists( path ) );
+}
+
+BOOST_AUTO_TEST_CASE( rejectsOverlongPaths ) {
+  TelemetryServer server;
+  BOOST_CHECK( !server.start( "/tmp/" + std::string( 200, 'x' ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( waitsForFifoInput ) {
+  const std::string path = socketPath( "fifo" );
+  BOOST_REQUIRE_EQUAL( 0, mkfifo( path.c_str(), 0600 ) );
+  InputLag lag( path );
+  const int writer = open( path.c_str(), O_WRONLY | O_NONBLOCK );
+  BOOST_REQUIRE( writer >= 0 );
+
+  BOOST_CHECK( !lag.waitForInput( 10 ) );
+  BOOST_CHECK_EQUAL( lag.bytesWaiting( 0 ), 0U );
+  BOOST_REQUIRE_EQUAL( 4, write( writer, "abcd", 4 ) );
+  BOOST_CHECK( lag.waitForInput( 10 ) );
+  BOOST_CHECK_EQUAL( lag.bytesWaiting( 0 ), 4U );
+
+  // the front-end hanging up also ends the wait, so the caller sees EOF
+  close( writer );
+  BOOST_CHECK( lag.waitForInput( 10 ) );
+  unlink( path.c_str() );
+}
+
+BOOST_AUTO_TEST_CASE( neverWaitsOnRegularFiles ) {
+  const std::string path = socketPath( "file" );
+  const int fd = open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+  BOOST_REQUIRE( fd >= 0 );
+  BOOST_REQUIRE_EQUAL( 8, write( fd, "abcdefgh", 8 ) );
+  close( fd );
+  InputLag lag( path );
+  BOOST_CHECK( lag.waitForInput( 1000 ) );
+  BOOST_CHECK_EQUAL( lag.bytesWaiting( 3 ), 5U );
+  unlink( path.c_str() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
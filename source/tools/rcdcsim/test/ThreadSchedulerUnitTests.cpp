@@ -0,0 +1,176 @@
+/*
+  RCDC-sim: A Relaxed Consistency Deterministic Computer simulator
+  Copyright 2011 University of Washington
+
+  Contributed by Joseph Devietti
+
+This file is part of RCDC-sim.
+
+RCDC-sim is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RCDC-sim is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/test/unit_test.hpp>
+
+#include "ThreadScheduler.hpp"
+
+BOOST_AUTO_TEST_SUITE( ThreadScheduling )
+
+static const vector<bool> NONE_STALLED( 4, false );
+
+BOOST_AUTO_TEST_CASE( affinityPlacement ) {
+  ThreadScheduler ts( 4 );
+  ts.setAffinity( 5, 3 );
+  for ( unsigned tid = 0; tid < 6; tid++ ) ts.threadStarted( tid );
+  BOOST_CHECK_EQUAL( ts.coreOf( 0 ), 0U );
+  BOOST_CHECK_EQUAL( ts.coreOf( 2 ), 2U );
+  BOOST_CHECK_EQUAL( ts.coreOf( 4 ), 0U );
+  BOOST_CHECK_EQUAL( ts.coreOf( 5 ), 3U );
+  // threads we haven't seen start get a fixed mapping
+  BOOST_CHECK_EQUAL( ts.coreOf( 9 ), 1U );
+}
+
+BOOST_AUTO_TEST_CASE( roundRobinPlacement ) {
+  ThreadScheduler ts( 4 );
+  ts.m_policy = SCHED_ROUND_ROBIN;
+  ts.threadStarted( 7 );
+  ts.threadStarted( 3 );
+  ts.threadStarted( 1 );
+  BOOST_CHECK_EQUAL( ts.coreOf( 7 ), 0U );
+  BOOST_CHECK_EQUAL( ts.coreOf( 3 ), 1U );
+  BOOST_CHECK_EQUAL( ts.coreOf( 1 ), 2U );
+}
+
+BOOST_AUTO_TEST_CASE( loadBalancePlacement ) {
+  ThreadScheduler ts( 2 );
+  ts.m_policy = SCHED_LOAD_BALANCE;
+  ts.threadStarted( 0 );
+  ts.threadStarted( 1 );
+  ts.block( 0 );
+  // core 0 has nothing runnable, so it gets the next thread
+  ts.threadStarted( 2 );
+  BOOST_CHECK_EQUAL( ts.coreOf( 2 ), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( affinityNeverMigrates ) {
+  ThreadScheduler ts( 4 );
+  ts.threadStarted( 0 );
+  ts.threadStarted( 4 );
+  uint64_t cost;
+  BOOST_CHECK( ts.tryDispatch( 0, NONE_STALLED, cost ) );
+  BOOST_CHECK( !ts.tryDispatch( 4, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( ts.coreOf( 4 ), 0U );
+  BOOST_CHECK_EQUAL( ts.currentThreadOf( 0 ), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( roundRobinMigratesToFreeCore ) {
+  ThreadScheduler ts( 2 );
+  ts.m_policy = SCHED_ROUND_ROBIN;
+  ts.threadStarted( 0 ); // core 0
+  ts.threadStarted( 1 ); // core 1
+  ts.threadStarted( 2 ); // core 0
+  uint64_t cost;
+  BOOST_CHECK( ts.tryDispatch( 0, NONE_STALLED, cost ) );
+  BOOST_CHECK( ts.tryDispatch( 1, NONE_STALLED, cost ) );
+  BOOST_CHECK( !ts.tryDispatch( 2, NONE_STALLED, cost ) );
+
+  ts.threadFinished( 1 );
+  // core 1 is stalled until the round ends, so it can't take thread 2 yet
+  vector<bool> stalled( 2, false );
+  stalled[1] = true;
+  BOOST_CHECK( !ts.tryDispatch( 2, stalled, cost ) );
+  BOOST_CHECK( ts.tryDispatch( 2, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( ts.coreOf( 2 ), 1U );
+  BOOST_CHECK_EQUAL( ts.currentThreadOf( 1 ), 2U );
+}
+
+BOOST_AUTO_TEST_CASE( loadBalanceMigratesOnlyToEvenLoad ) {
+  ThreadScheduler ts( 2 );
+  ts.m_policy = SCHED_LOAD_BALANCE;
+  ts.threadStarted( 0 ); // core 0
+  ts.threadStarted( 1 ); // core 1
+  ts.threadStarted( 2 ); // core 0
+  uint64_t cost;
+  BOOST_CHECK( ts.tryDispatch( 0, NONE_STALLED, cost ) );
+  BOOST_CHECK( ts.tryDispatch( 1, NONE_STALLED, cost ) );
+
+  // core 1 is available, but moving thread 2 there would leave it with 2 threads
+  ts.preempt( 1 );
+  BOOST_CHECK( !ts.tryDispatch( 2, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( ts.coreOf( 2 ), 0U );
+
+  // once core 1 is empty, the move evens things out
+  ts.threadFinished( 1 );
+  BOOST_CHECK( ts.tryDispatch( 2, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( ts.coreOf( 2 ), 1U );
+  BOOST_CHECK_EQUAL( ts.currentThreadOf( 1 ), 2U );
+  BOOST_CHECK( !ts.coreIsIdle( 1 ) );
+}
+
+BOOST_AUTO_TEST_CASE( sliceExpiry ) {
+  SchedulingPolicy policies[] = { SCHED_AFFINITY, SCHED_ROUND_ROBIN, SCHED_LOAD_BALANCE };
+  for ( unsigned p = 0; p < 3; p++ ) {
+    ThreadScheduler ts( 1 );
+    ts.m_policy = policies[p];
+    ts.m_timeSlice = 100;
+    ts.threadStarted( 0 );
+    ts.threadStarted( 1 );
+    uint64_t cost;
+    BOOST_CHECK( ts.tryDispatch( 0, NONE_STALLED, cost ) );
+    ts.executed( 0, 99 );
+    BOOST_CHECK( !ts.tryDispatch( 1, NONE_STALLED, cost ) );
+    const uint64_t gen = ts.generation();
+    ts.executed( 0, 1 );
+    BOOST_CHECK( ts.generation() != gen );
+    BOOST_CHECK( ts.tryDispatch( 1, NONE_STALLED, cost ) );
+    BOOST_CHECK_EQUAL( ts.currentThreadOf( 0 ), 1U );
+    // the new thread starts a fresh slice
+    BOOST_CHECK( !ts.tryDispatch( 0, NONE_STALLED, cost ) );
+    BOOST_CHECK_EQUAL( ts.insnsOf( 0 ), 100U );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( preemption ) {
+  SchedulingPolicy policies[] = { SCHED_AFFINITY, SCHED_ROUND_ROBIN, SCHED_LOAD_BALANCE };
+  for ( unsigned p = 0; p < 3; p++ ) {
+    ThreadScheduler ts( 1 );
+    ts.m_policy = policies[p];
+    ts.threadStarted( 0 );
+    ts.threadStarted( 1 );
+    uint64_t cost;
+    BOOST_CHECK( ts.tryDispatch( 0, NONE_STALLED, cost ) );
+    BOOST_CHECK( !ts.tryDispatch( 1, NONE_STALLED, cost ) );
+    ts.preempt( 0 );
+    BOOST_CHECK( ts.tryDispatch( 1, NONE_STALLED, cost ) );
+    // preemption is consumed by the switch
+    BOOST_CHECK( !ts.tryDispatch( 0, NONE_STALLED, cost ) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( contextSwitchCost ) {
+  ThreadScheduler ts( 1 );
+  ts.m_contextSwitchCycles = 50;
+  ts.threadStarted( 0 );
+  ts.threadStarted( 1 );
+  uint64_t cost;
+  // the first thread on an idle core pays nothing
+  BOOST_CHECK( ts.tryDispatch( 0, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( cost, 0U );
+  ts.block( 0 );
+  BOOST_CHECK( ts.tryDispatch( 1, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( cost, 50U );
+  BOOST_CHECK( ts.tryDispatch( 1, NONE_STALLED, cost ) );
+  BOOST_CHECK_EQUAL( cost, 0U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
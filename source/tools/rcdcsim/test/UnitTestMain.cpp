@@ -30,6 +30,6 @@ along with RCDC-sim.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Counter.hpp"
 std::vector<Counter*> Counter::s_AllStats;
+std::vector<Counter*>* Counter::s_OpenGroup = NULL;
 
 #include "MultiCacheSimulator.hpp"
-map<uint64_t, vector<uint64_t> > g_vcOfSyncObject;